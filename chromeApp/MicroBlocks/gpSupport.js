@@ -207,8 +207,21 @@ function initGPEventHandlers() {
 		GP.events.push([MOUSE_UP, p[0], p[1], evt.button, modifierBits(evt)]);
 	}
 	canvas.onmousemove = function(evt) {
+		// Coalesce with a directly preceding move event: fast drags can
+		// generate many moves per frame, and delivering them all makes
+		// dragging lag behind the cursor. The merged event keeps the latest
+		// position and accumulates the movement deltas.
 		var p = localPoint(evt.clientX, evt.clientY);
-		GP.events.push([MOUSE_MOVE, p[0], p[1]]);
+		var queue = GP.events;
+		var last = (queue.length > 0) ? queue[queue.length - 1] : null;
+		if (last && (last[0] == MOUSE_MOVE)) {
+			last[1] = p[0];
+			last[2] = p[1];
+			last[3] += (evt.movementX | 0);
+			last[4] += (evt.movementY | 0);
+		} else {
+			GP.events.push([MOUSE_MOVE, p[0], p[1], (evt.movementX | 0), (evt.movementY | 0)]);
+		}
 	}
 	document.onkeydown = function(evt) {
 		var key = evt.which;
@@ -264,10 +277,20 @@ function initGPEventHandlers() {
 		evt.preventDefault();
 	}
 	canvas.ontouchmove = function(evt) {
+		// coalesced like mouse moves; see canvas.onmousemove
 		var touch = evt.touches[evt.touches.length - 1];
 		if (touch) {
 			var p = localPoint(touch.clientX, touch.clientY);
-			GP.events.push([TOUCH_MOVE, p[0], p[1], 0]);
+			var queue = GP.events;
+			var last = (queue.length > 0) ? queue[queue.length - 1] : null;
+			if (last && (last[0] == TOUCH_MOVE)) {
+				last[4] += p[0] - last[1];
+				last[5] += p[1] - last[2];
+				last[1] = p[0];
+				last[2] = p[1];
+			} else {
+				GP.events.push([TOUCH_MOVE, p[0], p[1], 0, 0, 0]);
+			}
 		}
 		evt.preventDefault();
 	}
@@ -488,9 +511,20 @@ function GP_stopAudioInput() {
 	GP.audioInReady = false;
 }
 
-function GP_startAudioOutput(frameCount, isStereo) {
+function GP_startAudioOutput(frameCount, isStereo, ringPtr, ringSize, readPosPtr, writePosPtr, underrunsPtr) {
 	if (GP.callbackID) return; // already open
 
+	// Samples arrive through a ring buffer in the Emscripten heap (see
+	// soundPrims.c). GP advances the write position as it mixes; this
+	// callback advances the read position as it plays, so neither side
+	// ever waits for the other.
+	GP.audioRingBase = ringPtr >> 1; // HEAP16 index
+	GP.audioRingMask = ringSize - 1;
+	GP.audioReadPosIndex = readPosPtr >> 2; // HEAPU32 index
+	GP.audioWritePosIndex = writePosPtr >> 2;
+	GP.audioUnderrunsIndex = underrunsPtr >> 2;
+	GP.audioHadData = false;
+
 	audioContext = GP_audioContext();
 	if (!audioContext) return;
 
@@ -505,25 +539,39 @@ function GP_startAudioOutput(frameCount, isStereo) {
 		var buf = GP.audioOutBuffers[GP.audioOutBufferIndex];
 		GP.audioOutBufferIndex = (GP.audioOutBufferIndex + 1) % 2;
 
-		if (GP.audioOutReady) {
-			if (GP.audioOutIsStereo) { // stereo
-				var left = buf.getChannelData(0);
-				var right = buf.getChannelData(1);
-				for (var i = 0; i < left.length; i++) {
-					left[i] = GP.audioOutBuffer[2 * i];
-					right[i] = GP.audioOutBuffer[(2 * i) + 1];
-				}
-			} else { // mono
-				var samples = buf.getChannelData(0);
-				for (var i = 0; i < samples.length; i++) samples[i] = GP.audioOutBuffer[i];
+		// pull as many samples as possible from the ring buffer and pad
+		// any shortfall with silence
+		var read = Module.HEAPU32[GP.audioReadPosIndex];
+		var avail = (Module.HEAPU32[GP.audioWritePosIndex] - read) >>> 0;
+		var mask = GP.audioRingMask;
+		var base = GP.audioRingBase;
+		var needed, frames, i;
+		if (GP.audioOutIsStereo) { // stereo
+			var left = buf.getChannelData(0);
+			var right = buf.getChannelData(1);
+			needed = 2 * left.length;
+			frames = Math.min(avail, needed) >> 1;
+			for (i = 0; i < frames; i++) {
+				left[i] = Module.HEAP16[base + (read++ & mask)] / 32768.0;
+				right[i] = Module.HEAP16[base + (read++ & mask)] / 32768.0;
 			}
-		} else { // no GP audio data available; fill all channels with silence
-			for (var chan = 0; chan < buf.numberOfChannels; chan++) {
-				var samples = buf.getChannelData(chan);
-				for (var i = 0; i < samples.length; i++) samples[i] = 0;
+			for (i = frames; i < left.length; i++) left[i] = right[i] = 0;
+		} else { // mono
+			var samples = buf.getChannelData(0);
+			needed = samples.length;
+			frames = Math.min(avail, needed);
+			for (i = 0; i < frames; i++) {
+				samples[i] = Module.HEAP16[base + (read++ & mask)] / 32768.0;
 			}
+			for (i = frames; i < samples.length; i++) samples[i] = 0;
+		}
+		Module.HEAPU32[GP.audioReadPosIndex] = read; // release the consumed samples
+		if (avail < needed) {
+			// count an underrun only if sound was flowing; running dry when
+			// nothing is playing is the normal idle state, not a glitch
+			if ((avail > 0) || GP.audioHadData) Module.HEAP32[GP.audioUnderrunsIndex]++;
 		}
-		GP.audioOutReady = false;
+		GP.audioHadData = (avail >= needed);
 
 		var startTime = GP.audioOutFlipTime + buf.duration;
 		if (audioContext.currentTime > startTime) startTime = audioContext.currentTime;
@@ -536,10 +584,7 @@ function GP_startAudioOutput(frameCount, isStereo) {
 	}
 
 	var channelCount = isStereo ? 2 : 1;
-	var data = new ArrayBuffer(4 * frameCount * channelCount); // four-bytes per sample (Float32's)
-	GP.audioOutBuffer = new Float32Array(data);
 	GP.audioOutIsStereo = isStereo;
-	GP.audioOutReady = false;
 
 	GP.audioOutBuffers = [];
 	GP.audioOutBuffers.push(audioContext.createBuffer(channelCount, frameCount, 22050));
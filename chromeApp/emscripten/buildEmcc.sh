@@ -21,19 +21,20 @@ cp ../../ide/* runtime/lib
 mv runtime/lib/MicroBlocksPatches.gp runtime/lib/zzzMicroBlocksPatches.gp # makes patches load last
 cp -r ../../translations .
 
-emcc -std=gnu99 -Wall -O3 \
+emcc -std=gnu99 -Wall -O3 -msimd128 \
 -D EMSCRIPTEN \
 -D NO_JPEG \
 -D NO_SDL \
 -D NO_SOCKETS \
 -D SHA2_USE_INTTYPES_H \
+-D SHA2_UNROLL_TRANSFORM \
 -s USE_ZLIB=1 \
 -s TOTAL_MEMORY=117440512 \
 -s ALLOW_MEMORY_GROWTH=0 \
 --memory-init-file 0 \
 -s WASM=1 \
 browserPrims.c cache.c dict.c embeddedFS.c events.c gp.c interp.c mem.c memGC.c \
-oop.c parse.c prims.c serialPortPrims.c sha1.c sha2.c soundPrims.c textAndFontPrims.c vectorPrims.c \
+oop.c parse.c prims.c serialPortPrims.c sha1.c sha2.c snapshot.c soundPrims.c textAndFontPrims.c vectorPrims.c \
 --preload-file Examples \
 --preload-file Libraries \
 --preload-file precompiled \
@@ -2,43 +2,113 @@
 // John Maloney, September 2015
 
 #include <stdio.h>
+#include <string.h>
 #include "mem.h"
 #include "cache.h"
-#include "dict.h"
 
-OBJ methodCache = nilObj;
+// The method cache is a set-associative table of C structs. (It used to be a
+// GP dictionary mapping each selector to a growing array of entries, which
+// cost a dictionary lookup plus a linear scan on every probe and allocated on
+// every addition.) A lookup hashes the selector, receiver class, and calling
+// module to a set and probes that set's four ways; a hit is moved to the front
+// of its set, making replacement LRU within each set. Because the table lives
+// outside the object heap, it is not traced by the garbage collector; instead,
+// entries are invalidated when a method or function definition changes and
+// when the objects they reference may have moved or been collected (see
+// methodCacheClearRange() and its callers in memGC.c).
+
+#define MethodCacheWays 4
+#define MethodCacheSets 256 // must be a power of two
+
+typedef struct {
+	OBJ methodName; // selector string; nilObj if this entry is unused
+	OBJ classID; // receiver class as a GP integer, or 0 for no receiver
+	OBJ module; // calling module
+	OBJ method; // the function or method found by the last full lookup
+} MethodCacheEntry;
+
+static MethodCacheEntry methodCache[MethodCacheSets][MethodCacheWays];
 
 static int methodCacheHits = 0;
 static int methodCacheMisses = 0;
 static int methodCacheFullClears = 0;
 static int methodCacheEntryClears = 0;
 
+static inline MethodCacheEntry* methodCacheSet(OBJ methodName, OBJ classID, OBJ module) {
+	uint32 h = (methodName >> 2) ^ (methodName >> 10) ^ classID ^ (module >> 4);
+	return methodCache[h & (MethodCacheSets - 1)];
+}
+
 void methodCacheClear() {
-	methodCache = newDict(1000);
+	memset(methodCache, 0, sizeof(methodCache));
 	methodCacheHits = 0;
 	methodCacheMisses = 0;
 	methodCacheFullClears++;
 }
 
 void methodCacheClearEntry(OBJ methodName) {
-	OBJ methodMap = dictAt(methodCache, methodName);
-	if (methodMap != nilObj) {
-		dictAtPut(methodCache, methodName, newArray(0)); // set entry an empty array
+	// Invalidate all entries for the given selector (e.g. when a method or
+	// function with that name is defined or redefined). Selectors are compared
+	// by contents, not identity, so entries holding a different string object
+	// with the same characters are also invalidated.
+
+	char *name = obj2str(methodName);
+	MethodCacheEntry *entry = &methodCache[0][0];
+	MethodCacheEntry *end = entry + (MethodCacheSets * MethodCacheWays);
+	for (; entry < end; entry++) {
+		if (entry->methodName &&
+			((entry->methodName == methodName) || strEQ(name, entry->methodName))) {
+				entry->methodName = nilObj;
+		}
+	}
+	methodCacheEntryClears++;
+}
+
+void methodCacheClearClass(int classIndex) {
+	// Invalidate all entries whose receiver class is the given class
+	// (e.g. when that class's method array is replaced).
+
+	OBJ classID = int2obj(classIndex);
+	MethodCacheEntry *entry = &methodCache[0][0];
+	MethodCacheEntry *end = entry + (MethodCacheSets * MethodCacheWays);
+	for (; entry < end; entry++) {
+		if (classID == entry->classID) entry->methodName = nilObj;
 	}
 	methodCacheEntryClears++;
 }
 
+void methodCacheClearRange(OBJ start) {
+	// Invalidate all entries that reference an object at or above the given
+	// address. Called by the garbage collector, which moves or collects
+	// objects in that part of the heap; entries below it remain valid.
+
+	MethodCacheEntry *entry = &methodCache[0][0];
+	MethodCacheEntry *end = entry + (MethodCacheSets * MethodCacheWays);
+	for (; entry < end; entry++) {
+		if ((entry->methodName >= start) ||
+			(entry->module >= start) ||
+			(entry->method >= start)) {
+				entry->methodName = nilObj;
+		}
+	}
+}
+
 OBJ methodCacheLookup(OBJ methodName, OBJ classID, OBJ module) {
 	// Return a method object for the given method and class called from the given module.
 	// Return nil if not found in cache.
-	OBJ methodMap = dictAt(methodCache, methodName);
-	if (methodMap != nilObj) {
-		int n = objWords(methodMap);
-		for (int i = 0; i < n; i += 3) {
-			if ((FIELD(methodMap, i) == classID) && (FIELD(methodMap, i + 1) == module)) {
+
+	MethodCacheEntry *set = methodCacheSet(methodName, classID, module);
+	for (int i = 0; i < MethodCacheWays; i++) {
+		if ((set[i].methodName == methodName) &&
+			(set[i].classID == classID) &&
+			(set[i].module == module)) {
 				methodCacheHits++;
-				return FIELD(methodMap, i + 2);
-			}
+				if (i) { // move the hit to the front of its set (LRU)
+					MethodCacheEntry hit = set[i];
+					while (i > 0) { set[i] = set[i - 1]; i--; }
+					set[0] = hit;
+				}
+				return set[0].method;
 		}
 	}
 	methodCacheMisses++;
@@ -46,20 +116,15 @@ OBJ methodCacheLookup(OBJ methodName, OBJ classID, OBJ module) {
 }
 
 void methodCacheAdd(OBJ methodName, OBJ classID, OBJ callingModule, OBJ method) {
-	// Add a method with the given name and class to the cache.
-
-	OBJ methodMap = dictAt(methodCache, methodName);
-	int oldSize = 0;
-	if (methodMap == nilObj) {
-		methodMap = newArray(3);
-	} else {
-		oldSize = objWords(methodMap);
-		methodMap = copyObj(methodMap, (oldSize + 3), 1);
-	}
-	FIELD(methodMap, oldSize) = classID;
-	FIELD(methodMap, oldSize + 1) = callingModule;
-	FIELD(methodMap, oldSize + 2) = method;
-	dictAtPut(methodCache, methodName, methodMap);
+	// Add a method with the given name and class to the cache,
+	// evicting the least recently used entry of its set if necessary.
+
+	MethodCacheEntry *set = methodCacheSet(methodName, classID, callingModule);
+	for (int i = MethodCacheWays - 1; i > 0; i--) set[i] = set[i - 1];
+	set[0].methodName = methodName;
+	set[0].classID = classID;
+	set[0].module = callingModule;
+	set[0].method = method;
 }
 
 static void printMethodCacheStats() {
@@ -70,29 +135,30 @@ static void printMethodCacheStats() {
 		return;
 	}
 	printf("method cache hits %d out of %d (%d percent)\n", methodCacheHits, total, (100 * methodCacheHits) / total);
-	int oneToThreeClassEntries = 0;
-	OBJ keys = FIELD(methodCache, 1);
-	OBJ values = FIELD(methodCache, 2);
-	for (int i = 0; i < objWords(keys); i++) {
-		OBJ k = FIELD(keys, i);
-		OBJ v = FIELD(values, i);
-		if (IS_CLASS(k, StringClass)) {
-			int entryCount = objWords(v) / 3;
-			if (entryCount < 4) {
-				oneToThreeClassEntries++;
-			} else {
-				printf("  %s %d\n", obj2str(k), entryCount);
-			}
+	int entryCount = 0;
+	int fullSets = 0;
+	for (int i = 0; i < MethodCacheSets; i++) {
+		int waysUsed = 0;
+		for (int j = 0; j < MethodCacheWays; j++) {
+			if (methodCache[i][j].methodName) waysUsed++;
 		}
+		entryCount += waysUsed;
+		if (waysUsed == MethodCacheWays) fullSets++;
 	}
-	printf("%d selectors\n", dictCount(methodCache));
-	printf("%d selectors with only one to three classes\n----------\n", oneToThreeClassEntries);
+	printf("%d of %d entries used; %d of %d sets full\n----------\n",
+		entryCount, MethodCacheSets * MethodCacheWays, fullSets, MethodCacheSets);
 }
 
 OBJ methodCacheStats() {
 	if (false) printMethodCacheStats(); // make true for testing
+	int entryCount = 0;
+	for (int i = 0; i < MethodCacheSets; i++) {
+		for (int j = 0; j < MethodCacheWays; j++) {
+			if (methodCache[i][j].methodName) entryCount++;
+		}
+	}
 	OBJ result = newArray(5);
-	FIELD(result, 0) = int2obj(dictCount(methodCache));
+	FIELD(result, 0) = int2obj(entryCount);
 	FIELD(result, 1) = int2obj(methodCacheHits);
 	FIELD(result, 2) = int2obj(methodCacheMisses);
 	FIELD(result, 3) = int2obj(methodCacheFullClears);
@@ -7,35 +7,71 @@
 #include "dict.h"
 #include "interp.h"
 
+// Dictionaries are open-addressing hash tables with power-of-two capacity,
+// so the probe sequence uses a mask rather than a modulo. Each key's hash
+// code is cached in an array parallel to the keys; a probe compares cached
+// hash codes before falling back to a full string comparison, so unequal
+// string keys that collide cost one word compare instead of a strcmp.
+// Removing a key leaves a tombstone, which probes skip over and additions
+// reuse; growing (triggered when live keys plus tombstones exceed 3/4 of
+// capacity) rehashes into fresh arrays and drops all tombstones.
+
+#define Dict_Tally 0
+#define Dict_Keys 1
+#define Dict_Values 2
+#define Dict_Hashes 3
+#define Dict_Tombstones 4
+
+// Removed keys are replaced by a tombstone so later keys in the same probe
+// sequence remain reachable. Note: nil and true cannot be dictionary keys.
+#define Tombstone trueObj
+
 // ***** Helper Functions *****
 
-static inline int scanForKeyOrNil(OBJ keys, OBJ k) {
-	int keysSize = objWords(keys);
-	int i = obj2int(primHash(1, &k)) % keysSize;
-	int end = (i == 0) ? keysSize : i - 1;
+static inline int scanForKeyOrSlot(OBJ dict, OBJ k) {
+	// Return the index of the slot containing k if it is present. Otherwise,
+	// return the slot where k should be inserted: the first tombstone on its
+	// probe sequence, if any, or else the empty slot that ended the probe.
+
+	OBJ keys = FIELD(dict, Dict_Keys);
+	OBJ hashes = FIELD(dict, Dict_Hashes);
+	int mask = objWords(keys) - 1;
+	OBJ hash = primHash(1, &k);
 	char *keyString = IS_CLASS(k, StringClass) ? obj2str(k) : NULL;
-	while (true) {
+	int insertSlot = -1;
+	int i = obj2int(hash) & mask;
+	for (int probes = 0; probes <= mask; probes++) {
 		OBJ thisKey = FIELD(keys, i);
-		if (!thisKey || (thisKey == k)) return i; // found nil or a key identical to k
-		if (keyString && IS_CLASS(thisKey, StringClass)) {
+		if (!thisKey) return (insertSlot >= 0) ? insertSlot : i;
+		if (Tombstone == thisKey) {
+			if (insertSlot < 0) insertSlot = i;
+		} else if (thisKey == k) {
+			return i; // found a key identical to k
+		} else if (keyString && (hash == FIELD(hashes, i)) && IS_CLASS(thisKey, StringClass)) {
 			if (strcmp(keyString, obj2str(thisKey)) == 0) return i; // found an equal string key
 		}
-		if (i == end) return -1; // should never happen since dict grows before 100% full
-		i = (i + 1) % keysSize;
+		i = (i + 1) & mask;
 	}
-	return -1; // never gets here
+	return insertSlot; // should never happen since dict grows before 100% full
 }
 
 static void grow(OBJ dict) {
-	OBJ oldKeys = FIELD(dict, 1);
-	OBJ oldValues = FIELD(dict, 2);
+	// Rehash into fresh arrays, dropping all tombstones. Capacity doubles
+	// when the dictionary is more than half full of live keys; otherwise
+	// (i.e. when most slots were tombstones) it stays the same.
+
+	OBJ oldKeys = FIELD(dict, Dict_Keys);
+	OBJ oldValues = FIELD(dict, Dict_Values);
 	int oldSize = WORDS(oldKeys);
-	FIELD(dict, 0) = int2obj(0);
-	FIELD(dict, 1) = newArray(2 * oldSize);
-	FIELD(dict, 2) = newArray(2 * oldSize);
+	int newSize = ((2 * obj2int(FIELD(dict, Dict_Tally))) >= oldSize) ? (2 * oldSize) : oldSize;
+	FIELD(dict, Dict_Tally) = int2obj(0);
+	FIELD(dict, Dict_Tombstones) = int2obj(0);
+	FIELD(dict, Dict_Keys) = newArray(newSize);
+	FIELD(dict, Dict_Values) = newArray(newSize);
+	FIELD(dict, Dict_Hashes) = newArray(newSize);
 	for (int i = 0; i < oldSize; i++) {
 		OBJ k = FIELD(oldKeys, i);
-		if (k) dictAtPut(dict, k, FIELD(oldValues, i));
+		if (k && (Tombstone != k)) dictAtPut(dict, k, FIELD(oldValues, i));
 	}
 }
 
@@ -43,46 +79,77 @@ static void grow(OBJ dict) {
 
 OBJ newDict(int capacity) {
 	if (capacity < 4) capacity = 4;
-	OBJ dict = newObj(DictionaryClass, 3, nilObj);
-	FIELD(dict, 0) = int2obj(0);
-	FIELD(dict, 1) = newArray(capacity);
-	FIELD(dict, 2) = newArray(capacity);
+	while (capacity & (capacity - 1)) capacity += capacity & (-capacity); // round up to a power of two
+	OBJ dict = newObj(DictionaryClass, 5, nilObj);
+	FIELD(dict, Dict_Tally) = int2obj(0);
+	FIELD(dict, Dict_Keys) = newArray(capacity);
+	FIELD(dict, Dict_Values) = newArray(capacity);
+	FIELD(dict, Dict_Hashes) = newArray(capacity);
+	FIELD(dict, Dict_Tombstones) = int2obj(0);
 	return dict;
 }
 
 int dictCount(OBJ dict) {
 	if (NOT_CLASS(dict, DictionaryClass)) return 0;
-	return obj2int(FIELD(dict, 0));
+	return obj2int(FIELD(dict, Dict_Tally));
 }
 
 OBJ dictAt(OBJ dict, OBJ k) {
 	if (NOT_CLASS(dict, DictionaryClass)) return nilObj;
-	OBJ keys = FIELD(dict, 1);
-	OBJ values = FIELD(dict, 2);
-	int i = scanForKeyOrNil(keys, k);
+	int i = scanForKeyOrSlot(dict, k);
 	if (i < 0) return nilObj;
-	return FIELD(values, i);
+	OBJ foundKey = FIELD(FIELD(dict, Dict_Keys), i);
+	if (!foundKey || (Tombstone == foundKey)) return nilObj;
+	return FIELD(FIELD(dict, Dict_Values), i);
 }
 
 OBJ dictAtPut(OBJ dict, OBJ k, OBJ newValue) {
 	if (NOT_CLASS(dict, DictionaryClass)) return nilObj;
-	OBJ keys = FIELD(dict, 1);
-	OBJ values = FIELD(dict, 2);
-	int i = scanForKeyOrNil(keys, k);
+	if ((nilObj == k) || (Tombstone == k)) return nilObj; // nil and true cannot be keys
+	int i = scanForKeyOrSlot(dict, k);
 	if (i < 0) return nilObj;
-	FIELD(values, i) = newValue;
-	if (FIELD(keys, i) == nilObj) { // adding a new key
+	OBJ keys = FIELD(dict, Dict_Keys);
+	OBJ oldKey = FIELD(keys, i);
+	FIELD(FIELD(dict, Dict_Values), i) = newValue;
+	if (!oldKey || (Tombstone == oldKey)) { // adding a new key
 		FIELD(keys, i) = k;
-		int n = obj2int(FIELD(dict, 0)) + 1;
-		FIELD(dict, 0) = int2obj(n);
-		if ((3 * WORDS(keys)) < (4 * n)) grow(dict);
+		FIELD(FIELD(dict, Dict_Hashes), i) = primHash(1, &k);
+		int n = obj2int(FIELD(dict, Dict_Tally)) + 1;
+		FIELD(dict, Dict_Tally) = int2obj(n);
+		int tombstones = obj2int(FIELD(dict, Dict_Tombstones));
+		if (Tombstone == oldKey) {
+			FIELD(dict, Dict_Tombstones) = int2obj(--tombstones);
+		}
+		if ((3 * WORDS(keys)) < (4 * (n + tombstones))) grow(dict);
 	}
 	return newValue;
 }
 
+OBJ dictRemove(OBJ dict, OBJ k) {
+	// Remove the given key, replacing it with a tombstone so that other keys
+	// on the same probe sequence remain reachable. Return the removed value,
+	// or nil if the key was not present.
+
+	if (NOT_CLASS(dict, DictionaryClass)) return nilObj;
+	int i = scanForKeyOrSlot(dict, k);
+	if (i < 0) return nilObj;
+	OBJ keys = FIELD(dict, Dict_Keys);
+	OBJ foundKey = FIELD(keys, i);
+	if (!foundKey || (Tombstone == foundKey)) return nilObj; // not found
+	OBJ values = FIELD(dict, Dict_Values);
+	OBJ oldValue = FIELD(values, i);
+	FIELD(keys, i) = Tombstone;
+	FIELD(values, i) = nilObj;
+	FIELD(FIELD(dict, Dict_Hashes), i) = nilObj;
+	FIELD(dict, Dict_Tally) = int2obj(obj2int(FIELD(dict, Dict_Tally)) - 1);
+	FIELD(dict, Dict_Tombstones) = int2obj(obj2int(FIELD(dict, Dict_Tombstones)) + 1);
+	return oldValue;
+}
+
 gp_boolean dictHasKey(OBJ dict, OBJ k) {
 	if (NOT_CLASS(dict, DictionaryClass)) return false;
-	OBJ keys = FIELD(dict, 1);
-	int i = scanForKeyOrNil(keys, k);
-	return (FIELD(keys, i) != nilObj);
+	int i = scanForKeyOrSlot(dict, k);
+	if (i < 0) return false;
+	OBJ foundKey = FIELD(FIELD(dict, Dict_Keys), i);
+	return (foundKey != nilObj) && (Tombstone != foundKey);
 }
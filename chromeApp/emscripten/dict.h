@@ -4,5 +4,6 @@
 OBJ newDict(int capacity);
 OBJ dictAt(OBJ dict, OBJ k);
 OBJ dictAtPut(OBJ dict, OBJ k, OBJ newValue);
+OBJ dictRemove(OBJ dict, OBJ k);
 int dictCount(OBJ dict);
 gp_boolean dictHasKey(OBJ dict, OBJ k);
@@ -5,6 +5,13 @@
 // This allows the GP library, modules, user projects, and media files to be packaged into a
 // single "application" file.
 //
+// The Zip central directory is parsed once and kept in a hash table indexed
+// by file name, so repeated lookups (e.g. library and font loads at startup)
+// cost one hash probe instead of a linear directory scan. The Zip data itself
+// is read into memory once and entries are extracted directly from that
+// buffer: a stored entry costs a single copy into its GP object and a
+// deflated entry a single inflate, with no intermediate objects or seeks.
+//
 // Embedded file system primitives (implemented in prims.c):
 // 	- appPath
 //  - listEmbeddedFiles
@@ -30,7 +37,6 @@
 // Constants
 
 #define APP_PATH_SIZE 4096
-#define MAX_FILENAME 1024
 #define UNINITIALIZED -2
 #define NO_EMBEDDED_FS -1
 
@@ -42,39 +48,6 @@
 
 static long dataStart = UNINITIALIZED;
 
-// Utilities
-
-static int readInt16(FILE *f) {
-	int byte1 = fgetc(f);
-	int byte2 = fgetc(f);
-	return (byte2 << 8) | byte1;
-}
-
-static int readInt32(FILE *f) {
-	int byte1 = fgetc(f);
-	int byte2 = fgetc(f);
-	int byte3 = fgetc(f);
-	int byte4 = fgetc(f);
-	return (byte4 << 24) | (byte3 << 16)| (byte2 << 8) | byte1;
-}
-
-static void readStringInto(FILE *f, int byteCount, char *s, int maxSize) {
-	// Read a string of the given size into s. If byteCount is greater than maxSize,
-	// truncate s, but consume byteCount bytes from f.
-
-	maxSize--; // leave room for string terminator
-	char *dst = s;
-	for (int i = 0; i < byteCount; i++) {
-		char ch = fgetc(f);
-		if (i < maxSize) *dst++ = ch;
-	}
-	*dst = 0; // string terminator
-}
-
-static void skip(FILE *f, long byteCount) {
-	fseek(f, byteCount, SEEK_CUR);
-}
-
 static long findDataStart(FILE *f) {
 	// Return the start of the embedded file system (a Zip file), if there is one.
 	// The start of the embedded file system is marked by the string 'GPFS'
@@ -157,34 +130,71 @@ static int getAppPath(char *path, int pathSize) {
 	return true;
 }
 
-// Zip file operations
+// Embedded File Index
+
+typedef struct {
+	char *name;
+	unsigned int nameHash;
+	long offset; // offset of the local file entry, relative to the start of the Zip data
+	int next; // index of the next entry in the same hash bucket, or -1
+} ZipEntry;
+
+static unsigned char *zipData = NULL; // contents of the embedded Zip file; immutable once read
+static long zipDataSize = 0;
+static ZipEntry *zipEntries = NULL;
+static int zipEntryCount = 0;
+static int *zipBuckets = NULL;
+static int zipBucketMask = 0;
+
+static inline int get16(unsigned char *p) { return (p[1] << 8) | p[0]; }
+static inline long get32(unsigned char *p) {
+	return ((long) p[3] << 24) | ((long) p[2] << 16) | ((long) p[1] << 8) | p[0];
+}
+
+static unsigned int nameHash(char *s) {
+	unsigned int hash = 2166136261u; // FNV-1a
+	while (*s) hash = (hash ^ (unsigned char) *s++) * 16777619;
+	return hash;
+}
 
-static int findZipDirectory(FILE *f, long *dirStartPos) {
-	// If an EndOfCentralDirectory record is found, set dirStartPos to the
-	// file position of the directory and return the number of entries.
-	// If not found, return -1.
+static gp_boolean readZipData(FILE *f) {
+	// Read the embedded Zip file into zipData. Return true on success.
 
-	// Scan backwards from the end of the data to the last EndOfCentralDiretory record.
 	fseek(f, 0, SEEK_END);
-	long pos = ftell(f) - 4;
+	zipDataSize = ftell(f) - dataStart;
+	if (zipDataSize <= 0) return false;
+	zipData = malloc(zipDataSize);
+	if (!zipData) return false;
+	fseek(f, dataStart, SEEK_SET);
+	if (fread(zipData, 1, zipDataSize, f) != zipDataSize) {
+		free(zipData);
+		zipData = NULL;
+		return false;
+	}
+	return true;
+}
+
+static int findZipDirectory(long *dirStartPos) {
+	// If an EndOfCentralDirectory record is found in the Zip data, set
+	// dirStartPos to the offset of the directory and return the number of
+	// entries. If not found, set dirStartPos to -1 and return 0.
+
+	// Scan backwards from the end of the data to the last EndOfCentralDiretory record.
+	long pos = zipDataSize - 22; // an EndOfCentralDirectory record is at least 22 bytes
 	while (pos >= 0) {
-		fseek(f, pos, SEEK_SET);
-		if (80 == fgetc(f)) { // found first byte of possible endID
-			fseek(f, pos, SEEK_SET);
-			if (END_ID == readInt32(f)) break;
-		}
+		if ((0x50 == zipData[pos]) && (END_ID == get32(zipData + pos))) break;
 		pos--;
 	}
 	if (pos < 0) { // EndOfCentralDiretory record not found
 		*dirStartPos = -1;
 		return 0;
 	}
-	int thisDiskNum = readInt16(f);
-	int startDiskNum = readInt16(f);
-	int entriesOnThisDisk = readInt16(f);
-	int totalEntries = readInt16(f);
-	readInt32(f); // directorySize
-	int directoryOffset = readInt32(f);
+	unsigned char *p = zipData + pos + 4;
+	int thisDiskNum = get16(p);
+	int startDiskNum = get16(p + 2);
+	int entriesOnThisDisk = get16(p + 4);
+	int totalEntries = get16(p + 6);
+	long directoryOffset = get32(p + 12);
 
 	if ((thisDiskNum != startDiskNum) || (entriesOnThisDisk != totalEntries)) {
 		*dirStartPos = -1;
@@ -194,73 +204,109 @@ static int findZipDirectory(FILE *f, long *dirStartPos) {
 	return totalEntries;
 }
 
-static long readDirEntry(FILE *f, char *name, int nameMax) {
-	// Read a directory file entry from f. Assume f is positioned at the start of an entry.
-	// Store the file name in name (up to nameMax characters) and return the file size.
+static gp_boolean buildZipIndex(FILE *f) {
+	// Read the Zip data and build the file name index. Done only once;
+	// later calls return immediately. Return true if the index is usable.
+
+	if (zipEntries) return true; // already built
+	dataStart = findDataStart(f);
+	if (dataStart < 0) return false; // no embedded FS
+	if (!zipData && !readZipData(f)) return false;
+
+	long directoryStart;
+	int entryCount = findZipDirectory(&directoryStart);
+	if ((entryCount <= 0) || (directoryStart <= 0)) return false; // no directory
+
+	zipEntries = calloc(entryCount, sizeof(ZipEntry));
+	if (!zipEntries) return false;
+
+	int bucketCount = 16;
+	while (bucketCount < (2 * entryCount)) bucketCount *= 2;
+	zipBucketMask = bucketCount - 1;
+	zipBuckets = malloc(bucketCount * sizeof(int));
+	if (!zipBuckets) {
+		free(zipEntries);
+		zipEntries = NULL;
+		return false;
+	}
+	for (int i = 0; i < bucketCount; i++) zipBuckets[i] = -1;
+
+	unsigned char *p = zipData + directoryStart;
+	unsigned char *end = zipData + zipDataSize;
+	for (int i = 0; i < entryCount; i++) {
+		if (((p + 46) > end) || (DIR_ENTRY_ID != get32(p))) break; // bad directory entry
+		int nameLength = get16(p + 28);
+		int extraLength = get16(p + 30);
+		int commentLength = get16(p + 32);
+		long offset = get32(p + 42);
+		if ((p + 46 + nameLength) > end) break;
+
+		ZipEntry *e = &zipEntries[zipEntryCount];
+		e->name = malloc(nameLength + 1);
+		if (!e->name) break;
+		memcpy(e->name, p + 46, nameLength);
+		e->name[nameLength] = 0;
+		e->nameHash = nameHash(e->name);
+		e->offset = offset;
+
+		int b = e->nameHash & zipBucketMask;
+		e->next = zipBuckets[b];
+		zipBuckets[b] = zipEntryCount;
+		zipEntryCount++;
+
+		p += 46 + nameLength + extraLength + commentLength;
+	}
+	return (zipEntryCount > 0);
+}
+
+static ZipEntry* findZipEntry(char *fileName) {
+	// Return the index entry for the given file name or NULL if not found.
 
-	if (DIR_ENTRY_ID != readInt32(f)) {  // bad directory entry
-		name[0] = 0; // null terminate
-		return -1;
+	if (!zipEntries) return NULL;
+	unsigned int hash = nameHash(fileName);
+	for (int i = zipBuckets[hash & zipBucketMask]; i >= 0; i = zipEntries[i].next) {
+		ZipEntry *e = &zipEntries[i];
+		if ((e->nameHash == hash) && (strcmp(e->name, fileName) == 0)) return e;
 	}
-	readInt16(f); // versionMadeBy
-	readInt16(f); // versionNeeded
-	readInt16(f); // flags
-	readInt16(f); // compressionMethod
-	readInt32(f); // dosTime
-	readInt32(f); // crc
-	readInt32(f); // compressedSize
-	readInt32(f); // uncompressedSize
-	int nameLength = readInt16(f);
-	int extraLength = readInt16(f);
-	int commentLength = readInt16(f);
-	readInt16(f); // diskNum
-	readInt16(f); // internalAttributes
-	readInt32(f); // externalAttributes
-	long offset = (unsigned) readInt32(f);
-	readStringInto(f, nameLength, name, nameMax);
-	skip(f, extraLength + commentLength);
-	return offset;
+	return NULL;
 }
 
-static OBJ extractFileData(FILE *f, long fileEntryPos, int isBinary) {
-	// Extract the file from the file entry at the given position, decompressing if necessary.
-	// Return the file contents or nil if extraction fails.
-
-	fseek(f, fileEntryPos, SEEK_SET);
-	if (FILE_ENTRY_ID != readInt32(f)) return nilObj;  // bad local file header
-	readInt16(f); // versionNeeded
-	int flags = readInt16(f);
-	int compressionMethod = readInt16(f);
-	readInt32(f); // dosTime
-	int crc = readInt32(f);
-	unsigned compressedSize = (unsigned) readInt32(f);
-	unsigned uncompressedSize = (unsigned) readInt32(f);
-	int nameLength = readInt16(f);
-	int extraLength = readInt16(f);
-	skip(f, nameLength + extraLength);
+static OBJ extractEntryData(ZipEntry *entry, int isBinary) {
+	// Extract the given file, decompressing if necessary. Data flows directly
+	// from the in-memory Zip buffer into the resulting object; nothing else
+	// is allocated. Return the file contents or nil if extraction fails.
+
+	unsigned char *p = zipData + entry->offset;
+	if (((p + 30) > (zipData + zipDataSize)) || (FILE_ENTRY_ID != get32(p))) {
+		return nilObj; // bad local file header
+	}
+	int flags = get16(p + 6);
+	int compressionMethod = get16(p + 8);
+	unsigned crc = (unsigned) get32(p + 14);
+	unsigned compressedSize = (unsigned) get32(p + 18);
+	unsigned uncompressedSize = (unsigned) get32(p + 22);
+	int nameLength = get16(p + 26);
+	int extraLength = get16(p + 28);
+	unsigned char *data = p + 30 + nameLength + extraLength;
 
 	if (flags != 0) return nilObj; // unexpected Zip file format
 	if (!((0 == compressionMethod) || (8 == compressionMethod))) return nilObj; // unknown compressionMethod
 	if (0 == compressedSize) return nilObj; // no data (e.g. a directory entry)
+	if ((data + compressedSize) > (zipData + zipDataSize)) return nilObj; // data truncated
 
-	OBJ result = isBinary ? newBinaryData(compressedSize) : allocateString(compressedSize);
+	if (!canAllocate((uncompressedSize + 3) / 4)) return nilObj;
+	OBJ result = isBinary ? newBinaryData(uncompressedSize) : allocateString(uncompressedSize);
 	if (!result) return nilObj;
 
-	int bytesRead = fread(&FIELD(result, 0), 1, compressedSize, f);
-	if (bytesRead != compressedSize) return nilObj;
-
-	if (8 == compressionMethod) { // decompress the data
-		OBJ compressed = result;
-		if (!canAllocate((uncompressedSize + 3) / 4)) return nilObj;
-		result = isBinary ? newBinaryData(uncompressedSize) : allocateString(uncompressedSize);
-		if (!result) return nilObj;
-
+	if (0 == compressionMethod) { // stored; compressedSize == uncompressedSize
+		memcpy(&FIELD(result, 0), data, uncompressedSize);
+	} else { // decompress the data
 		z_stream infstream;
 		infstream.zalloc = NULL;
 		infstream.zfree = NULL;
 		infstream.opaque = NULL;
 		infstream.avail_in = compressedSize;
-		infstream.next_in = (unsigned char *) &FIELD(compressed, 0);
+		infstream.next_in = data;
 		infstream.avail_out = uncompressedSize;
 		infstream.next_out = (unsigned char *) &FIELD(result, 0);
 
@@ -301,34 +347,22 @@ static void loadGPFile(char *fileName, OBJ fileContents) {
 }
 
 static gp_boolean loadLibraryFrom(FILE *f) {
-	dataStart = findDataStart(f);
-	if (dataStart < 0) return false; // no embedded FS
-
-	long directoryStart;
-	int entryCount = findZipDirectory(f, &directoryStart);
-	if (entryCount < 0) return false; // no directory
+	if (!buildZipIndex(f)) return false; // no embedded FS or no directory
 
 	// load all files in the /lib folder (including .gp and .gpm)
 	gp_boolean hasLibrary = false;
-	char fileName[MAX_FILENAME];
-	if ((entryCount > 0) && (directoryStart > 0)) {
-		fseek(f, dataStart + directoryStart, SEEK_SET);
-		for (int i = 0; i < entryCount; i++) {
-			long offset = readDirEntry(f, fileName, MAX_FILENAME);
-			if ((offset != -1) && (strstr(fileName, "lib/") == fileName)) {
-				long p = ftell(f);
-				OBJ fileContents = extractFileData(f, dataStart + offset, false);
-				loadGPFile(fileName, fileContents);
-				fseek(f, p, SEEK_SET);
-				hasLibrary = true; // has a lib folder
-			}
+	for (int i = 0; i < zipEntryCount; i++) {
+		ZipEntry *e = &zipEntries[i];
+		if (strstr(e->name, "lib/") == e->name) {
+			loadGPFile(e->name, extractEntryData(e, false));
+			hasLibrary = true; // has a lib folder
 		}
 	}
 	if (!hasLibrary) return false;
 
 	// load "startup.gp" if it exists
-	OBJ startupFile = extractEmbeddedFile(f, "startup.gp", false);
-	if (startupFile) loadGPFile("startup.gp", startupFile);
+	ZipEntry *startupEntry = findZipEntry("startup.gp");
+	if (startupEntry) loadGPFile("startup.gp", extractEntryData(startupEntry, false));
 	return true;
 }
 
@@ -341,42 +375,20 @@ OBJ appPath() {
 }
 
 OBJ embeddedFileList(FILE *f) {
-	dataStart = findDataStart(f);
-	if (dataStart < 0) return newArray(0); // no embedded FS
-
-	long directoryStart;
-	int entryCount = findZipDirectory(f, &directoryStart);
-	if (entryCount < 0) return newArray(0); // no directory
+	if (!buildZipIndex(f)) return newArray(0); // no embedded FS or no directory
 
-	OBJ result = newArray(entryCount);
-	char entryFileName[MAX_FILENAME];
-	fseek(f, dataStart + directoryStart, SEEK_SET);
-	for (int i = 0; i < entryCount; i++) {
-		readDirEntry(f, entryFileName, MAX_FILENAME);
-		FIELD(result, i) = newString(entryFileName);
+	OBJ result = newArray(zipEntryCount);
+	for (int i = 0; i < zipEntryCount; i++) {
+		FIELD(result, i) = newString(zipEntries[i].name);
 	}
 	return result;
 }
 
 OBJ extractEmbeddedFile(FILE *f, char *fileName, int isBinary) {
-	dataStart = findDataStart(f);
-	if (dataStart < 0) return nilObj; // no embedded FS
+	if (!buildZipIndex(f)) return nilObj; // no embedded FS or no directory
 
-	long directoryStart;
-	int entryCount = findZipDirectory(f, &directoryStart);
-	if (entryCount < 0) return nilObj; // no directory
-
-	char entryFileName[MAX_FILENAME];
-	if ((entryCount > 0) && (directoryStart > 0)) {
-		fseek(f, dataStart + directoryStart, SEEK_SET);
-		for (int i = 0; i < entryCount; i++) {
-			long offset = readDirEntry(f, entryFileName, MAX_FILENAME);
-			if ((offset != -1) && (strcmp(fileName, entryFileName) == 0)) {
-				return extractFileData(f, dataStart + offset, isBinary);
-			}
-		}
-	}
-	return nilObj;
+	ZipEntry *entry = findZipEntry(fileName);
+	return entry ? extractEntryData(entry, isBinary) : nilObj;
 }
 
 gp_boolean importLibrary() {
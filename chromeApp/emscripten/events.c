@@ -202,9 +202,14 @@ OBJ getEvent() {
 			dictAtPut(dict, key(_keymodifiers), int2obj(evt[4]));
 			break;
 		case MOUSE_MOVE:
+			// Consecutive move events are coalesced as they are queued in
+			// gpSupport.js: the event carries the latest position plus the
+			// movement deltas accumulated since the previous delivered event.
 			dictAtPut(dict, key(_type), key(type_mousemove));
 			dictAtPut(dict, key(_x), int2obj(evt[1]));
 			dictAtPut(dict, key(_y), int2obj(evt[2]));
+			dictAtPut(dict, key(_dx), int2obj((evtLen > 3) ? (int) evt[3] : 0));
+			dictAtPut(dict, key(_dy), int2obj((evtLen > 4) ? (int) evt[4] : 0));
 			break;
 		case MOUSE_WHEEL:
 			dictAtPut(dict, key(_type), key(type_mousewheel));
@@ -243,6 +248,10 @@ OBJ getEvent() {
 			dictAtPut(dict, key(_x), int2obj(evt[1]));
 			dictAtPut(dict, key(_y), int2obj(evt[2]));
 			dictAtPut(dict, key(_button), int2obj(evt[3]));
+			if (type_mousemove == evtType) { // coalesced movement deltas; see gpSupport.js
+				dictAtPut(dict, key(_dx), int2obj((evtLen > 4) ? (int) evt[4] : 0));
+				dictAtPut(dict, key(_dy), int2obj((evtLen > 5) ? (int) evt[5] : 0));
+			}
 			break;
 	}
 	return dict;
@@ -337,12 +346,34 @@ OBJ getEvent() {
 	dictAtPut(dict, key(_type), int2obj(event.type));
 	dictAtPut(dict, key(_timestamp), int2obj(event.common.timestamp));
 	switch (event.type) {
-		case SDL_MOUSEMOTION:
+		case SDL_MOUSEMOTION: {
+			// Coalesce any directly following motion events: fast drags can
+			// queue many motions per frame, and delivering them all makes
+			// dragging lag behind the cursor. The merged event keeps the
+			// latest position and accumulates the movement deltas. Only
+			// events at the head of the queue are consumed, so motions are
+			// never reordered relative to clicks or other events.
+			int dx = event.motion.xrel;
+			int dy = event.motion.yrel;
+			SDL_Event next;
+			while (SDL_PeepEvents(&next, 1, SDL_PEEKEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT) > 0) {
+				if ((next.type != SDL_MOUSEMOTION) ||
+					(next.motion.windowID != event.motion.windowID)) {
+						break;
+				}
+				SDL_PeepEvents(&next, 1, SDL_GETEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT);
+				event.motion = next.motion; // keep the latest position
+				dx += next.motion.xrel;
+				dy += next.motion.yrel;
+			}
 			dictAtPut(dict, key(_type), key(type_mousemove));
 			dictAtPut(dict, key(_windowID), int2obj(event.motion.windowID));
 			dictAtPut(dict, key(_x), int2obj(event.motion.x * mouseScale));
 			dictAtPut(dict, key(_y), int2obj(event.motion.y * mouseScale));
+			dictAtPut(dict, key(_dx), int2obj(dx * mouseScale));
+			dictAtPut(dict, key(_dy), int2obj(dy * mouseScale));
 			break;
+		}
 		case SDL_MOUSEBUTTONDOWN:
 		case SDL_MOUSEBUTTONUP:
 			dictAtPut(dict, key(_type), key((event.type == SDL_MOUSEBUTTONDOWN) ? type_mousedown : type_mouseup));
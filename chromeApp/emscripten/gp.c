@@ -9,6 +9,7 @@
 #include "interp.h"
 #include "oop.h"
 #include "parse.h"
+#include "snapshot.h"
 
 #ifdef EMSCRIPTEN
   #include <emscripten.h>
@@ -23,6 +24,12 @@
 
 char argv0[1024]; // copy of argv[0]
 
+// If a snapshot image is found at startup it is loaded in place of the GP
+// library sources; see snapshot.c. The image is written by the saveSnapshot
+// primitive and can simply be deleted to return to parsing the sources.
+#define SNAPSHOT_FILE "runtime/snapshot.gpimg"
+static gp_boolean snapshotLoaded = false;
+
 // ***** Read-Eval Loop *****
 
 #define LINE_SIZE 500
@@ -279,7 +286,7 @@ static gp_boolean processCommandLine(int argc, char *argv[], char *prefix) {
 	if (!interactiveFlag) ShowWindow(GetConsoleWindow(), SW_MINIMIZE);
 #endif
 
-	if ((argc == 1) || interactiveFlag) {
+	if (((argc == 1) || interactiveFlag) && !snapshotLoaded) {
 		// read library if no arguments or just "-"
 		#if !defined(EMSCRIPTEN)
 			gp_boolean hasEmbeddedLibrary = importLibrary();
@@ -326,7 +333,12 @@ int main(int argc, char *argv[]) {
 
 	int interactiveFlag = false;
 	memInit(MEM_SIZE); // megabytes
-	initGP();
+	snapshotLoaded = loadSnapshot(SNAPSHOT_FILE);
+	if (snapshotLoaded) {
+		initGPRuntime(); // rebuild C runtime state not recorded in the snapshot
+	} else {
+		initGP();
+	}
 	readingLibrary = true;
 
 #if defined(EMSCRIPTEN)
@@ -347,7 +359,7 @@ int main(int argc, char *argv[]) {
 	// to test loading the library from the embedded file system in Node.
 
 	if (isInBrowser || (argc == 1)) {
-		loadLibInBrowser();
+		if (!snapshotLoaded) loadLibInBrowser();
 	} else {
 		interactiveFlag = processCommandLine(argc, argv, "/external");
 	}
@@ -93,15 +93,24 @@ static BOOL WINAPI winInterruptHandler(DWORD type) {
 #endif
 
 void initGP() {
-	gettimeofday(&startTime, NULL);
-	srand(startTime.tv_usec);
-
 	vmRoots = newArray(30); // vmRoots must be first object, so it doesn't move when memory is compacted
 
 	emptyArray = newObj(ArrayClass, 0, nilObj); // shared canonical empty array
 	sharedStrings = newDict(10000);
 	initVMClasses();
 	eventKeys = newArray(0);
+	initGPRuntime();
+}
+
+void initGPRuntime() {
+	// Initialize the C-side runtime state: the random seed, primitive plugins
+	// and tables, method cache, and interrupt handlers. Called from initGP()
+	// on a normal startup and directly after loading a snapshot image, which
+	// restores the object memory but not C state such as the primitive
+	// function pointers in the primitive dictionary.
+
+	gettimeofday(&startTime, NULL);
+	srand(startTime.tv_usec);
 	loadPrimitivePlugins();
 	initPrimitiveTable();
 	methodCacheClear();
@@ -131,7 +140,7 @@ void saveVMRoots() {
 	FIELD(vmRoots, 16) = currentModule;
 	FIELD(vmRoots, 17) = consoleModule;
 	FIELD(vmRoots, 18) = currentTask;
-	FIELD(vmRoots, 19) = methodCache;
+	FIELD(vmRoots, 19) = nilObj; // spare; was the methodCache dictionary, now a C table in cache.c
 	FIELD(vmRoots, 20) = primitiveDictionary;
 }
 
@@ -147,7 +156,6 @@ void restoreVMRoots() {
 	currentModule = FIELD(vmRoots, 16);
 	consoleModule = FIELD(vmRoots, 17);
 	currentTask = FIELD(vmRoots, 18);
-	methodCache = FIELD(vmRoots, 19);
 	primitiveDictionary = FIELD(vmRoots, 20);
 }
 
@@ -580,8 +588,19 @@ OBJ run(OBJ startBlockOrTask) {
 			// Look up the primitive if either b->prim is NULL OR
 			// the receiver class has changed and p->prim is not a
 			// primitive that is independent of the receiver:
-			b->prim = findPrim(b->primName, args[0], (nargs != 0));
-			b->cache = nilObj;
+			OBJ method = nilObj;
+			if ((((void*) CALL) == b->prim) && nargs) {
+				// polymorphic method call site: try to re-bind the inline cache
+				// with a single global method cache lookup; fall back to the full
+				// primitive search only if the new receiver class has no method
+				method = findMethod(b->primName, args[0], true, currentModule);
+			}
+			if (method) {
+				b->cache = method;
+			} else {
+				b->prim = findPrim(b->primName, args[0], (nargs != 0));
+				b->cache = nilObj;
+			}
 			b->classIDCache = int2obj(nargs ? objClass(args[0]) : 0);
 		}
 		// Uncomment the following line to trace the interpreter:
@@ -122,6 +122,7 @@ typedef void (*EntryFunction)(PrimEntry *entry);
 // Function Declarations
 
 void initGP();
+void initGPRuntime();
 void initPrimitiveTable();
 void loadPrimitivePlugins();
 int recordCommandLine(int argc, char *argv[]);
@@ -4,6 +4,7 @@
 #include <setjmp.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "jpeglib.h"
 
@@ -95,6 +96,103 @@ static inline int isBitmap(OBJ bitmap) {
 		IS_CLASS(FIELD(bitmap, 2), BinaryDataClass);
 }
 
+//******** Decoded Image Cache ********
+
+// Recently decoded bitmaps are kept in a small LRU cache so that an image
+// rendered repeatedly (e.g. thumbnails in a project browser) is decoded only
+// once per scale. Entries are keyed by a hash of the compressed data plus the
+// scale denominator rather than by object reference, since objects move when
+// memory is compacted. Decoded pixels live in C memory; a cache hit copies
+// them into a fresh bitmap object without touching the JPEG decoder.
+
+#define JPEG_CACHE_ENTRIES 16
+#define JPEG_CACHE_BYTE_LIMIT (16 * 1024 * 1024)
+
+typedef struct {
+	unsigned long long hash; // hash of the compressed data; 0 if entry is empty
+	unsigned int byteCount; // compressed data size, a cheap second check
+	int denom; // scale denominator used for the decode
+	int width, height;
+	int *pixels; // malloc'ed buffer of (width * height) ARGB words
+	unsigned int lastUsed;
+} JPEGCacheEntry;
+
+static JPEGCacheEntry jpegCache[JPEG_CACHE_ENTRIES];
+static unsigned int jpegCacheBytes = 0;
+static unsigned int jpegCacheClock = 0;
+
+static unsigned long long jpegDataHash(unsigned char *data, long byteCount) {
+	unsigned long long hash = 14695981039346656037ULL; // FNV-1a
+	for (long i = 0; i < byteCount; i++) {
+		hash = (hash ^ data[i]) * 1099511628211ULL;
+	}
+	if (!hash) hash = 1; // zero marks an empty entry
+	return hash;
+}
+
+static JPEGCacheEntry* jpegCacheLookup(unsigned long long hash, unsigned int byteCount, int denom) {
+	for (int i = 0; i < JPEG_CACHE_ENTRIES; i++) {
+		JPEGCacheEntry *e = &jpegCache[i];
+		if ((e->hash == hash) && (e->byteCount == byteCount) && (e->denom == denom)) {
+			e->lastUsed = ++jpegCacheClock;
+			return e;
+		}
+	}
+	return NULL;
+}
+
+static void jpegCacheEvict(JPEGCacheEntry *e) {
+	free(e->pixels);
+	jpegCacheBytes -= 4 * e->width * e->height;
+	memset(e, 0, sizeof(JPEGCacheEntry));
+}
+
+static void jpegCacheInsert(unsigned long long hash, unsigned int byteCount, int denom, int w, int h, int *pixels) {
+	// Add a decoded image to the cache, taking ownership of the pixel buffer.
+	// Evicts least recently used entries as needed to stay within the byte limit.
+
+	unsigned int pixelBytes = 4 * w * h;
+	if (pixelBytes > JPEG_CACHE_BYTE_LIMIT) { free(pixels); return; } // too large to cache
+
+	while (true) {
+		JPEGCacheEntry *victim = NULL;
+		int hasFreeEntry = false;
+		for (int i = 0; i < JPEG_CACHE_ENTRIES; i++) {
+			JPEGCacheEntry *e = &jpegCache[i];
+			if (!e->hash) { hasFreeEntry = true; continue; }
+			if (!victim || (e->lastUsed < victim->lastUsed)) victim = e;
+		}
+		if (hasFreeEntry && ((jpegCacheBytes + pixelBytes) <= JPEG_CACHE_BYTE_LIMIT)) break;
+		if (!victim) break; // cache is empty yet still over the limit; cannot happen
+		jpegCacheEvict(victim);
+	}
+	for (int i = 0; i < JPEG_CACHE_ENTRIES; i++) {
+		JPEGCacheEntry *e = &jpegCache[i];
+		if (!e->hash) {
+			e->hash = hash;
+			e->byteCount = byteCount;
+			e->denom = denom;
+			e->width = w;
+			e->height = h;
+			e->pixels = pixels;
+			e->lastUsed = ++jpegCacheClock;
+			jpegCacheBytes += pixelBytes;
+			return;
+		}
+	}
+	free(pixels); // no free entry; should not happen
+}
+
+static OBJ bitmapFromPixels(int *pixels, int w, int h) {
+	OBJ bitmapData = newBinaryObj(BinaryDataClass, (w * h));
+	memcpy(&FIELD(bitmapData, 0), pixels, 4 * w * h);
+	OBJ bitmap = newInstance(newString("Bitmap"), 0);
+	FIELD(bitmap, 0) = int2obj(w);
+	FIELD(bitmap, 1) = int2obj(h);
+	FIELD(bitmap, 2) = bitmapData;
+	return bitmap;
+}
+
 //******** Primitives ********
 
 static OBJ primJPEGEncode(int nargs, OBJ args[]) {
@@ -140,8 +238,21 @@ static OBJ primJPEGDecode(int nargs, OBJ args[]) {
 	}
 	long byteCount = objBytes(data);
 
+	// The optional scale denominator (1, 2, 4, or 8) decodes the image at
+	// 1/2, 1/4, or 1/8 size directly in the DCT domain, so a thumbnail never
+	// pays the full-resolution decoding cost.
+	int denom = intArg(1, 1, nargs, args);
+	if ((denom != 1) && (denom != 2) && (denom != 4) && (denom != 8)) {
+		return primFailed("Scale denominator must be 1, 2, 4, or 8");
+	}
+
+	unsigned long long hash = jpegDataHash((unsigned char *) &FIELD(data, 0), byteCount);
+	JPEGCacheEntry *cached = jpegCacheLookup(hash, byteCount, denom);
+	if (cached) return bitmapFromPixels(cached->pixels, cached->width, cached->height);
+
 	struct my_error_mgr jerr;
 	struct jpeg_decompress_struct cinfo;
+	int * volatile pixels = NULL; // volatile: still live after a longjmp from the error handler
 
 	// set up the normal JPEG error routines, then override error_exit
 	cinfo.err = jpeg_std_error(&jerr.pub);
@@ -149,6 +260,7 @@ static OBJ primJPEGDecode(int nargs, OBJ args[]) {
 	if (setjmp(jerr.setjmp_buffer)) {
 		// if we get here, the JPEG code raised an error
 		jpeg_destroy_decompress(&cinfo);
+		if (pixels) free(pixels);
 		return 0;
 	}
 
@@ -156,34 +268,28 @@ static OBJ primJPEGDecode(int nargs, OBJ args[]) {
 	jpeg_create_decompress(&cinfo);
 	jpeg_mem_src(&cinfo, (unsigned char *) &FIELD(data, 0), byteCount);
 	(void) jpeg_read_header(&cinfo, TRUE);
-
-	int w = cinfo.image_width;
-	int h = cinfo.image_height;
-	OBJ bitmapData = newBinaryObj(BinaryDataClass, (w * h));
-	OBJ bitmap = newInstance(newString("Bitmap"), 0);
-	FIELD(bitmap, 0) = int2obj(w);
-	FIELD(bitmap, 1) = int2obj(h);
-	FIELD(bitmap, 2) = bitmapData;
-
+	cinfo.scale_num = 1;
+	cinfo.scale_denom = denom;
 	(void) jpeg_start_decompress(&cinfo);
 
-	// create a one-scanline buffer (freed when the decompressor is destroyed)
-	int stride = cinfo.output_width * cinfo.output_components;
-	if (cinfo.output_width != w) {
+	int w = cinfo.output_width;
+	int h = cinfo.output_height;
+	pixels = malloc(4 * w * h);
+	if (!pixels) {
 		jpeg_destroy_decompress(&cinfo);
-		return primFailed("Unexpected output width in jpegDecode");
+		return outOfMemoryFailure();
 	}
+
+	// create a one-scanline buffer (freed when the decompressor is destroyed)
+	int stride = cinfo.output_width * cinfo.output_components;
 	JSAMPARRAY buffer = (*cinfo.mem->alloc_sarray) ((j_common_ptr) &cinfo, JPOOL_IMAGE, stride, 1);
 
 	// decompress one scanline at a time
-	int *base = (int *) &FIELD(bitmapData, 0);
-	int *limit =  base + (w * h);
 	while (cinfo.output_scanline < cinfo.output_height) {
 		(void) jpeg_read_scanlines(&cinfo, buffer, 1);
 		unsigned char *src = buffer[0];
-		int *dst = (base + (w * (cinfo.output_scanline - 1)));
+		int *dst = pixels + (w * (cinfo.output_scanline - 1));
 		int *end = dst + w;
-		if (end > limit) end = limit;
 		while (dst < end) {
 			int r = *src++;
 			int g = *src++;
@@ -194,13 +300,15 @@ static OBJ primJPEGDecode(int nargs, OBJ args[]) {
 	(void) jpeg_finish_decompress(&cinfo);
 	jpeg_destroy_decompress(&cinfo);
 
+	OBJ bitmap = bitmapFromPixels(pixels, w, h);
+	jpegCacheInsert(hash, byteCount, denom, w, h, pixels); // cache takes ownership of pixels
 	return bitmap;
 }
 
 PrimEntry jpegPrimList[] = {
 	{"-----", NULL, "JPEG"},
 	{"jpegEncode",		primJPEGEncode,		"Encode a bitmap as JPEG and return the binary data. Optional quality setting is 0 to 100. Arguments: bitmap [quality]"},
-	{"jpegDecode",		primJPEGDecode,		"Decode JPEG data and return a bitmap. Arguments: jpegData"},
+	{"jpegDecode",		primJPEGDecode,		"Decode JPEG data and return a bitmap. Decoded bitmaps are cached, so repeated decodes of the same data are fast. The optional scale denominator (1, 2, 4, or 8) decodes the image at reduced size for thumbnails. Arguments: jpegData [scaleDenominator]"},
 };
 
 PrimEntry* jpegPrimitives(int *primCount) {
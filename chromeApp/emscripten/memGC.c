@@ -5,6 +5,7 @@
 #include <sys/time.h>
 #include <string.h>
 #include "mem.h"
+#include "cache.h"
 #include "interp.h"
 
 #define DEBUG false
@@ -20,6 +21,28 @@ static gp_boolean markStackOverflowed;
 static OBJ weakObjectsArray[WeakObjectsSize];
 static ADDR weakObjectsPtr;
 
+// Generational GC State
+//
+// Since the heap is allocated sequentially, the nursery is simply the portion
+// of the heap at or above nurseryStart -- everything allocated since the last
+// collection. A minor collection traces and compacts only that region, then
+// promotes all survivors by advancing nurseryStart. There is no write barrier:
+// old-to-nursery references are found with a single linear (non-tracing) pass
+// over the old generation, and the old objects holding them are recorded in
+// rememberedSet so that only those objects need pointer updates afterwards.
+
+static OBJ nurseryStart = 0;
+static int minorGCsSinceFullGC = 0;
+static gp_boolean minorGCInProgress = false;
+
+#define RememberedSetSize 1000
+static OBJ rememberedSet[RememberedSetSize];
+static int rememberedCount = 0;
+static gp_boolean rememberedSetOverflowed = false;
+
+// do a full collection after this many consecutive minor ones
+#define FullGCInterval 50
+
 // ***** Utility Functions *****
 
 #define MarkAndDoneBits 0x30000000
@@ -30,6 +53,7 @@ static ADDR weakObjectsPtr;
 
 static inline int isMemoryObj(OBJ obj) { return ((obj & 1) == 0) && (obj > falseObj); }
 static inline int notFreeChunk(OBJ ptr) { return *O2A(ptr) != 0; }
+static inline int inNursery(OBJ obj) { return obj >= nurseryStart; }
 
 int isMarked(OBJ obj) { return (*O2A(obj) & MarkBit) != 0; }
 static inline int isMarkingDone(OBJ obj) { return (*O2A(obj) & MarkingDoneBit) != 0; }
@@ -84,7 +108,7 @@ static void clearAllMarkBits() {
 
 static void markClass(OBJ obj) {
 	OBJ cls = FIELD(classes, objClass(obj) - 1);
-	if (!isMarked(cls)) {
+	if (!isMarked(cls) && !(minorGCInProgress && !inNursery(cls))) {
 		setMark(cls);
 		if (DEBUG) printf("add class to stack\n");
 		markStackPush(cls);
@@ -94,7 +118,7 @@ static void markClass(OBJ obj) {
 		if (index > 0) {
 			if (index <= objWords(classes)) {
 				cls = FIELD(classes, index - 1);
-				if (!isMarked(cls)) {
+				if (!isMarked(cls) && !(minorGCInProgress && !inNursery(cls))) {
 					setMark(cls);
 					if (DEBUG) printf("add class to stack\n");
 					markStackPush(cls);
@@ -130,7 +154,7 @@ static void markAndTrace(OBJ obj) {
 	if (DEBUG) printf("%d fields\n", (int)((end - ptr) / sizeof(OBJ)));
 	while (ptr < end) {
 		OBJ obj = *O2A(ptr);
-		if (isMemoryObj(obj)) {
+		if (isMemoryObj(obj) && !(minorGCInProgress && !inNursery(obj))) {
 			if (DEBUG) printf("  %d (class %d): ", W(obj, memStart), objClass(obj));
 			if (!isMarked(obj)) {
 				if (HAS_OBJECTS(obj)) {
@@ -202,9 +226,9 @@ static OBJ survivorAfter(OBJ obj) {
 	return freeStart;
 }
 
-static void sweepAndSetForwardFields() {
+static void sweepAndSetForwardFields(OBJ start) {
 	int wordShift = 0;
-	OBJ ptr = memStart;
+	OBJ ptr = start;
 	while (ptr < freeStart) {
 		OBJ nextPtr = nextChunk(ptr);
 		if (DEBUG) printf("  %d - ", W(ptr, memStart));
@@ -259,9 +283,9 @@ static OBJ forward(OBJ oldObj) {
 	return oldObj;
 }
 
-static void moveSurvivors() {
+static void moveSurvivors(OBJ start) {
 	if (DEBUG) printf("moving survivors, old freeStart: %d\n", W(freeStart, memStart));
-	OBJ ptr = memStart;
+	OBJ ptr = start;
 	OBJ dstPtr = ptr;
 	while (ptr < freeStart) {
 		int chunkWords = HEADER_WORDS + WORDS(ptr);
@@ -300,7 +324,8 @@ void processWeakObjects() {
 		int i = 0;
 		for (i = 0; i < words; i++) {
 			OBJ field = FIELD(obj, i);
-			if (isMemoryObj(field) && !isMarked(field)) {
+			if (isMemoryObj(field) && !isMarked(field) &&
+				!(minorGCInProgress && !inNursery(field))) {
 				FIELD(obj, i) = nilObj;
 			}
 		}
@@ -308,15 +333,122 @@ void processWeakObjects() {
 	}
 }
 
+// ***** Minor Collection *****
+
+static void scanOldSpaceForNurseryRefs() {
+	// Find all old-to-nursery references with a single linear pass over the
+	// old generation and mark their targets as roots. Unlike a full mark, this
+	// pass is strictly sequential and does no tracing, so it is fast even on a
+	// large heap. Old objects that reference the nursery are recorded in
+	// rememberedSet; they are the only old objects whose fields can change
+	// when the nursery is compacted. Weak arrays do not keep their nursery
+	// referents alive, but are collected for later processing.
+
+	rememberedCount = 0;
+	rememberedSetOverflowed = false;
+	OBJ ptr = memStart;
+	while (ptr < nurseryStart) {
+		if (notFreeChunk(ptr) && HAS_OBJECTS(ptr)) {
+			gp_boolean isWeakObj = isWeak(ptr);
+			gp_boolean refersToNursery = false;
+			int wordCount = HEADER_WORDS + WORDS(ptr);
+			for (int i = HEADER_WORDS; i < wordCount; i++) {
+				OBJ field = O2A(ptr)[i];
+				if (isMemoryObj(field) && inNursery(field)) {
+					refersToNursery = true;
+					if (!isWeakObj && !isMarked(field)) markRoot(field);
+				}
+			}
+			if (refersToNursery) {
+				if (isWeakObj && (weakObjectsPtr < (weakObjectsArray + WeakObjectsSize))) {
+					*weakObjectsPtr++ = ptr;
+				}
+				if (rememberedCount < RememberedSetSize) {
+					rememberedSet[rememberedCount++] = ptr;
+				} else {
+					rememberedSetOverflowed = true;
+				}
+			}
+		}
+		ptr = nextChunk(ptr);
+	}
+}
+
+static void updateNurseryRefs(OBJ obj) {
+	// Update any fields of obj that reference forwarded nursery objects.
+	// Fields that reference the old generation are left alone; old objects do
+	// not move during a minor collection, and their forwarding word doubles as
+	// the primitive cache.
+
+	if (!HAS_OBJECTS(obj)) return;
+	int wordCount = HEADER_WORDS + WORDS(obj);
+	for (int i = HEADER_WORDS; i < wordCount; i++) {
+		OBJ oldObj = O2A(obj)[i];
+		if (isMemoryObj(oldObj) && inNursery(oldObj)) {
+			OBJ newObj = O2A(oldObj)[FORWARD_PTR] * sizeof(OBJ);
+			if (newObj) O2A(obj)[i] = newObj;
+		}
+	}
+}
+
+static void updateNurseryPointers() {
+	// Update pointers into the compacted nursery: only the remembered old
+	// objects and the nursery survivors themselves can hold such pointers. If
+	// the remembered set overflowed (very rare), rescan all of old space.
+
+	if (rememberedSetOverflowed) {
+		OBJ ptr = memStart;
+		while (ptr < nurseryStart) {
+			if (notFreeChunk(ptr)) updateNurseryRefs(ptr);
+			ptr = nextChunk(ptr);
+		}
+	} else {
+		for (int i = 0; i < rememberedCount; i++) updateNurseryRefs(rememberedSet[i]);
+	}
+	OBJ ptr = nurseryStart;
+	while (ptr < freeStart) {
+		if (notFreeChunk(ptr)) updateNurseryRefs(ptr);
+		ptr = nextChunk(ptr);
+	}
+}
+
+static int minorCollection() {
+	// Trace, sweep, and compact only the nursery, then promote all survivors
+	// to the old generation. Return the number of bytes recovered.
+
+	int preGCBytes = freeStart - memStart;
+	minorGCInProgress = true;
+	weakObjectsPtr = weakObjectsArray;
+	saveVMRoots();
+	initMarkingStack();
+	scanOldSpaceForNurseryRefs();
+	if (inNursery(vmRoots)) markRoot(vmRoots); // normally old; see initGP()
+	markLoop();
+	processWeakObjects();
+	sweepAndSetForwardFields(nurseryStart);
+	updateNurseryPointers();
+	if (inNursery(vmRoots)) {
+		OBJ newOop = O2A(vmRoots)[FORWARD_PTR] * sizeof(OBJ);
+		if (newOop) vmRoots = newOop;
+	}
+	moveSurvivors(nurseryStart);
+	restoreVMRoots();
+	methodCacheClearRange(nurseryStart); // nursery objects moved or were collected
+	minorGCInProgress = false;
+	nurseryStart = freeStart; // promote all survivors
+	return preGCBytes - (freeStart - memStart);
+}
+
 // ***** Compaction & GC Entry Points *****
 
 void compact() {
 	if (DEBUG) printf("compacting memory (size %d words)\n", W(freeStart, memStart));
-	sweepAndSetForwardFields();
+	sweepAndSetForwardFields(memStart);
 	updatedForwardedPointers();
 	vmRoots = forward(vmRoots); // if vmRoots is first object in memory, this should do nothing
-	moveSurvivors();
+	moveSurvivors(memStart);
 	restoreVMRoots();
+	methodCacheClearRange(memStart); // any object may have moved or been collected
 	compactionNeeded = false;
 }
 
@@ -324,6 +456,30 @@ int collectGarbage(int showStats) {
 	int preGCBytes = freeStart - memStart;
 	struct timeval start;
 
+	// Try a minor collection first; it touches only the nursery and the old
+	// generation's pointer fields, so pauses stay short even on a large heap.
+	// Fall back to the full mark-compact collector when the nursery was mostly
+	// survivors, when memory is still tight afterwards, or periodically to
+	// reclaim garbage that has accumulated in the old generation. Full stats
+	// (showStats) also force a full collection so the numbers are accurate.
+	if (!showStats && (nurseryStart > memStart) && (minorGCsSinceFullGC < FullGCInterval)) {
+		int nurseryBytes = freeStart - nurseryStart;
+		gettimeofday(&start, 0);
+		int bytesRecovered = minorCollection();
+		int minorTime = usecsSince(&start);
+		minorGCsSinceFullGC++;
+		int bytesFree = memEnd - freeStart;
+		if (((2 * bytesRecovered) >= nurseryBytes) && (bytesFree > gcThreshold)) {
+			if (DEBUG) printf("minor GC recovered %dk in %d usecs\n", bytesRecovered / 1000, minorTime);
+			allocationsSinceLastGC = 0;
+			bytesAllocatedSinceLastGC = 0;
+			gcCount++;
+			gcNeeded = false;
+			return bytesRecovered;
+		}
+		preGCBytes = freeStart - memStart; // minor GC was not enough; do a full one
+	}
+
 	gettimeofday(&start, 0);
 	initGarbageCollector();
 	markLoop();
@@ -333,6 +489,8 @@ int collectGarbage(int showStats) {
 	processWeakObjects();
 	compact();
 	int compactTime = usecsSince(&start);
+	nurseryStart = freeStart; // everything surviving a full collection is old
+	minorGCsSinceFullGC = 0;
 	int postGCBytes = freeStart - memStart;
 	int bytesRecovered = preGCBytes - postGCBytes;
 
@@ -509,8 +509,8 @@ void initVMClasses() {
 	char *listFields[] = {"first", "last", "contents"};
 	defineVMClass("List", ListClass, 3, listFields);
 
-	char *dictionaryFields[] = {"tally", "keys", "values"};
-	defineVMClass("Dictionary", DictionaryClass, 3, dictionaryFields);
+	char *dictionaryFields[] = {"tally", "keys", "values", "hashes", "tombstones"};
+	defineVMClass("Dictionary", DictionaryClass, 5, dictionaryFields);
 
 	char *cmdAndReporterFields[] = {"primName", "lineno", "fileName", "cache", "cachedClassID", "nextBlock"};
 	defineVMClass("Command", CmdClass, CmdFieldCount, cmdAndReporterFields);
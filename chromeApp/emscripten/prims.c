@@ -23,6 +23,7 @@
 #include "interp.h"
 #include "oop.h"
 #include "parse.h"
+#include "snapshot.h"
 
 #ifdef EMSCRIPTEN
 #include <emscripten.h>
@@ -1910,6 +1911,109 @@ OBJ primSHA1(int nargs, OBJ args[]) {
 	return result;
 }
 
+// ***** Streaming Hash Support *****
+
+// A hash context is held in an ExternalReference so that partially hashed
+// state survives garbage collections and is freed by a finalizer if the
+// reference is dropped before finishSHA is called. This allows multi-MB
+// downloads to be hashed in chunks as the data arrives rather than being
+// buffered into a single object first.
+
+typedef struct {
+	int isSHA256;
+	union {
+		SHA1_CTX sha1;
+		SHA256_CTX sha256;
+	} ctx;
+} HashContext;
+
+static void finalizeHashContext(OBJ refObj) {
+	ADDR *a = (ADDR*)BODY(refObj);
+	if (a[0]) free((HashContext *) a[0]);
+	a[0] = NULL;
+}
+
+static HashContext* obj2hashContext(OBJ refObj) {
+	// Return the hash context from the given external reference or NULL if refObj is not valid.
+
+	if (isInt(refObj) || (refObj <= falseObj)) return NULL;
+
+	ADDR *a = (ADDR*)BODY(refObj);
+	if (NOT_CLASS(refObj, ExternalReferenceClass) ||
+		(objWords(refObj) < ExternalReferenceWords) ||
+		(a[1] != (ADDR) finalizeHashContext)) {
+			primFailed("Invalid hash context");
+			return NULL;
+	}
+	return (HashContext *) a[0];
+}
+
+static OBJ newHashContext(int isSHA256) {
+	HashContext *hc = (HashContext *) malloc(sizeof(HashContext));
+	if (!hc) return outOfMemoryFailure();
+	hc->isSHA256 = isSHA256;
+	if (isSHA256) {
+		SHA256_Init(&hc->ctx.sha256);
+	} else {
+		SHA1Init(&hc->ctx.sha1);
+	}
+	OBJ result = newBinaryObj(ExternalReferenceClass, ExternalReferenceWords);
+	ADDR *a = (ADDR*)BODY(result);
+	a[0] = (ADDR) hc;
+	a[1] = (ADDR) finalizeHashContext;
+	return result;
+}
+
+OBJ primStartSHA1(int nargs, OBJ args[]) { return newHashContext(false); }
+OBJ primStartSHA256(int nargs, OBJ args[]) { return newHashContext(true); }
+
+OBJ primUpdateSHA(int nargs, OBJ args[]) {
+	if (nargs < 2) return notEnoughArgsFailure();
+	HashContext *hc = obj2hashContext(args[0]);
+	if (!hc) return primFailed("Needs a hash context from startSHA1 or startSHA256");
+	OBJ data = args[1];
+	if (!(IS_CLASS(data, StringClass) || IS_CLASS(data, BinaryDataClass))) {
+		return primFailed("Second argument must be a String or BinaryData");
+	}
+	unsigned char *buf = (unsigned char *)BODY(data);
+	unsigned int byteCount = IS_CLASS(data, StringClass) ? stringBytes(data) : objBytes(data);
+
+	unsigned int startIndex = 1; // one-based, as in GP
+	if ((nargs > 2) && isInt(args[2])) startIndex = obj2int(args[2]);
+	if ((startIndex < 1) || (startIndex > (byteCount + 1))) return primFailed("Start index out of range");
+	unsigned int count = byteCount - (startIndex - 1);
+	if ((nargs > 3) && isInt(args[3]) && (((unsigned int) obj2int(args[3])) < count)) {
+		count = obj2int(args[3]);
+	}
+	if (hc->isSHA256) {
+		SHA256_Update(&hc->ctx.sha256, buf + (startIndex - 1), count);
+	} else {
+		SHA1Update(&hc->ctx.sha1, buf + (startIndex - 1), count);
+	}
+	return args[0];
+}
+
+OBJ primFinishSHA(int nargs, OBJ args[]) {
+	if (nargs < 1) return notEnoughArgsFailure();
+	HashContext *hc = obj2hashContext(args[0]);
+	if (!hc) return primFailed("Needs a hash context from startSHA1 or startSHA256");
+
+	OBJ result;
+	if (hc->isSHA256) {
+		char digestString[SHA256_DIGEST_STRING_LENGTH];
+		SHA256_End(&hc->ctx.sha256, digestString);
+		result = newString(digestString);
+	} else {
+		unsigned char digest[20];
+		SHA1Final(digest, &hc->ctx.sha1);
+		result = newBinaryData(20);
+		if (!result) return outOfMemoryFailure();
+		memcpy((char *) &FIELD(result, 0), digest, 20);
+	}
+	finalizeHashContext(args[0]); // free the context; the reference cannot be used again
+	return result;
+}
+
 // ***** Pixel Manipulation *****
 
 static OBJ failedBadPixelData() { return primFailed("PixelData must be BinaryData"); }
@@ -2940,6 +3044,12 @@ OBJ primObjData(int nargs, OBJ args[]) {
 	return result;
 }
 
+OBJ primSaveSnapshot(int nargs, OBJ args[]) {
+	if (nargs < 1) return notEnoughArgsFailure();
+	if (NOT_CLASS(args[0], StringClass)) return primFailed("File name must be a string");
+	return saveSnapshot(obj2str(args[0])) ? trueObj : falseObj;
+}
+
 // ***** Profiling *****
 
 #if !defined(_WIN32) && !defined(EMSCRIPTEN)
@@ -3123,7 +3233,9 @@ static OBJ primModule(int nargs, OBJ args[]) {
 
 static OBJ primClearMethodCache(int nargs, OBJ args[]) {
 	if ((nargs > 0) && (IS_CLASS(args[0], StringClass))) {
-		methodCacheClearEntry(args[0]); // clear entry for the given method/function name
+		methodCacheClearEntry(args[0]); // clear entries for the given method/function name
+	} else if ((nargs > 0) && isInt(args[0])) {
+		methodCacheClearClass(obj2int(args[0])); // clear entries for the given class index
 	} else {
 		methodCacheClear(); // clear the entire cache
 	}
@@ -3385,6 +3497,10 @@ PrimEntry corePrimList[] = {
 	{"crc",			primZlibCRC,		"Return the CRC-32 (or Adler-32, if adlerFlag is true) checksum for the given String or BinaryData. lastCRC can be provided to combine CRCs. Arguments: data [adlerFlag lastCRC]"},
 	{"sha256",		primSHA256,			"Return the digest of the SHA 256 hash value for the given String or BinaryData. Arguments: data"},
 	{"sha1",		primSHA1,			"Return the 20-byte SHA-1 hash for the given String or BinaryData. Arguments: data"},
+	{"startSHA1",	primStartSHA1,		"Return a new streaming SHA-1 hash context. Feed it data with updateSHA and get the hash with finishSHA."},
+	{"startSHA256",	primStartSHA256,	"Return a new streaming SHA-256 hash context. Feed it data with updateSHA and get the digest with finishSHA."},
+	{"updateSHA",	primUpdateSHA,		"Add data to a streaming hash context and return the context. Allows large files to be hashed in chunks as the data arrives. Arguments: hashContext data [startIndex byteCount]"},
+	{"finishSHA",	primFinishSHA,		"Finish a streaming hash and return the result: a 20-byte BinaryData for SHA-1 or a digest string for SHA-256, matching the sha1 and sha256 primitives. The context cannot be used again. Arguments: hashContext"},
 
 	{"-----", NULL, "Graphics: Pixel Manipulation"},
 	{"getPixelAlpha",	primGetPixelAlpha,			"Return the alpha value of a pixel. Arguments: pixelData offset."},
@@ -3440,6 +3556,7 @@ PrimEntry corePrimList[] = {
 	{"objectReferences", primObjectReferences,	"Return an array containing all objects that contain a reference to the argument."},
 	{"replaceObjects", primReplaceObjects,		"Replace all references to each object in the first argument array with the corresponding object in the second argument array."},
 	{"gc",			(void*) GC,			"Garbage collect memory. Reclaim discarded objects and compact the remaining objects."},
+	{"saveSnapshot", primSaveSnapshot,	"Write the object memory to the given file as a snapshot image that can be loaded at the next startup in place of the GP library sources. Best preceded by gc so the image contains no garbage. Returns true if successful. Arguments: fileName"},
 	{"findGarbage",	primFindGarbage,	"Find garbage objects but don't reclaim them. Used to analyze object memory."},
 	{"isGarbage",	primIsGarbage,		"Return true if the given object was identified as garbage by findGarbage. Used to analyze object memory."},
 	{"objAddr",		primObjAddr,		"Return the current word address of the given object. Used to analyze object memory."},
@@ -0,0 +1,116 @@
+// snapshot.c - Save and load binary images of the object memory.
+//
+// A snapshot records the entire object memory -- classes, methods, and
+// literals -- after the GP library sources have been parsed, so a later
+// startup can load the image directly instead of re-parsing the sources.
+// All object references are saved unchanged and relocated on load, so an
+// image can be loaded at a different base address than the one at which
+// it was saved. C state embedded in the heap (cached primitive function
+// pointers and the contents of ExternalReference objects) is meaningless
+// in the loading process and is cleared; the loader must therefore call
+// initGPRuntime() to rebuild the primitive tables after loading.
+
+#include <stdio.h>
+#include <string.h>
+#include "mem.h"
+#include "interp.h"
+#include "snapshot.h"
+
+#define SnapshotMagic 0x4D495047 // "GPIM" as little-endian bytes
+#define SnapshotVersion 1
+
+typedef struct {
+	uint32 magic;
+	uint32 version;
+	uint32 headerWords; // object header size; differs between 32- and 64-bit builds
+	uint32 memStart; // memStart of the saving process, used to relocate on load
+	uint32 freeStart;
+	uint32 vmRoots;
+} SnapshotHeader;
+
+gp_boolean saveSnapshot(char *fileName) {
+	// Write the object memory to the given file. Returns true if successful.
+	// Best preceded by a garbage collection so the image contains no garbage.
+
+	FILE *f = fopen(fileName, "wb");
+	if (!f) return false;
+
+	saveVMRoots();
+	OBJ savedTask = FIELD(vmRoots, 18);
+	FIELD(vmRoots, 18) = nilObj; // a loaded image starts up with no active task
+
+	SnapshotHeader h;
+	h.magic = SnapshotMagic;
+	h.version = SnapshotVersion;
+	h.headerWords = HEADER_WORDS;
+	h.memStart = memStart;
+	h.freeStart = freeStart;
+	h.vmRoots = vmRoots;
+
+	uint32 byteCount = freeStart - memStart;
+	gp_boolean ok = (fwrite(&h, sizeof(h), 1, f) == 1);
+	ok = ok && (fwrite(O2A(memStart), 1, byteCount, f) == byteCount);
+	fclose(f);
+
+	FIELD(vmRoots, 18) = savedTask;
+	return ok;
+}
+
+gp_boolean loadSnapshot(char *fileName) {
+	// Load a snapshot image into the object memory. Must be called right
+	// after memInit(), before any objects have been allocated. Returns false,
+	// leaving the object memory empty, if there is no usable image, in which
+	// case the caller falls back to parsing the GP library sources.
+
+	FILE *f = fopen(fileName, "rb");
+	if (!f) return false;
+
+	SnapshotHeader h;
+	if (fread(&h, sizeof(h), 1, f) != 1) { fclose(f); return false; }
+	if ((h.magic != SnapshotMagic) ||
+		(h.version != SnapshotVersion) ||
+		(h.headerWords != HEADER_WORDS) ||
+		(h.freeStart < h.memStart)) {
+			fclose(f);
+			return false;
+	}
+	uint32 byteCount = h.freeStart - h.memStart;
+	if ((memStart + byteCount) >= memEnd) { fclose(f); return false; } // image too large
+	if (fread(O2A(memStart), 1, byteCount, f) != byteCount) { fclose(f); return false; }
+	fclose(f);
+	freeStart = memStart + byteCount;
+
+	// Walk the loaded objects, relocating references by the difference
+	// between the old and new memStart and clearing stale C pointers.
+	int delta = memStart - h.memStart;
+	OBJ ptr = memStart;
+	while (ptr < freeStart) {
+		ADDR a = O2A(ptr);
+		if (!a[0]) { ptr = nextChunk(ptr); continue; } // free chunk
+		a[2] = 0; // clear the cached primitive pointer / forwarding word
+#ifdef _LP64
+		a[3] = 0;
+#endif
+		if (ExternalReferenceClass == CLASS(ptr)) {
+			// external references hold C pointers from the saving process
+			memset(BODY(ptr), 0, WORDS(ptr) * sizeof(OBJ));
+		} else if (HAS_OBJECTS(ptr)) {
+			int wordCount = HEADER_WORDS + WORDS(ptr);
+			for (int i = HEADER_WORDS; i < wordCount; i++) {
+				OBJ v = a[i];
+				if (((v & 1) == 0) && (v >= h.memStart) && (v < h.freeStart)) {
+					a[i] = v + delta;
+				}
+			}
+		}
+		ptr = nextChunk(ptr);
+	}
+
+	vmRoots = h.vmRoots + delta;
+	restoreVMRoots();
+
+	allocationsSinceLastGC = 0;
+	bytesAllocatedSinceLastGC = 0;
+	gcThreshold = (memEnd - freeStart) / 10;
+	return true;
+}
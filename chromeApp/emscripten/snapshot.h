@@ -0,0 +1,4 @@
+// snapshot.h - Save and load binary images of the object memory.
+
+gp_boolean saveSnapshot(char *fileName);
+gp_boolean loadSnapshot(char *fileName);
@@ -9,45 +9,88 @@
 #include "interp.h"
 #include "dict.h"
 
+// ***** Audio Output Ring Buffer *****
+
+// Mixed samples flow to the audio callback through a single-producer,
+// single-consumer ring buffer. The GP mixer runs ahead of playback by a few
+// output buffers, so brief pauses of the GP thread (e.g. for garbage
+// collection) do not cause audible underruns. The GP thread advances only
+// ringWritePos and the audio callback advances only ringReadPos, so no
+// locking is needed. Both are free-running sample counters, masked to index
+// the ring. The callback counts underruns (callbacks that ran out of
+// samples while sound was flowing) for inspection from GP code.
+
+#define AUDIO_RING_SIZE 16384 // samples; must be a power of two
+#define RUN_AHEAD_BUFFERS 3 // mixer runs up to this many output buffers ahead of playback
+
+static short audioRing[AUDIO_RING_SIZE];
+static volatile unsigned int ringWritePos = 0; // advanced only by the GP thread
+static volatile unsigned int ringReadPos = 0; // advanced only by the audio callback
+static volatile int audioUnderruns = 0; // incremented by the audio callback
+
+static int audioChannels = 1;
+static int audioFrameCount = 1024; // frames per output buffer
+
+static int ringSamplesNeeded() {
+	// Return the number of samples the mixer should produce to reach its
+	// run-ahead target, or zero if it is already far enough ahead.
+
+	unsigned int filled = ringWritePos - ringReadPos;
+	unsigned int target = RUN_AHEAD_BUFFERS * audioFrameCount * audioChannels;
+	if (target > AUDIO_RING_SIZE) target = AUDIO_RING_SIZE;
+	return (filled < target) ? (target - filled) : 0;
+}
+
+static void writeSamplesToRing(OBJ array) {
+	int count = WORDS(array);
+	unsigned int spaceLeft = AUDIO_RING_SIZE - (ringWritePos - ringReadPos);
+	if (count > spaceLeft) count = spaceLeft;
+	unsigned int w = ringWritePos;
+	for (int i = 0; i < count; i++) {
+		OBJ obj = FIELD(array, i);
+		audioRing[w & (AUDIO_RING_SIZE - 1)] = (short) ((isInt(obj) ? obj2int(obj) : 0) & 0xFFFF);
+		w++;
+	}
+	ringWritePos = w; // publish the new samples
+}
+
 // ***** Audio Output *****
 
 #ifdef EMSCRIPTEN
 
 #include <emscripten.h>
 
+static int audioOutOpen = false;
+
 static void startAudioOutput(int frameCount, int stereoFlag) {
+	audioChannels = stereoFlag ? 2 : 1;
+	audioFrameCount = frameCount;
+	ringReadPos = ringWritePos = 0;
+	audioUnderruns = 0;
+	audioOutOpen = true;
+	// pass the ring buffer and its counters so the audio callback in
+	// gpSupport.js can consume samples directly from the Emscripten heap
 	EM_ASM_({
-		GP_startAudioOutput($0, $1);
-	}, frameCount, stereoFlag);
+		GP_startAudioOutput($0, $1, $2, $3, $4, $5, $6);
+	}, frameCount, stereoFlag, audioRing, AUDIO_RING_SIZE,
+		&ringReadPos, &ringWritePos, &audioUnderruns);
 }
 
 static void stopAudioOutput() {
+	audioOutOpen = false;
 	EM_ASM({
 		GP_stopAudioOutput();
 	}, 0);
 }
 
 static int samplesNeeded() {
-	int frameCount = EM_ASM_INT({
-		if (GP.audioOutReady || !GP.audioOutBuffer) return 0;
-		var frameCount = GP.audioOutBuffer.length;
-		if (GP.audioOutIsStereo) frameCount = frameCount / 2;
-		return frameCount;
-	}, NULL);
-	return frameCount;
+	if (!audioOutOpen) return 0;
+	return ringSamplesNeeded() / audioChannels; // frames
 }
 
 static void writeSamples(OBJ buffer) {
-	EM_ASM_({
-		var src = $0 / 4; // word index
-		var count = $1;
-		if (!GP.audioOutBuffer) return;
-		if (GP.audioOutBuffer.length < count) count = GP.audioOutBuffer.length;
-		for (var i = 0; i < count; i++) {
-			GP.audioOutBuffer[i] = (Module.HEAP32[src++] >> 1) / 32768.0; // convert obj -> int -> float
-		}
-		GP.audioOutReady = true;
-	}, &FIELD(buffer, 0), objWords(buffer));
+	if (!audioOutOpen || NOT_CLASS(buffer, ArrayClass)) return;
+	writeSamplesToRing(buffer);
 }
 
 #else // end EMSCRIPTEN sound output
@@ -55,29 +98,30 @@ static void writeSamples(OBJ buffer) {
 #include "SDL.h"
 
 #define MAX_SAMPLES 8192
-static short samples[MAX_SAMPLES];
-static int samplesSize = 0; // number of samples actually used, set by startPlaying
+static int samplesSize = 0; // number of samples per output buffer, set by startPlaying
 
 static int isPlaying = false;
 static int isStereo = false;
-static int bufferEmpty = true;
+static int lastCallbackHadData = false;
 
 void audioOutCallback(void *ignore, Uint8 *stream, int len) {
 	int sampleCount = len / 2;
 	short *out = (short *) stream;
-	if (bufferEmpty) {
-		// write silence (client hasn't provided any samples)
-		for (int i = 0; i < sampleCount; i++) {
-			*out++ = 0;
-		}
-	} else {
-		// write samples
-		short *src = samples;
-		for (int i = 0; i < sampleCount; i++) {
-			*out++ = *src++;
-		}
+	unsigned int avail = ringWritePos - ringReadPos;
+	int n = (avail < sampleCount) ? avail : sampleCount;
+	unsigned int r = ringReadPos;
+	for (int i = 0; i < n; i++) {
+		*out++ = audioRing[r & (AUDIO_RING_SIZE - 1)];
+		r++;
 	}
-	bufferEmpty = true;
+	ringReadPos = r; // release the consumed samples
+	for (int i = n; i < sampleCount; i++) *out++ = 0; // pad with silence
+	if (n < sampleCount) {
+		// count an underrun only if sound was flowing; running dry when
+		// nothing is playing is the normal idle state, not a glitch
+		if ((n > 0) || lastCallbackHadData) audioUnderruns++;
+	}
+	lastCallbackHadData = (n == sampleCount);
 }
 
 static void stopAudioOutput() {
@@ -108,33 +152,28 @@ static void startAudioOutput(int frameCount, int stereoFlag) {
 	wanted.callback = audioOutCallback;
 	wanted.userdata = NULL;
 
+	audioChannels = wanted.channels;
+	audioFrameCount = samplesSize / audioChannels;
+	ringReadPos = ringWritePos = 0;
+	audioUnderruns = 0;
+	lastCallbackHadData = false;
+
 	// open the audio device, forcing the desired format
 	if (SDL_OpenAudio(&wanted, NULL) < 0) {
 		fprintf(stderr, "Couldn't open SDL audio: %s\n", SDL_GetError());
 	} else {
 		SDL_PauseAudio(false);
 		isPlaying = true;
-		bufferEmpty = true;
 	}
 }
 
 static int samplesNeeded() {
-	return (isPlaying && bufferEmpty) ? samplesSize : 0;
+	return isPlaying ? ringSamplesNeeded() : 0;
 }
 
 static void writeSamples(OBJ array) {
 	if (!isPlaying || NOT_CLASS(array, ArrayClass)) return;
-	int count = WORDS(array);
-	if (count > samplesSize) count = samplesSize;
-	for (int i = 0; i < samplesSize; i++) {
-		if (i < count) {
-			OBJ obj = FIELD(array, i);
-			samples[i] = (short) ((isInt(obj) ? obj2int(obj) : 0) & 0xFFFF);
-		} else {
-			samples[i] = 0;
-		}
-	}
-	bufferEmpty = false;
+	writeSamplesToRing(array);
 }
 
 #endif // end SDL sound output
@@ -163,6 +202,12 @@ OBJ primWriteSamples(int nargs, OBJ args[]) {
 	return nilObj;
 }
 
+OBJ primAudioUnderruns(int nargs, OBJ args[]) {
+	int result = audioUnderruns;
+	if ((nargs > 0) && (trueObj == args[0])) audioUnderruns = 0;
+	return int2obj(result);
+}
+
 // ***** Simple FFT Primitive *****
 
 #define MAX_FFT 16384
@@ -598,6 +643,7 @@ PrimEntry soundPrimList[] = {
 	{"closeAudio",		primCloseAudio,		"Close the audio output driver."},
 	{"samplesNeeded",	primSamplesNeeded,	"Return the number of stereo or mono samples (frames) needed. Zero if there's is no room in the buffer."},
 	{"writeSamples",	primWriteSamples,	"Write sound samples (an array of signed, 16-bit integers). If stereo, left and right channels are interleaved. Arguments: sampleArray"},
+	{"audioUnderruns",	primAudioUnderruns,	"Return the number of times the audio output ran out of samples while sound was playing. Pass true to reset the count. Arguments: [resetFlag]"},
 	{"fft",				primFFT,			"Return the Fast Fourier Transform (FFT) of an audio buffer. The argument must be an Array of Integers or Floats whose size is a power of 2."},
 	{"generateNoteSamples",	primGenerateNoteSamples, "Generate samples for a sampled instrument note. Arguements: aNotePlayer sampleArray"},
 	{"sendMIDI",		primSendMIDI,		"Send a MIDI 2 or 3 byte MIDI message. Arguments: byte1 byte2 [byte3]"},
@@ -0,0 +1,17 @@
+#!/bin/sh
+# Build the uBlocks benchmark harness for generic GNU/Linux
+# Runs the interpreter benchmark suite (vm/benchmark.c) and exits
+#
+# Prereqs for 64-bit Linux systems:
+#	libc6-dev-i386 gcc-multilib g++-multilib libsdl2-dev:i386 libsdl2-ttf-dev:i386
+
+gcc -m32 -std=c99 -Wall -Wno-unused-variable -Wno-unused-result -O3 \
+	-D GNUBLOCKS -D VM_BENCHMARK \
+	-I/usr/local/include/SDL2 \
+	-I ../vm \
+	linux.c ../vm/*.c \
+	linuxSensorPrims.c linuxFilePrims.c linuxIOPrims.c linuxNetPrims.c \
+	linuxOutputPrims.c linuxTftPrims.c \
+	-lSDL2 -lSDL2_ttf \
+	-ldl -lm -lpthread -lsndio -lz \
+	-o GnuBlocksBench
@@ -13,9 +13,16 @@
 
 #define _XOPEN_SOURCE 600
 #define _DEFAULT_SOURCE
+#define _GNU_SOURCE // for ppoll()
 
+#include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <stdlib.h> // still needed?
 #include <sys/ioctl.h>
 #include <sys/time.h> // still needed?
@@ -82,20 +89,139 @@ static void openPseudoTerminal() {
  	unlockpt(pty);
 }
 
+// Local IPC Channel
+//
+// In addition to the pseudo terminal, the VM listens on a Unix domain socket.
+// A local IDE that finds the socket can connect to it instead of the pty and
+// skip terminal-layer overhead entirely; the VM simply prefers the socket
+// connection while one is open and falls back to the pty when it closes.
+
+#define SOCKET_PATH "/tmp/GnuBlocks.socket"
+
+static int listenSocket = -1; // Unix domain listening socket
+static int ipcSocket = -1; // connected local IPC channel (preferred over the pty)
+
+static void openLocalSocket() {
+	listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listenSocket < 0) return;
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, SOCKET_PATH, sizeof(addr.sun_path) - 1);
+	unlink(SOCKET_PATH); // remove any stale socket file
+	if ((bind(listenSocket, (struct sockaddr *) &addr, sizeof(addr)) < 0) ||
+		(listen(listenSocket, 1) < 0)) {
+			close(listenSocket);
+			listenSocket = -1;
+			return;
+	}
+	fcntl(listenSocket, F_SETFL, O_NONBLOCK);
+}
+
+static void acceptLocalConnection() {
+	if ((ipcSocket >= 0) || (listenSocket < 0)) return;
+	ipcSocket = accept(listenSocket, NULL, NULL);
+	if (ipcSocket >= 0) fcntl(ipcSocket, F_SETFL, O_NONBLOCK);
+}
+
+static int activeFD() {
+	return (ipcSocket >= 0) ? ipcSocket : pty;
+}
+
+// Receive Buffering
+//
+// Incoming bytes are read in batches into a buffer with a single nonblocking
+// read, so recvBytes and canReadByte consume buffered bytes instead of making
+// a system call per check.
+
+#define RECV_BUF_SIZE 4096
+
+static uint8 recvBuf[RECV_BUF_SIZE];
+static int recvBufStart = 0; // index of first unconsumed byte
+static int recvBufEnd = 0; // index just past the last buffered byte
+
+static void fillRecvBuf() {
+	// Top up the receive buffer with one nonblocking read.
+
+	acceptLocalConnection();
+	if (recvBufStart == recvBufEnd) {
+		recvBufStart = recvBufEnd = 0;
+	} else if (recvBufStart > 0) {
+		memmove(recvBuf, &recvBuf[recvBufStart], recvBufEnd - recvBufStart);
+		recvBufEnd -= recvBufStart;
+		recvBufStart = 0;
+	}
+	if (recvBufEnd >= RECV_BUF_SIZE) return; // buffer is full
+
+	int n = read(activeFD(), &recvBuf[recvBufEnd], RECV_BUF_SIZE - recvBufEnd);
+	if ((0 == n) && (ipcSocket >= 0)) {
+		// the local IDE closed its connection; fall back to the pty
+		close(ipcSocket);
+		ipcSocket = -1;
+		return;
+	}
+	if (n > 0) recvBufEnd += n;
+}
+
 int recvBytes(uint8 *buf, int count) {
-	int readCount = read(pty, buf, count);
-	if (readCount < 0) readCount = 0;
+	fillRecvBuf();
+	int readCount = recvBufEnd - recvBufStart;
+	if (readCount > count) readCount = count;
+	memcpy(buf, &recvBuf[recvBufStart], readCount);
+	recvBufStart += readCount;
 	return readCount;
 }
 
 int canReadByte() {
-	int bytesAvailable;
-	ioctl(pty, FIONREAD, &bytesAvailable);
-	return (bytesAvailable > 0);
+	if (recvBufStart == recvBufEnd) fillRecvBuf();
+	return (recvBufEnd > recvBufStart);
+}
+
+static int sendAll(uint8 *buf, int count) {
+	// Write all of the given bytes, retrying when the nonblocking channel's
+	// buffer is momentarily full.
+
+	int fd = activeFD();
+	int offset = 0;
+	while (offset < count) {
+		int n = write(fd, buf + offset, count - offset);
+		if (n < 0) {
+			if ((EAGAIN != errno) && (EWOULDBLOCK != errno)) {
+				if (ipcSocket >= 0) { // the local IDE went away; fall back to the pty
+					close(ipcSocket);
+					ipcSocket = -1;
+				}
+				return offset;
+			}
+			struct pollfd fds = { fd, POLLOUT, 0 };
+			poll(&fds, 1, 10); // wait for buffer space
+			continue;
+		}
+		offset += n;
+	}
+	return count;
 }
 
 int sendByte(char aByte) {
-	return write(pty, &aByte, 1);
+	return sendAll((uint8 *) &aByte, 1);
+}
+
+int sendBytes(uint8 *buf, int count) {
+	return sendAll(buf, count);
+}
+
+void idleSleep(int microsecsToSleep) {
+	// Called by the scheduler when no task is runnable. Sleep until data arrives
+	// on the active channel, a local IDE connects, or the timeout expires;
+	// without this, an idle program pegs an entire core.
+
+	if (recvBufEnd > recvBufStart) return; // buffered input is waiting
+	struct pollfd fds[2] = {
+		{ activeFD(), POLLIN, 0 },
+		{ listenSocket, POLLIN, 0 }};
+	struct timespec timeout = { 0, 1000 * (long) microsecsToSleep };
+	ppoll(fds, (listenSocket >= 0) ? 2 : 1, &timeout, NULL);
 }
 
 // System Functions
@@ -159,16 +285,25 @@ void clearCodeFile(int ignore) {
 // Linux Main
 
 int main() {
+	signal(SIGPIPE, SIG_IGN); // a write to a closed socket should fail, not kill the VM
 	openPseudoTerminal();
+	openLocalSocket();
 	printf(
 		"Starting Linux MicroBlocks... Connect on %s\n",
 		(char*) ptsname(pty));
+	if (listenSocket >= 0) {
+		printf("Local IDE connections can also use the socket %s\n", SOCKET_PATH);
+	}
 	initTimers();
 	memInit(10000); // 10k words = 40k bytes
 	primsInit();
 	outputString("Welcome to uBlocks for Linux!");
 	restoreScripts();
 	startAll();
+	#ifdef VM_BENCHMARK
+		runBenchmarks(); // print benchmark results, then exit
+		return 0;
+	#endif
 	vmLoop();
 	return 0;
 }
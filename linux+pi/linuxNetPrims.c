@@ -30,6 +30,8 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
 #include <signal.h>
 #include <sys/types.h>
 #include <time.h>
@@ -88,10 +90,278 @@ static OBJ primGetIP(int argCount, OBJ *args) {
 	return result;
 }
 
+// Socket Readiness (epoll)
+//
+// All server and client sockets are registered with a persistent epoll set.
+// netService(), called from the VM loop's background service slot, drains any
+// pending readiness events into per-socket flags, so the primitives consult a
+// flag instead of making a read or poll system call per VM cycle. The set is
+// level-triggered, so a flag cleared after a partial read is simply raised
+// again on the next service pass if data remains.
+
+#define MAX_HTTP_CLIENTS 4
+#define EPOLL_TAG_SERVER 100 // listening socket
+#define EPOLL_TAG_CLIENT 101 // outgoing HTTP client connection
+
+static int epollFD = -1;
+static int serverSocket = -1;
+static int httpClientFDs[MAX_HTTP_CLIENTS] = {-1, -1, -1, -1};
+static char clientReadable[MAX_HTTP_CLIENTS];
+static char serverAcceptReady = 0;
+static char httpClientReadable = 0;
+static int currentHttpClient = 0;
+
+static void epollRegister(int fd, unsigned int tag) {
+	if (epollFD < 0) epollFD = epoll_create1(0);
+	if ((epollFD < 0) || (fd < 0)) return;
+	struct epoll_event evt;
+	evt.events = EPOLLIN;
+	evt.data.u32 = tag;
+	epoll_ctl(epollFD, EPOLL_CTL_ADD, fd, &evt);
+}
+
+static void epollUnregister(int fd) {
+	if ((epollFD >= 0) && (fd >= 0)) epoll_ctl(epollFD, EPOLL_CTL_DEL, fd, NULL);
+}
+
+void netService() {
+	// Drain pending socket readiness events into flags. Called from the VM
+	// loop's background service slot and before each primitive that reads.
+
+	if (epollFD < 0) return;
+	struct epoll_event events[MAX_HTTP_CLIENTS + 2];
+	int eventCount = epoll_wait(epollFD, events, MAX_HTTP_CLIENTS + 2, 0);
+	for (int i = 0; i < eventCount; i++) {
+		unsigned int tag = events[i].data.u32;
+		if (EPOLL_TAG_SERVER == tag) {
+			serverAcceptReady = 1;
+		} else if (EPOLL_TAG_CLIENT == tag) {
+			httpClientReadable = 1;
+		} else if (tag < MAX_HTTP_CLIENTS) {
+			clientReadable[tag] = 1;
+		}
+	}
+}
+
 // HTTP Server
+//
+// Mirrors the multi-client server in vm/netPrims.cpp: a small pool of client
+// connections served round-robin, reading from one client at a time (the
+// current client, which responses are also sent to) so chunked reads of a
+// single request are never interleaved across clients.
+
+// String and byte array constants returned when no data is available
+
+static struct { uint32 header; char body[4]; } noDataString = { HEADER(StringType, 1), "" };
+static uint32 emptyByteArray = HEADER(ByteArrayType, 0);
+
+static void closeHttpClient(int i) {
+	if (httpClientFDs[i] >= 0) {
+		epollUnregister(httpClientFDs[i]);
+		close(httpClientFDs[i]);
+		httpClientFDs[i] = -1;
+	}
+	clientReadable[i] = 0;
+}
+
+static void startHttpServer() {
+	// Create and register the listening socket the first time it is needed.
+
+	if (serverSocket >= 0) return;
+	serverSocket = socket(AF_INET, SOCK_STREAM, 0);
+	if (serverSocket < 0) return;
+	int flag = 1;
+	setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(80);
+	if (bind(serverSocket, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+		addr.sin_port = htons(8080); // port 80 needs privileges; fall back to 8080
+		if (bind(serverSocket, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+			close(serverSocket);
+			serverSocket = -1;
+			return;
+		}
+	}
+	listen(serverSocket, 16);
+	fcntl(serverSocket, F_SETFL, O_NONBLOCK);
+	epollRegister(serverSocket, EPOLL_TAG_SERVER);
+}
+
+static int clientAvailable(int i) {
+	// Return the number of buffered bytes available to read from the given client slot.
+
+	int byteCount = 0;
+	if (httpClientFDs[i] < 0) return 0;
+	if (ioctl(httpClientFDs[i], FIONREAD, &byteCount) < 0) return 0;
+	return byteCount;
+}
 
-static OBJ primHttpServerGetRequest(int argCount, OBJ *args) { return falseObj; }
-static OBJ primRespondToHttpRequest(int argCount, OBJ *args) { return falseObj; }
+static void acceptHttpClients() {
+	// Accept waiting connections into free pool slots without blocking.
+
+	if (!serverAcceptReady || (serverSocket < 0)) return;
+	for (int i = 0; i < MAX_HTTP_CLIENTS; i++) {
+		if (httpClientFDs[i] >= 0) continue; // slot in use
+		int fd = accept(serverSocket, NULL, NULL);
+		if (fd < 0) {
+			serverAcceptReady = 0; // no more waiting connections
+			return;
+		}
+		fcntl(fd, F_SETFL, O_NONBLOCK);
+		int flag = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (void *) &flag, sizeof(flag));
+		httpClientFDs[i] = fd;
+		clientReadable[i] = 0;
+		epollRegister(fd, i);
+	}
+}
+
+static int serverHasClient() {
+	// Return true when some client has request data to read, making that client
+	// current. Continue to return data from the current client while it has any;
+	// otherwise move on to the next client with data, round-robin. Start the
+	// HTTP server the first time this is called.
+
+	if (serverSocket < 0) startHttpServer();
+	netService(); // pick up readiness events since the last service pass
+	acceptHttpClients();
+
+	for (int i = 0; i <= MAX_HTTP_CLIENTS; i++) {
+		int c = (currentHttpClient + i) % MAX_HTTP_CLIENTS;
+		if (!clientReadable[c]) continue;
+		if (clientAvailable(c) > 0) {
+			currentHttpClient = c;
+			return true;
+		}
+		closeHttpClient(c); // readable with no data: peer closed the connection
+	}
+	return false;
+}
+
+static OBJ primHttpServerGetRequest(int argCount, OBJ *args) {
+	// Return some data from the current HTTP request. Return the empty string if no
+	// data is available. If the optional first argument is true, return a ByteArray
+	// (binary data) instead of a string.
+	// Fail if there isn't enough memory to allocate the result object.
+
+	int useBinary = ((argCount > 0) && (trueObj == args[0]));
+	OBJ noData = useBinary ? (OBJ) &emptyByteArray : (OBJ) &noDataString;
+
+	if (!serverHasClient()) return noData; // no client with request data
+
+	int byteCount = clientAvailable(currentHttpClient);
+	if (byteCount <= 0) return noData;
+	if (byteCount > 800) byteCount = 800; // limit to 800 bytes per chunk
+
+	OBJ result;
+	if (useBinary) {
+		result = newObj(ByteArrayType, (byteCount + 3) / 4, falseObj);
+		while (falseObj == result) {
+			if (byteCount < 4) return falseObj; // out of memory
+			byteCount = byteCount / 2;
+			result = newObj(ByteArrayType, (byteCount + 3) / 4, falseObj); // try to allocate half the previous amount
+		}
+		if (IS_TYPE(result, ByteArrayType)) setByteCountAdjust(result, byteCount);
+	} else {
+		result = newString(byteCount);
+		while (falseObj == result) {
+			if (byteCount < 4) return falseObj; // out of memory
+			byteCount = byteCount / 2;
+			result = newString(byteCount); // try to allocate half the previous amount
+		}
+	}
+
+	fail(noError); // clear memory allocation error, if any
+	byteCount = read(httpClientFDs[currentHttpClient], (uint8 *) &FIELD(result, 0), byteCount);
+	if (byteCount < 0) byteCount = 0;
+	clientReadable[currentHttpClient] = (clientAvailable(currentHttpClient) > 0);
+	return result;
+}
+
+static void writeToClient(int fd, const char *data, int byteCount) {
+	// Write all of the given data, retrying when the non-blocking socket's
+	// buffer is momentarily full.
+
+	int offset = 0;
+	while (offset < byteCount) {
+		int n = write(fd, data + offset, byteCount - offset);
+		if (n < 0) {
+			if ((EAGAIN == errno) || (EWOULDBLOCK == errno)) {
+				processMessage(); // process messages while waiting for buffer space
+				continue;
+			}
+			return; // client went away
+		}
+		offset += n;
+	}
+}
+
+static void writeStrToClient(int fd, const char *s) {
+	writeToClient(fd, s, strlen(s));
+}
+
+static OBJ primRespondToHttpRequest(int argCount, OBJ *args) {
+	// Send a response to the current client with the status, optional extra headers, and optional body.
+
+	int fd = httpClientFDs[currentHttpClient];
+	if (fd < 0) return falseObj;
+
+	// status
+	char *status = (char *) "200 OK";
+	if ((argCount > 0) && IS_TYPE(args[0], StringType)) status = obj2str(args[0]);
+
+	// body
+	int contentLength = -1; // no body
+	if (argCount > 1) {
+		if (IS_TYPE(args[1], StringType)) {
+			contentLength = strlen(obj2str(args[1]));
+		} else if (IS_TYPE(args[1], ByteArrayType)) {
+			contentLength = BYTES(args[1]);
+		}
+	}
+
+	// additional headers
+	char *extraHeaders = NULL;
+	if ((argCount > 2) && IS_TYPE(args[2], StringType)) {
+		extraHeaders = obj2str(args[2]);
+		if (0 == strlen(extraHeaders)) extraHeaders = NULL; // empty string
+	}
+
+	// keep alive flag
+	int keepAlive = ((argCount > 3) && (trueObj == args[3]));
+
+	// send headers
+	writeStrToClient(fd, "HTTP/1.0 ");
+	writeStrToClient(fd, status);
+	writeStrToClient(fd, "\r\nAccess-Control-Allow-Origin: *\r\n");
+	if (keepAlive) writeStrToClient(fd, "Connection: keep-alive\r\n");
+	if (extraHeaders) {
+		writeStrToClient(fd, extraHeaders);
+		if (10 != extraHeaders[strlen(extraHeaders) - 1]) writeStrToClient(fd, "\r\n");
+	}
+	if (contentLength >= 0) {
+		char s[50];
+		sprintf(s, "Content-Length: %i", contentLength);
+		writeStrToClient(fd, s);
+	}
+	writeStrToClient(fd, "\r\n\r\n"); // end of headers
+
+	// send body, if any
+	if (argCount > 1) {
+		if (IS_TYPE(args[1], StringType)) {
+			writeToClient(fd, obj2str(args[1]), contentLength);
+		} else if (IS_TYPE(args[1], ByteArrayType)) {
+			writeToClient(fd, (char *) &FIELD(args[1], 0), contentLength);
+		}
+	}
+
+	if (!keepAlive) closeHttpClient(currentHttpClient); // close the connection
+	return falseObj;
+}
 
 // HTTP Client
 
@@ -112,7 +382,12 @@ static OBJ primHttpConnect(int argCount, OBJ *args) {
 	char* host = obj2str(args[0]);
 	int port = ((argCount > 1) && isInt(args[1])) ? obj2int(args[1]) : 80;
 
-	if (clientSocket) shutdown(clientSocket, 2);
+	if (clientSocket) {
+		epollUnregister(clientSocket);
+		shutdown(clientSocket, 2);
+		close(clientSocket);
+		clientSocket = 0;
+	}
 
 	struct sockaddr_in remoteAddress;
 
@@ -144,6 +419,11 @@ static OBJ primHttpConnect(int argCount, OBJ *args) {
 	int flag = 1;
 	setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, (void *) &flag, sizeof(flag));
 
+	if (clientSocket > 0) {
+		epollRegister(clientSocket, EPOLL_TAG_CLIENT);
+		httpClientReadable = 0;
+	}
+
 	processMessage(); // process messages now
 	return falseObj;
 }
@@ -197,18 +477,30 @@ static OBJ primHttpRequest(int argCount, OBJ *args) {
 }
 
 static OBJ primHttpResponse(int argCount, OBJ *args) {
-	// Read some HTTP request data, if any is available, otherwise return the empty string.
-	OBJ response;
-	char buffer[800];
-	int n, byteCount = 0;
-
-	while ((n = (read(clientSocket, buffer, 64))) > 0 && byteCount <= 800) {
-		buffer[n] = '\0';
-		byteCount += n;
-		processMessage(); // process messages now
-	}
-	response = newString(byteCount);
-	memcpy(obj2str(response), buffer, byteCount > 800 ? 800 : byteCount);
+	// Return up to 800 bytes of response data, or the empty string if none has arrived.
+
+	netService(); // pick up readiness events since the last service pass
+	if (!httpClientReadable || (clientSocket <= 0)) return (OBJ) &noDataString;
+
+	int byteCount = 0;
+	ioctl(clientSocket, FIONREAD, &byteCount);
+	if (byteCount <= 0) {
+		// readable with no data: the server has closed the connection
+		epollUnregister(clientSocket);
+		shutdown(clientSocket, 2);
+		close(clientSocket);
+		clientSocket = 0;
+		httpClientReadable = 0;
+		return (OBJ) &noDataString;
+	}
+	if (byteCount > 800) byteCount = 800; // limit to 800 bytes per chunk
+
+	OBJ response = newString(byteCount);
+	if (falseObj == response) return fail(insufficientMemoryError);
+	byteCount = read(clientSocket, obj2str(response), byteCount);
+	int pending = 0;
+	ioctl(clientSocket, FIONREAD, &pending);
+	httpClientReadable = (pending > 0);
 	return response;
 }
 
@@ -229,3 +521,6 @@ static PrimEntry entries[] = {
 void addNetPrims() {
 	addPrimitiveSet("net", sizeof(entries) / sizeof(PrimEntry), entries);
 }
+
+void mqttService() {} // MQTT is not supported on this platform
+
@@ -10,10 +10,12 @@
 #define _XOPEN_SOURCE 600
 
 #include <fcntl.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/time.h>
 #include <unistd.h>
 
@@ -89,6 +91,20 @@ int sendByte(char aByte) {
 	return write(fd, &aByte, 1);
 }
 
+int sendBytes(uint8 *buf, int count) {
+	int fd = (pty > 0) ? pty : serialPort;
+	return write(fd, buf, count);
+}
+
+void idleSleep(int microsecsToSleep) {
+	// Called by the scheduler when no task is runnable. Sleep until serial data
+	// arrives or the timeout expires rather than spinning; an idle program
+	// otherwise pegs an entire core.
+
+	struct pollfd fds = { (pty > 0) ? pty : serialPort, POLLIN, 0 };
+	poll(&fds, 1, (microsecsToSleep + 999) / 1000);
+}
+
 // System Functions
 
 const char * boardType() { return "Raspberry Pi"; }
@@ -124,6 +140,37 @@ static void initPins(void) {
 	for (int i = 0; i < TOTAL_PINS; i++) currentMode[i] = MODE_NOT_SET;
 }
 
+// GPIO Fast Path
+//
+// Going through the library layer costs a function call (and sometimes a
+// syscall) per pin operation, limiting toggle rates and adding jitter. Map
+// the GPIO register block once via /dev/gpiomem (accessible to the gpio
+// group without root) and do digital reads and writes as direct register
+// loads and stores. Pin modes are still set through the library, which keeps
+// its pin bookkeeping consistent; only level operations take the fast path.
+// If /dev/gpiomem can't be mapped, everything falls back to library calls.
+
+// GPIO register word offsets (BCM283x): set, clear, and level for pins 0-31
+#define GPSET0 7
+#define GPCLR0 10
+#define GPLEV0 13
+
+static volatile uint32 *gpioRegs = NULL;
+static char bcmPinForPin[TOTAL_PINS]; // wiringPi pin -> BCM pin number cache
+
+static void initGPIOFastPath(void) {
+	int fd = open("/dev/gpiomem", O_RDWR | O_SYNC);
+	if (fd < 0) return; // not a Pi, or no access; use library calls
+	void *mapped = mmap(NULL, 4096, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (MAP_FAILED == mapped) return;
+	gpioRegs = (volatile uint32 *) mapped;
+	for (int i = 0; i < TOTAL_PINS; i++) {
+		int bcm = wpiPinToGpio(i);
+		bcmPinForPin[i] = ((bcm >= 0) && (bcm < 32)) ? bcm : -1;
+	}
+}
+
 // Pin IO Primitives
 
 OBJ primAnalogPins(OBJ *args) { return int2obj(ANALOG_PINS); }
@@ -136,6 +183,9 @@ OBJ primDigitalRead(OBJ *args) {
 	int pinNum = obj2int(args[0]);
 	if ((pinNum < 0) || (pinNum >= TOTAL_PINS)) return falseObj;
 	SET_MODE(pinNum, INPUT);
+	if (gpioRegs && (bcmPinForPin[pinNum] >= 0)) {
+		return (gpioRegs[GPLEV0] & (1 << bcmPinForPin[pinNum])) ? trueObj : falseObj;
+	}
 	return (HIGH == digitalRead(pinNum)) ? trueObj : falseObj;
 }
 
@@ -148,6 +198,10 @@ void primDigitalWrite(OBJ *args) {
 void primDigitalSet(int pinNum, int flag) {
 	if ((pinNum < 0) || (pinNum >= TOTAL_PINS)) return;
 	SET_MODE(pinNum, OUTPUT);
+	if (gpioRegs && (bcmPinForPin[pinNum] >= 0)) {
+		gpioRegs[flag ? GPSET0 : GPCLR0] = (1 << bcmPinForPin[pinNum]);
+		return;
+	}
 	digitalWrite(pinNum, flag);
 };
 
@@ -219,6 +273,8 @@ void turnOffPins() {}
 void addDisplayPrims() {}
 void addIOPrims() {}
 void addNetPrims() {}
+void mqttService() {}
+void netService() {}
 void primWifiConnect(OBJ *args) {}
 int wifiStatus() { return 0; }
 OBJ primMakeWebThing(int argCount, OBJ *args) { return falseObj; }
@@ -239,6 +295,7 @@ int main(int argc, char *argv[]) {
 	wiringPiSetup();
 	initTimers();
 	initPins();
+	initGPIOFastPath();
 	memInit(5000); // 5k words = 20k bytes
 	restoreScripts();
 	startAll();
@@ -0,0 +1,192 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Copyright 2018 John Maloney, Bernat Romagosa, and Jens Mönig
+
+// benchmark.c - Interpreter benchmark suite
+// Compiled in when the VM is built with -DVM_BENCHMARK (see [env:benchmark] in
+// platformio.ini and linux+pi/buildBenchmarkLinux.sh). runBenchmarks() loads a
+// set of canned bytecode chunks (dispatch-bound loop, list churn, string joins,
+// GC stress), runs each to completion with runTasksUntilDone(), and reports
+// ops/sec and a GC pause histogram via outputString(). Results from two VM builds
+// on the same board can be compared directly before rolling out a release.
+
+#ifdef VM_BENCHMARK
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mem.h"
+#include "interp.h"
+#include "persist.h"
+
+// opcodes used by the benchmark chunks (see MicroBlocksCompiler.gp for the complete set)
+#define pushImmediate 2
+#define pushLiteral 4
+#define pushVar 5
+#define storeVar 6
+#define incrementVar 7
+#define jmpFalse 18
+#define decrementAndJmp 19
+#define halt 0
+#define add 42
+#define bitAnd 50
+#define newList 60
+#define at 63
+#define atPut 64
+#define callReporterPrimitive 127
+
+// encode a small integer as an immediate argument (tagged integer object)
+#define INT_ARG(n) (((n) << 1) | 1)
+
+// pack four bytes of an inline string literal into a code word (little endian)
+#define W4(a, b, c, d) (((uint32) (d) << 24) | ((uint32) (c) << 16) | ((uint32) (b) << 8) | (uint32) (a))
+
+#define BENCH_CHUNK_INDEX (MAX_CHUNKS - 1)
+
+// Benchmark Chunks
+//
+// Each chunk is the code a "repeat" loop compiles to: push the iteration count,
+// run the loop body, then decrementAndJmp back to the body. Chunks are passed
+// through fuseChunkData() before running, so they measure the same fused code
+// that the VM executes in production.
+
+#define DISPATCH_ITERATIONS 50000
+
+// repeat N { var0 += 1 } -- pure dispatch and arithmetic, no allocation
+static uint32 dispatchBench[] = {
+	OP(pushImmediate, INT_ARG(0)),
+	OP(storeVar, 0),
+	OP(pushImmediate, INT_ARG(DISPATCH_ITERATIONS)),
+	OP(pushVar, 0),
+	OP(pushImmediate, INT_ARG(1)),
+	OP(add, 2),
+	OP(storeVar, 0),
+	OP(decrementAndJmp, -5),
+	OP(halt, 0),
+};
+
+#define CHURN_ITERATIONS 5000
+
+// repeat N { var1 = newList(50); atPut 1 var1 42; var2 = at 1 var1 } -- list allocation churn
+static uint32 listChurnBench[] = {
+	OP(pushImmediate, INT_ARG(CHURN_ITERATIONS)),
+	OP(pushImmediate, INT_ARG(50)),
+	OP(newList, 1),
+	OP(storeVar, 1),
+	OP(pushImmediate, INT_ARG(1)),
+	OP(pushVar, 1),
+	OP(pushImmediate, INT_ARG(42)),
+	OP(atPut, 3),
+	OP(pushImmediate, INT_ARG(1)),
+	OP(pushVar, 1),
+	OP(at, 2),
+	OP(storeVar, 2),
+	OP(decrementAndJmp, -12),
+	OP(halt, 0),
+};
+
+#define JOIN_ITERATIONS 5000
+
+// repeat N { var3 = join 'abc' 'def' } -- named primitive call plus small string allocation
+static uint32 stringJoinBench[] = {
+	OP(pushImmediate, INT_ARG(JOIN_ITERATIONS)),
+	OP(pushLiteral, 7), // 'data'
+	OP(pushLiteral, 9), // 'join'
+	OP(pushLiteral, 11), // 'abc'
+	OP(pushLiteral, 12), // 'def'
+	OP(callReporterPrimitive, 4),
+	OP(storeVar, 3),
+	OP(decrementAndJmp, -7),
+	OP(halt, 0),
+	// literals
+	HEADER(StringType, 2), W4('d', 'a', 't', 'a'), 0, // 'data'
+	HEADER(StringType, 2), W4('j', 'o', 'i', 'n'), 0, // 'join'
+	HEADER(StringType, 1), W4('a', 'b', 'c', 0), // 'abc'
+	HEADER(StringType, 1), W4('d', 'e', 'f', 0), // 'def'
+};
+
+#define GC_STRESS_ITERATIONS 5000
+
+// var4 = newList(20); repeat N { var5 += 1; atPut ((var5 & 15) + 1) var4 newList(30) }
+// keeps a rotating window of lists live so every collection has both live and dead objects
+static uint32 gcStressBench[] = {
+	OP(pushImmediate, INT_ARG(20)),
+	OP(newList, 1),
+	OP(storeVar, 4),
+	OP(pushImmediate, INT_ARG(0)),
+	OP(storeVar, 5),
+	OP(pushImmediate, INT_ARG(GC_STRESS_ITERATIONS)),
+	OP(pushImmediate, INT_ARG(1)),
+	OP(incrementVar, 5),
+	OP(pushVar, 5),
+	OP(pushImmediate, INT_ARG(15)),
+	OP(bitAnd, 2),
+	OP(pushImmediate, INT_ARG(1)),
+	OP(add, 2),
+	OP(pushVar, 4),
+	OP(pushImmediate, INT_ARG(30)),
+	OP(newList, 1),
+	OP(atPut, 3),
+	OP(decrementAndJmp, -12),
+	OP(halt, 0),
+};
+
+// Benchmark Runner
+
+static void runBenchmarkChunk(const char *name, uint32 *code, int wordCount, int opsPerIteration, int iterations) {
+	// Store the given chunk, run it to completion, and report ops/sec and GC pauses.
+
+	char s[200];
+	uint32 fused[64];
+	if (wordCount > 64) return;
+	memcpy(fused, code, wordCount * 4);
+	fuseChunkData((uint8 *) fused, wordCount * 4); // run the code the VM would actually execute
+	int *record = appendPersistentRecord(chunkCode, BENCH_CHUNK_INDEX, command, wordCount * 4, (uint8 *) fused);
+	if (!record) {
+		outputString("Benchmark: could not store code chunk");
+		return;
+	}
+	chunks[BENCH_CHUNK_INDEX].code = record;
+	chunks[BENCH_CHUNK_INDEX].chunkType = command;
+
+	gcClearPauseStats();
+	uint32 startTime = microsecs();
+	startTaskForChunk(BENCH_CHUNK_INDEX);
+	runTasksUntilDone();
+	uint32 usecs = microsecs() - startTime;
+	if (!usecs) usecs = 1;
+
+	uint32 opsPerSec = (uint32) (((unsigned long long) opsPerIteration * iterations * 1000000) / usecs);
+	sprintf(s, "%s: %u usecs, %u ops/sec", name, usecs, opsPerSec);
+	outputString(s);
+	sprintf(s, "  GC pauses: <250us %u | <500us %u | <1ms %u | <2ms %u | <4ms %u | <8ms %u | <16ms %u | >=16ms %u",
+		gcPauseHistogram[0], gcPauseHistogram[1], gcPauseHistogram[2], gcPauseHistogram[3],
+		gcPauseHistogram[4], gcPauseHistogram[5], gcPauseHistogram[6], gcPauseHistogram[7]);
+	outputString(s);
+}
+
+void runBenchmarks() {
+	// Run the interpreter benchmark suite and report results via outputString().
+	// The benchmark chunk is stored at the last chunk index; it is a plain command
+	// chunk, so it will not auto-start if it is later restored from persistent memory.
+
+	char s[100];
+	sprintf(s, "MicroBlocks benchmarks (%s, %d words free)", boardType(), wordsFree());
+	outputString(s);
+
+	runBenchmarkChunk("dispatch", dispatchBench,
+		sizeof(dispatchBench) / 4, 5, DISPATCH_ITERATIONS);
+	runBenchmarkChunk("list churn", listChurnBench,
+		sizeof(listChurnBench) / 4, 12, CHURN_ITERATIONS);
+	runBenchmarkChunk("string join", stringJoinBench,
+		sizeof(stringJoinBench) / 4, 7, JOIN_ITERATIONS);
+	runBenchmarkChunk("gc stress", gcStressBench,
+		sizeof(gcStressBench) / 4, 12, GC_STRESS_ITERATIONS);
+
+	outputString("Benchmarks done");
+}
+
+#endif // VM_BENCHMARK
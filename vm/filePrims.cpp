@@ -24,9 +24,26 @@
 static int fsInitialized = false;
 static char fullPath[32]; // used to prefix "/" to file names
 
+// Buffered I/O
+// Each open file gets a read-ahead buffer and a write-coalescing buffer.
+// Sequential line reads mostly hit RAM instead of paying filesystem overhead
+// per byte, and appended log records accumulate until the buffer fills, an
+// age limit passes, or the script flushes explicitly. The File position is
+// kept at the next unbuffered read offset; writes seek to the end and back.
+
+#define FILE_READ_BUF_SIZE 256
+#define FILE_WRITE_BUF_SIZE 256
+#define WRITE_FLUSH_MSECS 1000 // coalesced writes are flushed after this age
+
 typedef struct {
 	char fileName[32];
 	File file;
+	uint8 readBuf[FILE_READ_BUF_SIZE];
+	int readBufIndex; // index of next unread byte in readBuf
+	int readBufCount; // number of valid bytes in readBuf
+	uint8 writeBuf[FILE_WRITE_BUF_SIZE];
+	int writeBufCount;
+	uint32 firstWriteMSecs; // time of oldest unflushed write
 } FileEntry;
 
 #define FILE_ENTRIES 8
@@ -80,6 +97,98 @@ static int freeEntry() {
 	return -1; // no free entry
 }
 
+// Buffer helpers
+
+static void resetBuffers(int i) {
+	fileEntry[i].readBufIndex = 0;
+	fileEntry[i].readBufCount = 0;
+	fileEntry[i].writeBufCount = 0;
+}
+
+static void flushWrites(int i) {
+	// Write any coalesced data to the end of the file, preserving the read position.
+
+	if (!fileEntry[i].writeBufCount) return;
+	File file = fileEntry[i].file;
+	int oldPos = file.position();
+	file.seek(0, SeekEnd);
+	file.write(fileEntry[i].writeBuf, fileEntry[i].writeBufCount);
+	file.seek(oldPos, SeekSet);
+	fileEntry[i].writeBufCount = 0;
+}
+
+static void bufferedWrite(int i, uint8 *data, int byteCount) {
+	// Append data to the write buffer, flushing to the file when it fills.
+
+	if (!fileEntry[i].writeBufCount) fileEntry[i].firstWriteMSecs = millisecs();
+	while (byteCount > 0) {
+		int space = FILE_WRITE_BUF_SIZE - fileEntry[i].writeBufCount;
+		int chunk = (byteCount < space) ? byteCount : space;
+		memcpy(&fileEntry[i].writeBuf[fileEntry[i].writeBufCount], data, chunk);
+		fileEntry[i].writeBufCount += chunk;
+		data += chunk;
+		byteCount -= chunk;
+		if (fileEntry[i].writeBufCount >= FILE_WRITE_BUF_SIZE) flushWrites(i);
+	}
+}
+
+static void bufferedWriteStr(int i, const char *s) {
+	bufferedWrite(i, (uint8 *) s, strlen(s));
+}
+
+static void bufferedWriteInt(int i, int n) {
+	char s[20];
+	intToStr(n, s);
+	bufferedWriteStr(i, s);
+}
+
+static int refillReadBuf(int i) {
+	// Refill the read-ahead buffer. Return the number of bytes now available in it.
+
+	if (fileEntry[i].readBufIndex < fileEntry[i].readBufCount) {
+		return fileEntry[i].readBufCount - fileEntry[i].readBufIndex;
+	}
+	flushWrites(i); // make unflushed appends visible to the reader
+	fileEntry[i].readBufIndex = 0;
+	fileEntry[i].readBufCount = fileEntry[i].file.read(fileEntry[i].readBuf, FILE_READ_BUF_SIZE);
+	if (fileEntry[i].readBufCount < 0) fileEntry[i].readBufCount = 0;
+	return fileEntry[i].readBufCount;
+}
+
+static int bufferedRead(int i) {
+	// Return the next byte of the file or -1 at end of file.
+
+	if (!refillReadBuf(i)) return -1;
+	return fileEntry[i].readBuf[fileEntry[i].readBufIndex++];
+}
+
+static int bufferedPeek(int i) {
+	// Return the next byte of the file without consuming it, or -1 at end of file.
+
+	if (!refillReadBuf(i)) return -1;
+	return fileEntry[i].readBuf[fileEntry[i].readBufIndex];
+}
+
+static int bufferedAvailable(int i) {
+	return (fileEntry[i].readBufCount - fileEntry[i].readBufIndex) +
+		fileEntry[i].file.available() + fileEntry[i].writeBufCount;
+}
+
+static void invalidateReadBuf(int i) {
+	fileEntry[i].readBufIndex = 0;
+	fileEntry[i].readBufCount = 0;
+}
+
+static void checkWriteAge(int i) {
+	// Flush coalesced writes that have been sitting longer than WRITE_FLUSH_MSECS,
+	// so a slow logger never leaves records in RAM for long.
+
+	if (fileEntry[i].writeBufCount &&
+		((millisecs() - fileEntry[i].firstWriteMSecs) > WRITE_FLUSH_MSECS)) {
+			flushWrites(i);
+	}
+}
+
 // Open, Close, Delete
 
 static OBJ primOpen(int argCount, OBJ *args) {
@@ -90,9 +199,11 @@ static OBJ primOpen(int argCount, OBJ *args) {
 	initFS();
 	int i = entryFor(fileName);
 	if (i >= 0) { // found an existing entry; close and reopen
+		flushWrites(i);
 		fileEntry[i].file.close();
 		fileEntry[i].file = myFS.open(fileName, "a+");
 		fileEntry[i].file.seek(0, SeekSet); // read from start of file
+		resetBuffers(i);
 		return falseObj;
 	}
 
@@ -102,6 +213,7 @@ static OBJ primOpen(int argCount, OBJ *args) {
 		strncat(fileEntry[i].fileName, fileName, 31);
 		fileEntry[i].file = myFS.open(fileName, "a+");
 		fileEntry[i].file.seek(0, SeekSet); // read from start of file
+		resetBuffers(i);
 	}
 	return falseObj;
 }
@@ -113,6 +225,7 @@ static OBJ primClose(int argCount, OBJ *args) {
 	initFS();
 	int i = entryFor(fileName);
 	if (i >= 0) {
+		flushWrites(i);
 		fileEntry[i].fileName[0] = '\0';
 		fileEntry[i].file.close();
 		return falseObj;
@@ -129,6 +242,7 @@ static OBJ primDelete(int argCount, OBJ *args) {
 	int i = entryFor(fileName);
 	if (i >= 0) {
 		fileEntry[i].fileName[0] = '\0';
+		fileEntry[i].writeBufCount = 0; // discard unflushed writes
 		fileEntry[i].file.close();
 	}
 	if (myFS.exists(fileName)) myFS.remove(fileName);
@@ -144,7 +258,7 @@ static OBJ primEndOfFile(int argCount, OBJ *args) {
 	int i = entryFor(fileName);
 	if (i < 0) return trueObj;
 
-	return (!fileEntry[i].file.available()) ? trueObj : falseObj;
+	return (!bufferedAvailable(i)) ? trueObj : falseObj;
 }
 
 static OBJ primReadLine(int argCount, OBJ *args) {
@@ -154,14 +268,14 @@ static OBJ primReadLine(int argCount, OBJ *args) {
 	int i = entryFor(fileName);
 	if (i < 0) return newString(0);
 
-	File file = fileEntry[i].file;
 	char buf[800];
 	uint32 byteCount = 0;
-	while ((byteCount < sizeof(buf)) && file.available()) {
-		int ch = file.read();
+	while (byteCount < sizeof(buf)) {
+		int ch = bufferedRead(i);
+		if (ch < 0) break; // end of file
 		if ((10 == ch) || (13 == ch)) {
-			if ((10 == ch) && (13 == file.peek())) file.read(); // lf-cr ending
-			if ((13 == ch) && (10 == file.peek())) file.read(); // cr-lf ending
+			if ((10 == ch) && (13 == bufferedPeek(i))) bufferedRead(i); // lf-cr ending
+			if ((13 == ch) && (10 == bufferedPeek(i))) bufferedRead(i); // cr-lf ending
 			break;
 		}
 		buf[byteCount++] = ch;
@@ -183,9 +297,15 @@ static OBJ primReadBytes(int argCount, OBJ *args) {
 	if (i >= 0) {
 		uint8 buf[800];
 		if (byteCount > sizeof(buf)) byteCount = sizeof(buf);
+		flushWrites(i);
 		if ((argCount > 2) && isInt(args[2])) {
 			fileEntry[i].file.seek(obj2int(args[2]), SeekSet);
+		} else if (fileEntry[i].readBufIndex < fileEntry[i].readBufCount) {
+			// back up to the logical read position before bypassing the read-ahead buffer
+			int unread = fileEntry[i].readBufCount - fileEntry[i].readBufIndex;
+			fileEntry[i].file.seek(fileEntry[i].file.position() - unread, SeekSet);
 		}
+		invalidateReadBuf(i);
 		byteCount = fileEntry[i].file.read(buf, byteCount);
 		if (!byteCount && fileEntry[i].file.available()) {
 			// workaround for rare read error -- skip to the next block
@@ -217,33 +337,29 @@ static OBJ primAppendLine(int argCount, OBJ *args) {
 
 	int i = entryFor(fileName);
 	if (i >= 0) {
-		File file = fileEntry[i].file;
-		int oldPos = file.position();
-		int oldSize = file.size();
-		if (oldPos != oldSize) file.seek(0, SeekEnd); // seek to current end
 		if (IS_TYPE(arg, StringType)) {
-			fileEntry[i].file.print(obj2str(arg));
+			bufferedWriteStr(i, obj2str(arg));
 		} else if (isInt(arg)) {
-			fileEntry[i].file.print(obj2int(arg));
+			bufferedWriteInt(i, obj2int(arg));
 		} else if (isBoolean(arg)) {
-			fileEntry[i].file.print((trueObj == arg) ? "true" : "false");
+			bufferedWriteStr(i, (trueObj == arg) ? "true" : "false");
 		} else if (IS_TYPE(arg, ListType)) {
 			// print list items separated by spaces
 			int count = obj2int(FIELD(arg, 0));
 			for (int j = 1; j <= count; j++) {
 				OBJ item = FIELD(arg, j);
 				if (IS_TYPE(item, StringType)) {
-					fileEntry[i].file.print(obj2str(item));
+					bufferedWriteStr(i, obj2str(item));
 				} else if (isInt(item)) {
-					fileEntry[i].file.print(obj2int(item));
+					bufferedWriteInt(i, obj2int(item));
 				} else if (isBoolean(item)) {
-					fileEntry[i].file.print((trueObj == item) ? "true" : "false");
+					bufferedWriteStr(i, (trueObj == item) ? "true" : "false");
 				}
-				if (j < count) fileEntry[i].file.write(32); // space
+				if (j < count) bufferedWriteStr(i, " ");
 			}
 		}
-		fileEntry[i].file.write(10); // newline
-		if (oldPos != oldSize) file.seek(oldPos, SeekSet); // reset position for reading
+		bufferedWriteStr(i, "\n");
+		checkWriteAge(i);
 	}
 	processMessage();
 	return falseObj;
@@ -259,17 +375,166 @@ static OBJ primAppendBytes(int argCount, OBJ *args) {
 	int i = entryFor(fileName);
 	if (i < 0) return falseObj;
 
-	File f = fileEntry[i].file;
 	if (IS_TYPE(data, ByteArrayType)) {
-		f.write((uint8 *) &FIELD(data, 0), BYTES(data));
+		bufferedWrite(i, (uint8 *) &FIELD(data, 0), BYTES(data));
 	} else if (IS_TYPE(data, StringType)) {
 		char *s = obj2str(data);
-		f.write((uint8 *) s, strlen(s));
+		bufferedWrite(i, (uint8 *) s, strlen(s));
 	}
+	checkWriteAge(i);
 	processMessage();
 	return falseObj;
 }
 
+static OBJ primFlush(int argCount, OBJ *args) {
+	// Write any coalesced data for the given file to the filesystem.
+
+	if (argCount < 1) return fail(notEnoughArguments);
+	char *fileName = extractFilename(args[0]);
+
+	int i = entryFor(fileName);
+	if (i >= 0) {
+		flushWrites(i);
+		fileEntry[i].file.flush();
+	}
+	return falseObj;
+}
+
+// Datalog
+// A log-structured, append-only store of fixed binary records, far denser than
+// formatted text lines and cheaper to write. Each record is a marker byte, a
+// field count, a 4-byte msec timestamp, and 4-byte little-endian integer fields
+// (booleans are stored as 0/1). Records are staged in a RAM buffer sized to the
+// 256-byte flash page and written a page at a time, cutting write wear and
+// filesystem overhead. Reading is cursor-based: datalogReadStart rewinds, then
+// datalogReadNext returns one record per call as a list (timestamp first).
+// The log lives in a regular file (/datalog), so the IDE's windowed file
+// transfer can fetch it; transfers flush staged records first (see datalogFlush
+// calls in fileTransfer.cpp).
+
+#define DATALOG_FILE "/datalog"
+#define DATALOG_BUF_SIZE 256 // one flash page
+#define DATALOG_MAX_FIELDS 8
+#define DATALOG_MARKER 0xA5
+
+static uint8 datalogBuf[DATALOG_BUF_SIZE];
+static int datalogBufCount = 0;
+static File datalogFile; // append handle; opened on first use
+static File datalogReadFile; // read cursor
+
+static void datalogWriteInt(uint8 *dst, int n) {
+	dst[0] = n & 255;
+	dst[1] = (n >> 8) & 255;
+	dst[2] = (n >> 16) & 255;
+	dst[3] = (n >> 24) & 255;
+}
+
+static int datalogReadInt(uint8 *src) {
+	return (src[3] << 24) | (src[2] << 16) | (src[1] << 8) | src[0];
+}
+
+void datalogFlush() {
+	// Write staged records to the log file. Called when the staging buffer fills,
+	// by the flush prim, and before the log file is read or transferred.
+
+	if (!datalogBufCount) return;
+	initFS();
+	if (!datalogFile) datalogFile = myFS.open(DATALOG_FILE, "a");
+	if (datalogFile) {
+		datalogFile.write(datalogBuf, datalogBufCount);
+		datalogFile.flush();
+	}
+	datalogBufCount = 0;
+}
+
+static OBJ primDatalogAdd(int argCount, OBJ *args) {
+	// Append one record with the current time and the given integer or boolean fields.
+
+	if (argCount < 1) return fail(notEnoughArguments);
+	if (argCount > DATALOG_MAX_FIELDS) argCount = DATALOG_MAX_FIELDS;
+
+	uint8 record[6 + (4 * DATALOG_MAX_FIELDS)];
+	record[0] = DATALOG_MARKER;
+	record[1] = argCount;
+	datalogWriteInt(&record[2], millisecs());
+	for (int i = 0; i < argCount; i++) {
+		OBJ arg = args[i];
+		int value = 0;
+		if (isInt(arg)) {
+			value = obj2int(arg);
+		} else if (isBoolean(arg)) {
+			value = (trueObj == arg);
+		} else {
+			return fail(needsIntegerError);
+		}
+		datalogWriteInt(&record[6 + (4 * i)], value);
+	}
+	int recordSize = 6 + (4 * argCount);
+
+	if ((datalogBufCount + recordSize) > DATALOG_BUF_SIZE) datalogFlush();
+	memcpy(&datalogBuf[datalogBufCount], record, recordSize);
+	datalogBufCount += recordSize;
+	return falseObj;
+}
+
+static OBJ primDatalogSize(int argCount, OBJ *args) {
+	// Return the size of the log in bytes, including staged records.
+
+	initFS();
+	int size = 0;
+	File file = myFS.open(DATALOG_FILE, "r");
+	if (file) {
+		size = file.size();
+		file.close();
+	}
+	return int2obj(size + datalogBufCount);
+}
+
+static OBJ primDatalogClear(int argCount, OBJ *args) {
+	datalogBufCount = 0;
+	if (datalogFile) datalogFile.close();
+	if (datalogReadFile) datalogReadFile.close();
+	initFS();
+	if (myFS.exists(DATALOG_FILE)) myFS.remove(DATALOG_FILE);
+	return falseObj;
+}
+
+static OBJ primDatalogReadStart(int argCount, OBJ *args) {
+	// Rewind the read cursor to the first record.
+
+	datalogFlush();
+	initFS();
+	if (datalogReadFile) datalogReadFile.close();
+	datalogReadFile = myFS.open(DATALOG_FILE, "r");
+	return falseObj;
+}
+
+static OBJ primDatalogReadNext(int argCount, OBJ *args) {
+	// Return the record at the read cursor as a list (timestamp, then fields)
+	// and advance the cursor. Return false when there are no more records.
+
+	if (!datalogReadFile) return falseObj;
+
+	uint8 record[6 + (4 * DATALOG_MAX_FIELDS)];
+	if (2 != datalogReadFile.read(record, 2)) return falseObj; // end of log
+	int fieldCount = record[1];
+	if ((DATALOG_MARKER != record[0]) ||
+		(fieldCount < 1) || (fieldCount > DATALOG_MAX_FIELDS)) {
+			return falseObj; // corrupt record; stop reading
+	}
+	int bodySize = 4 + (4 * fieldCount);
+	if (bodySize != datalogReadFile.read(&record[2], bodySize)) return falseObj; // truncated
+
+	OBJ result = newObj(ListType, fieldCount + 2, zeroObj);
+	if (!result) return fail(insufficientMemoryError);
+	FIELD(result, 0) = int2obj(fieldCount + 1);
+	FIELD(result, 1) = int2obj(datalogReadInt(&record[2])); // timestamp
+	for (int i = 0; i < fieldCount; i++) {
+		FIELD(result, i + 2) = int2obj(datalogReadInt(&record[6 + (4 * i)]));
+	}
+	return result;
+}
+
 // File list
 
 // Root directory used for listing files
@@ -284,6 +549,9 @@ static OBJ primFileSize(int argCount, OBJ *args) {
 	char *fileName = extractFilename(args[0]);
 	if (!fileName[0]) return int2obj(0);
 
+	int i = entryFor(fileName);
+	if (i >= 0) flushWrites(i); // include coalesced writes in the size
+
 	File file = myFS.open(fileName, "r");
 	if (!file) return int2obj(0);
 	file.seek(0, SeekEnd); // seek to end
@@ -360,6 +628,14 @@ static OBJ primReadLine(int argCount, OBJ *args) { return falseObj; }
 static OBJ primReadBytes(int argCount, OBJ *args) { return falseObj; }
 static OBJ primAppendLine(int argCount, OBJ *args) { return falseObj; }
 static OBJ primAppendBytes(int argCount, OBJ *args) { return falseObj; }
+static OBJ primFlush(int argCount, OBJ *args) { return falseObj; }
+static OBJ primDatalogAdd(int argCount, OBJ *args) { return falseObj; }
+static OBJ primDatalogSize(int argCount, OBJ *args) { return zeroObj; }
+static OBJ primDatalogClear(int argCount, OBJ *args) { return falseObj; }
+static OBJ primDatalogReadStart(int argCount, OBJ *args) { return falseObj; }
+static OBJ primDatalogReadNext(int argCount, OBJ *args) { return falseObj; }
+
+void datalogFlush() { }
 static OBJ primFileSize(int argCount, OBJ *args) { return zeroObj; };
 static OBJ primStartFileList(int argCount, OBJ *args) { return falseObj; }
 static OBJ primNextFileInList(int argCount, OBJ *args) { return newString(0); }
@@ -378,6 +654,12 @@ static PrimEntry entries[] = {
 	{"readBytes", primReadBytes},
 	{"appendLine", primAppendLine},
 	{"appendBytes", primAppendBytes},
+	{"flush", primFlush},
+	{"datalogAdd", primDatalogAdd},
+	{"datalogSize", primDatalogSize},
+	{"datalogClear", primDatalogClear},
+	{"datalogReadStart", primDatalogReadStart},
+	{"datalogReadNext", primDatalogReadNext},
 	{"fileSize", primFileSize},
 	{"startList", primStartFileList},
 	{"nextInList", primNextFileInList},
@@ -21,6 +21,9 @@
 #define StartReadingFileMsg 203
 #define StartWritingFileMsg 204
 #define FileChunkMsg 205
+#define StartReadingWindowedMsg 206
+#define FileWindowCRCMsg 207
+#define FileWindowAckMsg 208
 
 #if defined(ESP8266) || defined(ARDUINO_ARCH_ESP32)
 // File system operations for Espressif boards
@@ -113,6 +116,8 @@ static void sendFile(int id, char *fileName) {
 	int byteIndex = 0;
 	char buf[1024];
 
+	datalogFlush(); // make staged datalog records visible to transfers
+
 	File file = myFS.open(fileName, "r");
 	if (!file) return; // could not open file
 	while (file.available()) { // send file chunks
@@ -131,6 +136,110 @@ static void sendFile(int id, char *fileName) {
 	file.close();
 }
 
+// Windowed File Send
+//
+// Pipelined alternative to sendFile() for large files (e.g. data logs). The IDE
+// starts a windowed transfer with StartReadingWindowedMsg, which negotiates the
+// window size (in blocks) and block size. The board sends an entire window of
+// FileChunkMsg blocks without waiting, followed by a FileWindowCRCMsg covering
+// the window's bytes. The IDE verifies the CRC and replies with FileWindowAckMsg;
+// a non-zero bitmap in the ack requests selective retransmission of the flagged
+// blocks, an empty bitmap advances the window. Transfer state is kept here and
+// driven entirely by incoming acks, so no messages are processed re-entrantly.
+
+#define MAX_WINDOW_BLOCKS 32
+#define MAX_BLOCK_SIZE 960
+
+static File windowedFile;
+static int windowedID = 0;
+static int windowedBlockSize = MAX_BLOCK_SIZE;
+static int windowedWindowBlocks = 4;
+static int windowedOffset = 0; // file offset of the start of the current window
+static int windowedWindowBytes = 0; // byte count of the most recently sent window
+
+static void sendWindow(uint32 sendMap) {
+	// Send the blocks of the current window whose bits are set in sendMap
+	// (all blocks on first transmission, only the flagged ones on retransmit),
+	// followed by a CRC message covering the full window.
+	// FileWindowCRCMsg format: <transfer ID><window offset><byte count><CRC-32>
+
+	char buf[1024];
+	uint32 crc = ~0;
+	int windowBytes = 0;
+
+	windowedFile.seek(windowedOffset);
+	for (int i = 0; i < windowedWindowBlocks; i++) {
+		int byteCount = windowedFile.read((uint8_t *) &buf[8], windowedBlockSize);
+		if (byteCount <= 0) break;
+		crc = crc32Update(crc, (uint8 *) &buf[8], byteCount);
+		if (sendMap & (1 << i)) {
+			writeInt(windowedID, &buf[0]);
+			writeInt(windowedOffset + windowBytes, &buf[4]);
+			waitAndSendMessage(FileChunkMsg, 0, byteCount + 8, buf);
+		}
+		windowBytes += byteCount;
+	}
+	windowedWindowBytes = windowBytes;
+
+	writeInt(windowedID, &buf[0]);
+	writeInt(windowedOffset, &buf[4]);
+	writeInt(windowBytes, &buf[8]);
+	writeInt((int) ~crc, &buf[12]);
+	waitAndSendMessage(FileWindowCRCMsg, 0, 16, buf);
+
+	if (0 == windowBytes) { // empty window means end of file; transfer complete
+		windowedFile.close();
+		windowedID = 0;
+	}
+}
+
+static void startWindowedSend(int msgByteCount, char *msg) {
+	// format: <transfer ID (4 byte int)><window size in blocks><block size><file name>
+
+	char fileName[32];
+	if (msgByteCount <= 12) return;
+	if (windowedFile) windowedFile.close(); // abandon any transfer in progress
+
+	windowedID = readInt(&msg[0]);
+	windowedWindowBlocks = readInt(&msg[4]);
+	if (windowedWindowBlocks < 1) windowedWindowBlocks = 1;
+	if (windowedWindowBlocks > MAX_WINDOW_BLOCKS) windowedWindowBlocks = MAX_WINDOW_BLOCKS;
+	windowedBlockSize = readInt(&msg[8]);
+	if (windowedBlockSize < 32) windowedBlockSize = 32;
+	if (windowedBlockSize > MAX_BLOCK_SIZE) windowedBlockSize = MAX_BLOCK_SIZE;
+
+	int nameSize = msgByteCount - 12;
+	if (nameSize > 30) nameSize = 30;
+	strcpy(fileName, "/");
+	strncat(fileName, &msg[12], nameSize);
+
+	datalogFlush(); // make staged datalog records visible to transfers
+	windowedFile = myFS.open(fileName, "r");
+	if (!windowedFile) {
+		windowedID = 0;
+		return;
+	}
+	windowedOffset = 0;
+	sendWindow(0xFFFFFFFF); // send the first window
+}
+
+static void receiveWindowAck(int msgByteCount, char *msg) {
+	// format: <transfer ID (4 byte int)><window offset><resend bitmap>
+
+	if ((!windowedFile) || (msgByteCount < 12)) return;
+	int id = readInt(&msg[0]);
+	int offset = readInt(&msg[4]);
+	uint32 resendMap = (uint32) readInt(&msg[8]);
+	if ((id != windowedID) || (offset != windowedOffset)) return; // stale ack; ignore
+
+	if (resendMap) { // resend the flagged blocks of the current window
+		sendWindow(resendMap);
+	} else { // window verified; advance and send the next one
+		windowedOffset += windowedWindowBytes;
+		sendWindow(0xFFFFFFFF);
+	}
+}
+
 static void sendFileInfo(char *fileName, int fileSize, int entryIndex) {
 	//  Send file info message. Format: (entryIndex, file size in bytes, name)
 	char buf[1024];
@@ -173,7 +282,7 @@ static void sendFileList() {
 }
 
 void processFileMessage(int msgType, int dataSize, char *data) {
-	// Process a file message (msgType [200..205]).
+	// Process a file message (msgType [200..208]).
 
 	int id = 0;
 	char fileName[32]; // max of 30 characters after the leading "/"
@@ -210,6 +319,14 @@ void processFileMessage(int msgType, int dataSize, char *data) {
 		// format: <transfer ID (4 byte int)><byte offset (4 byte int)><data...>
 		receiveChunk(dataSize, data);
 		break;
+	case StartReadingWindowedMsg:
+		// format: <transfer ID (4 byte int)><window size in blocks><block size><file name>
+		startWindowedSend(dataSize, data);
+		break;
+	case FileWindowAckMsg:
+		// format: <transfer ID (4 byte int)><window offset><resend bitmap>
+		receiveWindowAck(dataSize, data);
+		break;
 	}
 }
 
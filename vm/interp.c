@@ -33,6 +33,11 @@ int taskCount = 0;
 
 OBJ vars[MAX_VARS];
 
+// Bits of global variables stored since the last scheduler cycle (var index mod 32).
+// Used to re-arm "when condition" hats that only read variables (see whenConditionVarMask).
+uint32 varDirtyMask = 0;
+uint32 varPushMask = 0;
+
 // Error Reporting
 
 // When a primitive encounters an error, it calls fail() with an error code.
@@ -53,13 +58,36 @@ static int printBufferByteCount = 0;
 
 int extraByteDelay = 1000; // default of 1000 usecs assumes serial throughput of ~1000 bytes/sec
 
+int intToStr(int n, char *s) {
+	// Write the decimal representation of n into s (which must have room for at
+	// least 12 bytes, the longest result plus terminator) and return its length.
+	// Replaces snprintf for number printing, which is strikingly slow in some
+	// embedded C libraries and shows up in 100 Hz data-logging loops.
+
+	char digits[12];
+	int i = 0;
+	uint32 magnitude = (n < 0) ? (0u - (uint32) n) : (uint32) n; // works for most negative int
+	do {
+		digits[i++] = '0' + (magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude);
+	char *dst = s;
+	if (n < 0) *dst++ = '-';
+	while (i > 0) *dst++ = digits[--i];
+	*dst = 0;
+	return dst - s;
+}
+
 static void printObj(OBJ obj) {
 	// Append a printed representation of the given object to printBuffer.
 
 	char *dst = &printBuffer[printBufferByteCount];
 	int n = PRINT_BUF_SIZE - printBufferByteCount;
 
-	if (isInt(obj)) snprintf(dst, n, "%d", obj2int(obj));
+	if (isInt(obj)) {
+		if (n >= 13) intToStr(obj2int(obj), dst); // common case; avoids snprintf
+		else snprintf(dst, n, "%d", obj2int(obj));
+	}
 	else if (obj == falseObj) snprintf(dst, n, "false");
 	else if (obj == trueObj) snprintf(dst, n, "true");
 	else if (objType(obj) == StringType) {
@@ -68,6 +96,8 @@ static void printObj(OBJ obj) {
 		snprintf(dst, n, "[%d item list]", obj2int(FIELD(obj, 0)));
 	} else if (objType(obj) == ByteArrayType) {
 		snprintf(dst, n, "(%d bytes)", BYTES(obj));
+	} else if (objType(obj) == DictionaryType) {
+		snprintf(dst, n, "[%d entry dictionary]", obj2int(FIELD(obj, 0)));
 	} else {
 		snprintf(dst, n, "(object type: %d)", objType(obj));
 	}
@@ -291,25 +321,426 @@ static int stringsEqual(OBJ obj1, OBJ obj2) {
 	return true;
 }
 
+// Superinstruction Fusion
+//
+// When a code chunk is stored, fuseChunkData() rewrites several common opcode sequences
+// into single "superinstructions", saving one or two dispatches per loop iteration in
+// the hottest bytecode patterns (counter updates and compare-and-branch tests).
+// Rewriting is done in place and never changes the size of the code, so jump offsets
+// and literal offsets remain valid. A sequence is fused only when no jump targets its
+// middle. Because the IDE compares chunk CRC's and can read chunks back, fused chunks
+// are restored to their original opcodes by unfusedChunkData() for those operations.
+
+// opcodes used by the fusion pass (see MicroBlocksCompiler.gp for the complete set)
+#define pushImmediate 2
+#define pushBigImmediate 3
+#define pushLiteral 4
+#define pushVar 5
+#define incrementVar 7
+#define jmp 16
+#define jmpTrue 17
+#define jmpFalse 18
+#define decrementAndJmp 19
+#define jmpOr 31
+#define jmpAnd 32
+#define lessThan 35
+#define lessOrEq 36
+#define greaterOrEq 39
+#define greaterThan 40
+#define add 42
+#define waitUntil 58
+#define equal 37
+#define notEqual 38
+#define subtract 43
+#define multiply 44
+#define bitAnd 50
+#define bitOr 51
+#define bitXor 52
+#define bitShiftLeft 54
+#define bitShiftRight 55
+#define noop 1
+#define pushLocal 12
+#define initLocals 28
+#define minimum 33
+#define maximum 34
+#define absoluteValue 47
+#define hexToInt 49
+#define isType 57
+
+// fused superinstructions (these use reserved opcodes; they never come from the IDE)
+#define pushVarAddImmediate 112 // pushVar + pushImmediate + add
+#define compareJmpFalse 113 // ordered comparison + jmpFalse/waitUntil
+#define incrementVarImmediate 114 // pushImmediate + incrementVar
+#define foldedBinaryOp 115 // constant-folded pushImmediate + pushImmediate + binary op
+#define foldedJmp 116 // constant-folded pushImmediate (boolean) + jmpTrue/jmpFalse
+
+#define MAX_FUSE_WORDS 256 // largest chunk is bounded by the receive buffer (~253 words)
+
+static uint32 fuseBuffer[MAX_FUSE_WORDS];
+static uint8 jumpTargets[MAX_FUSE_WORDS];
+
+static int foldBinaryOp(int cmd, int a, int b, OBJ *result) {
+	// If cmd is a binary opcode that can be constant-folded, compute it applied to
+	// integers a and b, store the result, and return true. The result mirrors the
+	// corresponding opcode handler exactly. Division and modulo are not folded so
+	// that their divide-by-zero errors are still reported at the original location.
+
+	switch (cmd) {
+	case add: *result = int2obj(a + b); return true;
+	case subtract: *result = int2obj(a - b); return true;
+	case multiply: *result = int2obj(a * b); return true;
+	case minimum: *result = int2obj((a < b) ? a : b); return true;
+	case maximum: *result = int2obj((a > b) ? a : b); return true;
+	case bitAnd: *result = int2obj(a & b); return true;
+	case bitOr: *result = int2obj(a | b); return true;
+	case bitXor: *result = int2obj(a ^ b); return true;
+	case bitShiftLeft: *result = int2obj(a << b); return true;
+	case bitShiftRight: *result = int2obj(a >> b); return true;
+	case lessThan: *result = (a < b) ? trueObj : falseObj; return true;
+	case lessOrEq: *result = (a <= b) ? trueObj : falseObj; return true;
+	case equal: *result = (a == b) ? trueObj : falseObj; return true;
+	case notEqual: *result = (a != b) ? trueObj : falseObj; return true;
+	case greaterOrEq: *result = (a >= b) ? trueObj : falseObj; return true;
+	case greaterThan: *result = (a > b) ? trueObj : falseObj; return true;
+	}
+	return false;
+}
+
+static inline int isOrderedComparison(int cmd) {
+	return (lessThan == cmd) || (lessOrEq == cmd) || (greaterOrEq == cmd) || (greaterThan == cmd);
+}
+
+static int scanChunkCode(uint32 *code, int wordCount) {
+	// Record all jump targets in jumpTargets[] and return the offset of the first
+	// inline literal, which marks the end of the instruction stream.
+
+	memset(jumpTargets, 0, sizeof(jumpTargets));
+	int literalStart = wordCount;
+	int i = 0;
+	while (i < literalStart) {
+		int op = code[i];
+		int cmd = CMD(op);
+		int arg = ARG(op);
+		if (pushBigImmediate == cmd) { i += 2; continue; } // skip the immediate value word
+		if (pushLiteral == cmd) {
+			if ((i + 1 + arg) < literalStart) literalStart = i + 1 + arg;
+		} else if ((jmp == cmd) || (jmpTrue == cmd) || (jmpFalse == cmd) ||
+				   (decrementAndJmp == cmd) || (jmpOr == cmd) || (jmpAnd == cmd) ||
+				   (waitUntil == cmd)) {
+			int target = i + 1 + arg;
+			if ((0 <= target) && (target < MAX_FUSE_WORDS)) jumpTargets[target] = true;
+		}
+		i++;
+	}
+	return literalStart;
+}
+
+static void fuseCodeWords(uint32 *code, int wordCount) {
+	// Rewrite fusable opcode sequences as superinstructions (in place).
+
+	int literalStart = scanChunkCode(code, wordCount);
+	int i = 0;
+	while (i < literalStart) {
+		int op = code[i];
+		int cmd = CMD(op);
+		if (pushBigImmediate == cmd) { i += 2; continue; }
+		int op2 = ((i + 1) < literalStart) ? (int) code[i + 1] : 0;
+		int op3 = ((i + 2) < literalStart) ? (int) code[i + 2] : 0;
+		OBJ foldResult;
+		if ((pushImmediate == cmd) && (ARG(op) & 1) && // both immediates are integers
+			(pushImmediate == CMD(op2)) && (ARG(op2) & 1) &&
+			(2 == ARG(op3)) && foldBinaryOp(CMD(op3), ARG(op) >> 1, ARG(op2) >> 1, &foldResult) &&
+			((i + 2) < literalStart) && !jumpTargets[i + 1] && !jumpTargets[i + 2]) {
+				code[i] = OP(foldedBinaryOp, ARG(op)); // arg preserves the original immediate
+				i += 3;
+				continue;
+		}
+		if ((pushImmediate == cmd) && ((0 == ARG(op)) || (4 == ARG(op))) && // boolean immediate
+			((jmpTrue == CMD(op2)) || (jmpFalse == CMD(op2))) &&
+			((i + 1) < literalStart) && !jumpTargets[i + 1]) {
+				code[i] = OP(foldedJmp, ARG(op)); // arg preserves the original immediate
+				i += 2;
+				continue;
+		}
+		if ((pushVar == cmd) &&
+			(pushImmediate == CMD(op2)) && (ARG(op2) & 1) && // immediate is an integer
+			(add == CMD(op3)) && (2 == ARG(op3)) &&
+			((i + 2) < literalStart) && !jumpTargets[i + 1] && !jumpTargets[i + 2]) {
+				code[i] = OP(pushVarAddImmediate, ARG(op));
+				i += 3;
+				continue;
+		}
+		if (isOrderedComparison(cmd) && (2 == ARG(op)) &&
+			((jmpFalse == CMD(op2)) || (waitUntil == CMD(op2))) &&
+			((i + 1) < literalStart) && !jumpTargets[i + 1]) {
+				code[i] = OP(compareJmpFalse, cmd); // arg is the original comparison opcode
+				i += 2;
+				continue;
+		}
+		if ((pushImmediate == cmd) && (ARG(op) & 1) && // immediate is an integer
+			(incrementVar == CMD(op2)) &&
+			((i + 1) < literalStart) && !jumpTargets[i + 1]) {
+				code[i] = OP(incrementVarImmediate, ARG(op)); // arg is the immediate value
+				i += 2;
+				continue;
+		}
+		i++;
+	}
+}
+
+void fuseChunkData(uint8 *data, int byteCount) {
+	// Fuse superinstructions in the given chunk code, which may not be word-aligned
+	// (it arrives in the middle of the serial receive buffer).
+
+	int wordCount = byteCount / 4;
+	if ((wordCount < 2) || (wordCount > MAX_FUSE_WORDS)) return;
+	memcpy(fuseBuffer, data, 4 * wordCount);
+	fuseCodeWords(fuseBuffer, wordCount);
+	memcpy(data, fuseBuffer, 4 * wordCount);
+}
+
+uint8 * unfusedChunkData(uint32 *code, int wordCount) {
+	// Return the given chunk code with any superinstructions restored to the original
+	// opcodes sent by the IDE (used when computing chunk CRC's and reading code back).
+	// The result is in a static buffer that is valid until the next call.
+
+	if (wordCount > MAX_FUSE_WORDS) return (uint8 *) code; // too large to have been fused
+	int literalStart = scanChunkCode(code, wordCount);
+	int i = 0;
+	while (i < wordCount) {
+		int op = code[i];
+		fuseBuffer[i] = op;
+		if (i >= literalStart) { i++; continue; } // literal data; copy verbatim
+		switch (CMD(op)) {
+		case pushBigImmediate:
+			if ((i + 1) < wordCount) fuseBuffer[i + 1] = code[i + 1];
+			i += 2;
+			continue;
+		case pushVarAddImmediate:
+			fuseBuffer[i] = OP(pushVar, ARG(op));
+			break;
+		case compareJmpFalse:
+			fuseBuffer[i] = OP(ARG(op), 2);
+			break;
+		case foldedBinaryOp:
+		case foldedJmp:
+			fuseBuffer[i] = OP(pushImmediate, ARG(op));
+			break;
+		case incrementVarImmediate:
+			fuseBuffer[i] = OP(pushImmediate, ARG(op));
+			break;
+		}
+		i++;
+	}
+	return (uint8 *) fuseBuffer;
+}
+
+// Variable Watch
+//
+// A "when <condition>" hat normally loops, re-evaluating its condition every
+// scheduler cycle. When the condition reads only global variables and constants,
+// the task can instead sleep until one of those variables is actually stored
+// (status waiting_varChange). The variable store opcodes set bits in varDirtyMask
+// and the scheduler re-arms any sleeping condition task whose watch mask overlaps
+// the dirty bits. Conditions that read anything else (pins, timers, random, etc.)
+// get a zero mask and are re-polled as before.
+
+uint32 whenConditionVarMask(OBJ code) {
+	// Analyze the condition test of a "when <condition>" hat chunk (the instructions
+	// from initLocals up to the waitUntil that loops back to re-test). Return a bitmask
+	// of the global variables it reads (bit = var index mod 32), or 0 if the condition
+	// reads anything that can change without a variable store.
+
+	uint32 mask = 0;
+	uint32 *instr = ((uint32 *) code) + PERSISTENT_HEADER_WORDS;
+	int wordCount = ((uint32 *) code)[1];
+	for (int i = 0; i < wordCount; i++) {
+		int op = instr[i];
+		int cmd = CMD(op);
+		int arg = ARG(op);
+		if ((waitUntil == cmd) && (arg < 0)) return mask; // end of the condition test
+		if (pushVar == cmd) { mask |= 1 << (arg & 31); continue; }
+		if (pushVarAddImmediate == cmd) { mask |= 1 << (arg & 31); i++; continue; }
+		if (pushBigImmediate == cmd) { i++; continue; }
+		if (compareJmpFalse == cmd) { // fused comparison; second word may be the final waitUntil
+			op = instr[i + 1];
+			if ((waitUntil == CMD(op)) && (ARG(op) < 0)) return mask;
+			return 0;
+		}
+		switch (cmd) {
+		case jmp: case jmpTrue: case jmpFalse: case jmpOr: case jmpAnd:
+			if (arg < 0) return 0; // backward jump; the condition contains a loop
+			break;
+		case noop: case pushImmediate: case pushLiteral: case pushLocal: case initLocals:
+		case foldedBinaryOp: case foldedJmp: // folded constants; the original pure words follow
+			break;
+		default:
+			if ((cmd >= minimum) && (cmd <= absoluteValue)) break; // comparison/arithmetic ops
+			if ((cmd >= hexToInt) && (cmd <= isType)) break; // pure ops (excludes random)
+			return 0; // reads changing state or an unrecognized opcode; keep polling
+		}
+	}
+	return 0; // no waitUntil found; not a condition hat pattern
+}
+
+// Task Stacks
+
+int growTaskStack(Task *task, int minWords) {
+	// Grow the given task's stack to hold at least minWords words, doubling its
+	// current size up to STACK_LIMIT. Return true on success, false if the stack
+	// cannot be grown (either STACK_LIMIT or available memory would be exceeded).
+
+	int newWords = task->stackWords ? (2 * task->stackWords) : INITIAL_STACK_WORDS;
+	while (newWords < minWords) newWords *= 2;
+	if (newWords > STACK_LIMIT) newWords = STACK_LIMIT;
+	if (newWords < minWords) return false; // minWords exceeds STACK_LIMIT
+	OBJ *newStack = realloc(task->stack, newWords * sizeof(OBJ));
+	if (!newStack) return false; // insufficient memory
+	task->stack = newStack;
+	task->stackWords = newWords;
+	return true;
+}
+
+void freeTaskStack(Task *task) {
+	// Free the given task's stack, if it has one.
+
+	if (task->stack) free(task->stack);
+	task->stack = NULL;
+	task->stackWords = 0;
+}
+
+// Profiler (optional)
+//
+// When compiled with -DUSE_PROFILER, the dispatch loop can accumulate per-opcode and
+// per-chunk cycle counts so we can measure where VM time actually goes on a board.
+// Profiling is started, stopped, and read out by the IDE via getProfileMsg; counter
+// data is returned in profileDataMsg messages (see profilerControl). Counts use the
+// DWT cycle counter on Cortex-M3/M4, the CPU cycle counter on ESP32, and fall back
+// to the microsecond clock on boards without a cycle counter (e.g. Cortex-M0).
+
+#ifdef USE_PROFILER
+
+#if defined(ARDUINO_ARCH_ESP32)
+	#include "esp32-hal.h"
+	static inline uint32 cycleCount() { return (uint32) ESP.getCycleCount(); }
+	static void cycleCountInit() { }
+#elif defined(NRF52) || defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_SAM_DUE)
+	// Cortex-M3/M4 DWT cycle counter (not present on Cortex-M0 boards such as the NRF51)
+	#define DEMCR (*((volatile uint32 *) 0xE000EDFC))
+	#define DWT_CTRL (*((volatile uint32 *) 0xE0001000))
+	#define DWT_CYCCNT (*((volatile uint32 *) 0xE0001004))
+	static inline uint32 cycleCount() { return DWT_CYCCNT; }
+	static void cycleCountInit() { DEMCR |= (1 << 24); DWT_CTRL |= 1; } // enable the counter
+#else
+	static inline uint32 cycleCount() { return microsecs(); } // no cycle counter; use usecs
+	static void cycleCountInit() { }
+#endif
+
+static int profilerOn = false;
+static uint8 profLastOp; // opcode the elapsed cycles are charged to at the next dispatch
+static uint32 profLastTime;
+static uint32 profOpCycles[128];
+static uint32 profOpCounts[128];
+static uint32 profChunkCycles[MAX_CHUNKS];
+
+static void profilerClear() {
+	memset(profOpCycles, 0, sizeof(profOpCycles));
+	memset(profOpCounts, 0, sizeof(profOpCounts));
+	memset(profChunkCycles, 0, sizeof(profChunkCycles));
+}
+
+static void sendProfileData() {
+	// Send the profile counters to the IDE as two profileDataMsg messages. The first
+	// (id 0) holds 9-byte per-opcode records: <opcode byte><count><cycles>; the second
+	// (id 1) holds 5-byte per-chunk records: <chunk index byte><cycles>. Counts and
+	// cycles are unsigned 32-bit integers, little endian; zero entries are omitted.
+
+	static uint8 data[960];
+	int byteCount = 0;
+	for (int i = 0; i < 128; i++) {
+		if (!profOpCounts[i]) continue;
+		if (byteCount > ((int) sizeof(data) - 9)) break;
+		data[byteCount++] = i;
+		for (int b = 0; b < 4; b++) data[byteCount++] = (profOpCounts[i] >> (8 * b)) & 0xFF;
+		for (int b = 0; b < 4; b++) data[byteCount++] = (profOpCycles[i] >> (8 * b)) & 0xFF;
+	}
+	waitAndSendMessage(profileDataMsg, 0, byteCount, (char *) data);
+	byteCount = 0;
+	for (int i = 0; i < MAX_CHUNKS; i++) {
+		if (!profChunkCycles[i]) continue;
+		if (byteCount > ((int) sizeof(data) - 5)) break;
+		data[byteCount++] = i;
+		for (int b = 0; b < 4; b++) data[byteCount++] = (profChunkCycles[i] >> (8 * b)) & 0xFF;
+	}
+	waitAndSendMessage(profileDataMsg, 1, byteCount, (char *) data);
+}
+
+void profilerControl(int id) {
+	// Handle a getProfileMsg from the IDE: 1 starts profiling (clearing the counters),
+	// 2 stops it, and 0 sends the counters to the IDE and clears them.
+
+	if (1 == id) {
+		profilerClear();
+		cycleCountInit();
+		profLastOp = 0;
+		profLastTime = cycleCount();
+		profilerOn = true;
+	} else if (2 == id) {
+		profilerOn = false;
+	} else {
+		sendProfileData();
+		profilerClear();
+	}
+}
+
+#endif // USE_PROFILER
+
 // Interpreter
 
 // Macros to pop arguments for commands and reporters (pops args, leaves result on stack)
 #define POP_ARGS_COMMAND() { sp -= arg; }
 #define POP_ARGS_REPORTER() { sp -= arg - 1; }
 
-// Macro to check for stack overflow
+// Macro to check for stack overflow; grows the stack on demand.
+// Note: Growing may move the stack, so sp and fp are saved and restored.
 #define STACK_CHECK(n) { \
-	if (((sp + (n)) - task->stack) > STACK_LIMIT) { \
-		errorCode = stackOverflow; \
-		goto error; \
+	if (((sp + (n)) - task->stack) > task->stackWords) { \
+		task->sp = sp - task->stack; \
+		task->fp = fp - task->stack; \
+		if (!growTaskStack(task, task->sp + (n))) { \
+			errorCode = stackOverflow; \
+			goto error; \
+		} \
+		sp = task->stack + task->sp; \
+		fp = task->stack + task->fp; \
 	} \
 }
 
 // Macros to support function calls
 #define IN_CALL() (fp > task->stack)
 
+static void wakeQueueInsert(Task *task); // forward reference (see "Wake Queue" below)
+
+// When profiling, each dispatch charges the cycles since the previous dispatch to the
+// opcode just executed (and to the current chunk), then counts the opcode about to run.
+#ifdef USE_PROFILER
+	#define PROFILE_OP() { \
+		if (profilerOn) { \
+			uint32 now = cycleCount(); \
+			profOpCycles[profLastOp] += now - profLastTime; \
+			profChunkCycles[task->currentChunkIndex] += now - profLastTime; \
+			profLastTime = now; \
+			profLastOp = CMD(*ip); \
+			profOpCounts[profLastOp]++; \
+		} \
+	}
+#else
+	#define PROFILE_OP()
+#endif
+
 // Macro to inline dispatch in the end of each opcode (avoiding a jump back to the top)
 #define DISPATCH() { \
+	PROFILE_OP() \
 	if (errorCode) goto error; \
 	op = *ip++; \
 	arg = ARG(op); \
@@ -439,11 +870,11 @@ static void runTask(Task *task) {
 		&&drawShape_op,
 		&&shapeForLetter_op,
 		&&neoPixelSetPin_op,
-		&&RESERVED_op,
-		&&RESERVED_op,
-		&&RESERVED_op,
-		&&RESERVED_op,
-		&&RESERVED_op,
+		&&pushVarAddImmediate_op,
+		&&compareJmpFalse_op,
+		&&incrementVarImmediate_op,
+		&&foldedBinaryOp_op,
+		&&foldedJmp_op,
 		&&RESERVED_op,
 		&&RESERVED_op,
 		&&RESERVED_op,
@@ -457,11 +888,25 @@ static void runTask(Task *task) {
 		&&callReporterPrimitive_op,
 	};
 
+	// Allocate the task's stack the first time the task runs
+	if (!task->stack && !growTaskStack(task, INITIAL_STACK_WORDS)) {
+		sendTaskError(task->taskChunkIndex, insufficientMemoryError, 0);
+		task->status = unusedTask;
+		return;
+	}
+
 	// Restore task state
 	ip = task->code + task->ip;
 	sp = task->stack + task->sp;
 	fp = task->stack + task->fp;
 
+	#ifdef USE_PROFILER
+		if (profilerOn) { // don't charge time spent outside the interpreter to an opcode
+			profLastTime = cycleCount();
+			profLastOp = CMD(*ip);
+		}
+	#endif
+
 	DISPATCH();
 
 	error:
@@ -476,6 +921,8 @@ static void runTask(Task *task) {
 		task->ip = ip - task->code;
 		task->sp = sp - task->stack;
 		task->fp = fp - task->stack;
+		if (waiting_micros == task->status) wakeQueueInsert(task);
+		if (unusedTask == task->status) freeTaskStack(task); // task finished; reclaim its stack
 		return;
 	RESERVED_op:
 	halt_op:
@@ -502,9 +949,11 @@ static void runTask(Task *task) {
 		DISPATCH();
 	storeVar_op:
 		vars[arg] = *--sp;
+		varDirtyMask |= 1 << (arg & 31);
 		DISPATCH();
 	incrementVar_op:
 		vars[arg] = int2obj(evalInt(vars[arg]) + evalInt(*--sp));
+		varDirtyMask |= 1 << (arg & 31);
 		DISPATCH();
 	pushArgCount_op:
 		STACK_CHECK(1);
@@ -566,7 +1015,15 @@ static void runTask(Task *task) {
 	jmpFalse_op:
 		if (trueObj != (*--sp)) ip += arg; // treat any value but true as false
 #if USE_TASKS
-		if ((arg < 0) && (trueObj != *sp)) goto suspend;
+		if ((arg < 0) && (trueObj != *sp)) {
+			if ((waitUntil == CMD(op)) && task->varWatchMask &&
+				((ip - task->code) == (PERSISTENT_HEADER_WORDS + 1))) {
+					// condition hat re-testing a variables-only condition:
+					// sleep until one of the watched variables is stored
+					task->status = waiting_varChange;
+			}
+			goto suspend;
+		}
 #endif
 		DISPATCH();
 	 decrementAndJmp_op:
@@ -935,6 +1392,12 @@ static void runTask(Task *task) {
 				case ByteArrayType:
 					*(sp - arg) = strcmp(type, "byte array") == 0 ? trueObj : falseObj;
 					break;
+				case Int16ArrayType:
+					*(sp - arg) = strcmp(type, "int16 array") == 0 ? trueObj : falseObj;
+					break;
+				case DictionaryType:
+					*(sp - arg) = strcmp(type, "dictionary") == 0 ? trueObj : falseObj;
+					break;
 			}
 		}
 		POP_ARGS_REPORTER();
@@ -1111,6 +1574,72 @@ static void runTask(Task *task) {
 		POP_ARGS_COMMAND();
 		DISPATCH();
 
+	// superinstructions (see "Superinstruction Fusion" above):
+	pushVarAddImmediate_op:
+		// fused pushVar + pushImmediate + add; arg is the variable index, the next
+		// word is the original pushImmediate (an integer), followed by the add
+		STACK_CHECK(1);
+		tmp = ARG(*ip);
+		ip += 2; // skip the pushImmediate and add instructions
+		*sp++ = int2obj(evalInt(vars[arg]) + (tmp >> 1));
+		DISPATCH();
+	compareJmpFalse_op:
+		// fused ordered comparison + jmpFalse; arg is the original comparison opcode
+		// and the next word is the original jmpFalse (or waitUntil) instruction
+		tmpObj = *(sp - 2);
+		if (isInt(tmpObj) && isInt(*(sp - 1))) { // special case for integers:
+			tmp = obj2int(tmpObj) - obj2int(*(sp - 1));
+			tmpObj = (((lessThan == arg) && (tmp < 0)) ||
+					  ((lessOrEq == arg) && (tmp <= 0)) ||
+					  ((greaterOrEq == arg) && (tmp >= 0)) ||
+					  ((greaterThan == arg) && (tmp > 0))) ? trueObj : falseObj;
+		} else {
+			tmp = (lessThan == arg) ? -2 : ((lessOrEq == arg) ? -1 : ((greaterOrEq == arg) ? 1 : 2));
+			tmpObj = primCompare(tmp, tmpObj, *(sp - 1));
+		}
+		sp -= 2;
+		op = *ip++; // the original jmpFalse instruction
+		arg = ARG(op);
+		if (trueObj != tmpObj) ip += arg; // treat any value but true as false
+#if USE_TASKS
+		if ((arg < 0) && (trueObj != tmpObj)) {
+			if ((waitUntil == CMD(op)) && task->varWatchMask &&
+				((ip - task->code) == (PERSISTENT_HEADER_WORDS + 1))) {
+					task->status = waiting_varChange; // see jmpFalse_op
+			}
+			goto suspend;
+		}
+#endif
+		DISPATCH();
+	incrementVarImmediate_op:
+		// fused pushImmediate + incrementVar; arg is the immediate (an integer) and
+		// the next word is the original incrementVar instruction
+		tmp = ARG(*ip++); // variable index from the original incrementVar
+		vars[tmp] = int2obj(evalInt(vars[tmp]) + (arg >> 1));
+		varDirtyMask |= 1 << (tmp & 31);
+		DISPATCH();
+	foldedBinaryOp_op:
+		// constant-folded pushImmediate + pushImmediate + binary op; arg is the first
+		// immediate and the next two words are the original second immediate and op
+		STACK_CHECK(1);
+		tmp = ARG(*ip); // second immediate (a tagged integer)
+		foldBinaryOp(CMD(ip[1]), arg >> 1, tmp >> 1, &tmpObj);
+		ip += 2; // skip the second pushImmediate and the op
+		*sp++ = tmpObj;
+		DISPATCH();
+	foldedJmp_op:
+		// constant-folded boolean pushImmediate + jmpTrue/jmpFalse; arg is the original
+		// immediate (the boolean) and the next word is the original jump instruction
+		op = *ip++;
+		tmp = ((jmpTrue == CMD(op)) == (4 == arg)); // true if the jump is always taken
+		if (tmp) {
+			ip += ARG(op);
+#if USE_TASKS
+			if (ARG(op) < 0) goto suspend;
+#endif
+		}
+		DISPATCH();
+
 	// named primitives:
 	callCommandPrimitive_op:
 		task->sp = sp - task->stack; // record the stack pointer in case primitive does a GC
@@ -1124,6 +1653,73 @@ static void runTask(Task *task) {
 		DISPATCH();
 }
 
+// Wake Queue
+//
+// Tasks waiting on the microsecond clock are kept in a small queue sorted by wake time
+// (soonest last), so the scheduler examines only the head of the queue each cycle
+// instead of checking the wakeTime of every waiting task. Entries are task indices.
+// An entry whose task is no longer waiting (e.g. its chunk was stopped or reloaded)
+// is simply discarded when it reaches the head of the queue. Wake times are compared
+// with wrap-around (signed difference) arithmetic, so ordering is correct as long as
+// pending wake times span less than half the 32-bit microsecond clock (~35 minutes);
+// tasks spaced further apart than that may wake late, but never get lost.
+
+static uint8 wakeQueue[MAX_TASKS]; // task indices, sorted by wake time, soonest last
+static int wakeQueueCount = 0;
+
+void wakeQueueClear() { wakeQueueCount = 0; }
+
+static void wakeQueueInsert(Task *task) {
+	// Add the given waiting task to the wake queue, keeping the queue sorted.
+
+	int taskIndex = task - tasks;
+	int i, j;
+	for (i = 0; i < wakeQueueCount; i++) { // remove any old entry for this task
+		if (taskIndex == wakeQueue[i]) {
+			for (j = i; j < (wakeQueueCount - 1); j++) wakeQueue[j] = wakeQueue[j + 1];
+			wakeQueueCount--;
+			break;
+		}
+	}
+	i = wakeQueueCount;
+	while ((i > 0) &&
+		   ((int) (tasks[wakeQueue[i - 1]].wakeTime - task->wakeTime) < 0)) {
+		wakeQueue[i] = wakeQueue[i - 1]; // shift entries that wake sooner toward the end
+		i--;
+	}
+	wakeQueue[i] = taskIndex;
+	wakeQueueCount++;
+}
+
+static void wakeReadyTasks() {
+	// Set the status of all waiting tasks whose wake time has arrived to running,
+	// and re-arm any condition hat whose watched variables have changed.
+
+	if (varDirtyMask) {
+		for (int t = 0; t < taskCount; t++) {
+			Task *task = &tasks[t];
+			if ((waiting_varChange == task->status) && (task->varWatchMask & varDirtyMask)) {
+				task->status = running;
+			}
+		}
+		varPushMask |= varDirtyMask; // accumulate changes for variable subscriptions
+		varDirtyMask = 0;
+	}
+
+	uint32 usecs = 0; // compute the time only if it is needed
+	while (wakeQueueCount > 0) {
+		Task *task = &tasks[wakeQueue[wakeQueueCount - 1]];
+		if (waiting_micros != task->status) { // stale entry; discard it
+			wakeQueueCount--;
+			continue;
+		}
+		if (!usecs) usecs = microsecs(); // get usecs
+		if ((usecs - task->wakeTime) >= RECENT) break; // head of queue not due yet
+		task->status = running;
+		wakeQueueCount--;
+	}
+}
+
 // Task Scheduler
 
 #if defined(ESP8266) || defined(ARDUINO_ARCH_ESP32) || \
@@ -1147,27 +1743,45 @@ void vmLoop() {
 			#endif
 			checkButtons();
 			processMessage();
-			count = 25; // must be under 30 when building on mbed to avoid serial errors
+			pushSubscribedVars(); // push values of subscribed variables that have changed
+			telemetryService(); // flush buffered telemetry frames
+			mqttService(); // MQTT keepalive, reconnection, and inbound messages
+			netService(); // drain socket readiness events (Linux/Pi)
+			gcIncrementalStep(); // do a bounded amount of GC work when memory is low
+			persistCompactionStep(); // do a bounded amount of code store compaction work
+			// process background tasks again sooner when messages are queued up
+			// (e.g. during a bulk code download); interval must be under 30 when
+			// building on mbed to avoid serial errors
+			count = hasMessageBacklog() ? 1 : 25;
 		}
-		uint32 usecs = 0; // compute times only the first time they are needed
+		wakeReadyTasks();
+		int ranTask = false;
 		for (int t = 0; t < taskCount; t++) {
 			currentTaskIndex++;
 			if (currentTaskIndex >= taskCount) currentTaskIndex = 0;
 			Task *task = &tasks[currentTaskIndex];
-			if (unusedTask == task->status) {
-				continue;
-			} else if (running == task->status) {
-				runTask(task);
-				break;
-			} else if (waiting_micros == task->status) {
-				if (!usecs) usecs = microsecs(); // get usecs
-				if ((usecs - task->wakeTime) < RECENT) task->status = running;
-			}
 			if (running == task->status) {
 				runTask(task);
+				ranTask = true;
 				break;
 			}
 		}
+		if (!ranTask && !hasMessageBacklog()) {
+			// No task is runnable: sleep instead of spinning. Sleep until the
+			// soonest queued wake time, capped at 2 msecs so button checks and
+			// incoming messages stay responsive, then run the background
+			// services promptly after waking.
+			int sleepUsecs = 2000;
+			if (wakeQueueCount > 0) {
+				int untilWake =
+					((int) (tasks[wakeQueue[wakeQueueCount - 1]].wakeTime - microsecs())) - 50;
+				if (untilWake < sleepUsecs) sleepUsecs = untilWake;
+			}
+			if (sleepUsecs > 100) {
+				idleSleep(sleepUsecs);
+				count = 0;
+			}
+		}
 	}
 }
 
@@ -1185,6 +1799,15 @@ void runTasksUntilDone() {
 		}
 		hasActiveTasks = false;
 		uint32 usecs = 0; // compute times only the first time they are needed
+		if (varDirtyMask) { // re-arm condition hats whose watched variables have changed
+			for (int t = 0; t < taskCount; t++) {
+				if ((waiting_varChange == tasks[t].status) && (tasks[t].varWatchMask & varDirtyMask)) {
+					tasks[t].status = running;
+				}
+			}
+			varPushMask |= varDirtyMask;
+			varDirtyMask = 0;
+		}
 		for (int t = 0; t < taskCount; t++) {
 			Task *task = &tasks[t];
 			if (running == task->status) {
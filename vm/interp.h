@@ -21,6 +21,8 @@ extern "C" {
 
 #define MAX_VARS 100
 extern OBJ vars[MAX_VARS];
+extern uint32 varDirtyMask; // bits of recently stored vars (var index mod 32)
+extern uint32 varPushMask; // like varDirtyMask, but consumed by variable subscriptions
 
 // Code Chunks
 
@@ -54,6 +56,8 @@ typedef enum {
 typedef struct {
 	OBJ code;
 	uint8 chunkType;
+	uint8 crcValid; // true if crc holds the CRC-32 of the chunk's (unfused) code
+	uint32 crc;
 } CodeChunkRecord;
 
 #define MAX_CHUNKS 255
@@ -66,35 +70,48 @@ extern CodeChunkRecord chunks[MAX_CHUNKS];
 // inside a call to user-defined function. It also holds the task status, processor
 // state (instruction pointer (ip), stack pointer (sp), and frame pointer (fp)),
 // and the wakeTime (used when a task is waiting on the microsecond clock).
-// In the current design, Tasks have a fixed-size stack built in. In the future,
-// this will become a reference to a growable stack object in memory.
+// Each Task has a growable stack that is allocated lazily the first time the task
+// runs, doubled on demand up to STACK_LIMIT words, and freed when the task finishes,
+// so unused task entries cost no stack memory. Stacks are not allocated in the
+// object store because primitives hold raw pointers into them while the garbage
+// collector may move objects; only the interpreter's stack check ever moves a stack.
 //
 // "When <condition>" hats have their condition test compiled into them. They
 // loop back and suspend themselves when the condition is false. When the condition
-// becomes true, execution proceeds to the blocks under the hat.
+// becomes true, execution proceeds to the blocks under the hat. If the condition
+// reads only global variables, the task sleeps (status waiting_varChange) until
+// one of those variables is stored rather than re-polling every scheduler cycle;
+// varWatchMask records which variables to watch (see whenConditionVarMask).
 
 typedef enum {
 	unusedTask = 0, // task entry is available
 	waiting_micros = 1, // waiting for microseconds to reach wakeTime
 	running = 2,
+	waiting_varChange = 3, // waiting for a watched global variable to change
 } MicroBlocksTaskStatus_t;
 
-#ifdef GNUBLOCKS
-	#define STACK_LIMIT 10000 // Task size is 6 + STACK_LIMIT words
+#if defined(NRF51)
+	#define STACK_LIMIT 64 // maximum stack size, in words
+#elif defined(GNUBLOCKS)
+	#define STACK_LIMIT 10000 // maximum stack size, in words
 #else
-	#define STACK_LIMIT 54 // Task size is 6 + STACK_LIMIT words
+	#define STACK_LIMIT 512 // maximum stack size, in words
 #endif
 
+#define INITIAL_STACK_WORDS 16 // initial stack size; enough for most scripts
+
 typedef struct {
 	uint8 status; // MicroBlocksTaskStatus_t, stored as a byte
 	uint8 taskChunkIndex; // chunk index of the top-level stack for this task
 	uint8 currentChunkIndex; // chunk index when inside a function
 	uint32 wakeTime;
+	uint32 varWatchMask; // watched global vars for a "when condition" hat (0 = poll)
 	OBJ code;
 	int ip;
 	int sp;
 	int fp;
-	OBJ stack[STACK_LIMIT];
+	int stackWords; // currently allocated stack size, in words
+	OBJ *stack; // growable stack, allocated when the task first runs
 } Task;
 
 // Task list shared by interp.c and runtime.c
@@ -136,6 +153,16 @@ extern int extraByteDelay;
 #define versionMsg				22
 #define chunkCRCMsg				23
 
+// Serial Protocol Messages: Profiler (optional; compile with -DUSE_PROFILER)
+
+#define getProfileMsg			24	// id 1: start profiling; 2: stop; 0: fetch & clear counters
+#define profileDataMsg			25	// id 0: per-opcode records; 1: per-chunk records
+
+// Serial Protocol Messages: Variable Subscriptions
+
+#define varSubscribeMsg			31	// body: variable indices to watch; empty body unsubscribes all
+#define telemetryMsg			32	// board -> IDE: batched binary telemetry frames
+
 // Serial Protocol Messages: Bidirectional
 
 #define pingMsg					26
@@ -176,18 +203,30 @@ extern int extraByteDelay;
 #define needsIndexable			33	// Needs an indexable type such as a string or list
 #define joinArgsNotSameType		34	// All arguments to join must be the same type (e.g. lists)
 #define i2cTransferFailed		35	// I2C transfer failed
+#define int16ArrayStoreError	36	// An Int16Array can only store integer values between -32768 and 32767
+#define dictionaryKeyError		37	// Dictionary keys must be integers or strings
 
 // Runtime Operations
 
 OBJ fail(uint8 errCode);
 void initTasks(void);
+void wakeQueueClear(void);
+int growTaskStack(Task *task, int minWords);
+void freeTaskStack(Task *task);
 void startAll();
 void stopAllTasksButThis(Task *task);
 void startReceiversOfBroadcast(char *msg, int byteCount);
 void processMessage(void);
+int hasMessageBacklog(void);
+void pushSubscribedVars(void);
 int hasOutputSpace(int byteCount);
 void logData(char *s);
+void logTelemetry(int channelCount, OBJ *channels);
+void telemetryService(void);
+void mqttService(void);
+void netService(void);
 void outputString(const char *s);
+int intToStr(int n, char *s);
 void sendTaskDone(uint8 chunkIndex);
 void sendTaskError(uint8 chunkIndex, uint8 errorCode, int where);
 void sendTaskReturnValue(uint8 chunkIndex, OBJ returnValue);
@@ -224,9 +263,29 @@ void runTasksUntilDone(void);
 void interpTests1(void);
 void taskTest(void);
 
+void runBenchmarks(void); // benchmark suite; compiled in when built with -DVM_BENCHMARK
+
 void compactCodeStore();
 void outputRecordHeaders();
 
+uint32 crc32(uint8 *buf, int byteCount);
+uint32 crc32Update(uint32 crc, uint8 *buf, int byteCount);
+
+// Superinstruction Fusion
+
+void fuseChunkData(uint8 *data, int byteCount);
+uint8 * unfusedChunkData(uint32 *code, int wordCount);
+
+// Variable Watch
+
+uint32 whenConditionVarMask(OBJ code);
+
+// Profiler (optional; compile with -DUSE_PROFILER)
+
+#ifdef USE_PROFILER
+void profilerControl(int id);
+#endif
+
 // Platform Specific Operations
 
 uint32 microsecs(void);
@@ -235,6 +294,7 @@ uint32 millisecs(void);
 int serialConnected();
 int recvBytes(uint8 *buf, int count);
 int sendByte(char aByte);
+int sendBytes(uint8 *buf, int count);
 void restartSerial();
 
 const char *boardType();
@@ -248,6 +308,7 @@ void setPinMode(int pin, int newMode);
 void turnOffPins();
 void updateMicrobitDisplay();
 void checkButtons();
+void idleSleep(int microsecsToSleep);
 void stopPWM();
 void stopServos();
 void stopTone();
@@ -310,6 +371,7 @@ void tftSetHugePixelBits(int bits);
 void addDataPrims();
 void addDisplayPrims();
 void addFilePrims();
+void datalogFlush();
 void addIOPrims();
 void addMiscPrims();
 void addNetPrims();
@@ -329,6 +391,7 @@ typedef const struct {
 
 void addPrimitiveSet(const char *setName, int entryCount, PrimEntry *entries);
 OBJ callPrimitive(int argCount, OBJ *args);
+void clearPrimCache();
 void primsInit();
 
 #ifdef __cplusplus
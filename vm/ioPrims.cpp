@@ -60,6 +60,26 @@ uint32 millisecs() { return (uint32) millis(); }
 
 #endif
 
+void idleSleep(int microsecsToSleep) {
+	// Called by the scheduler when no task is runnable. Pause the CPU for up to the
+	// given number of microseconds to save power; waking early is always safe.
+
+	#if defined(ARDUINO_ARCH_ESP32) || defined(ESP8266)
+		// delay() yields to the system so WiFi/RTOS housekeeping can run and,
+		// when configured, automatic modem/light sleep can engage
+		if (microsecsToSleep >= 1000) {
+			delay(microsecsToSleep / 1000);
+		} else {
+			yield();
+		}
+	#elif defined(NRF51) || defined(NRF52) || defined(ARDUINO_ARCH_SAMD)
+		(void) microsecsToSleep;
+		__WFE(); // sleep until the next interrupt or event (at most one msec tick)
+	#else
+		(void) microsecsToSleep; // busy-wait on boards without a known sleep mechanism
+	#endif
+}
+
 // Hardware Initialization
 
 	#if (defined(ARDUINO_SAMD_ZERO) || defined(ARDUINO_SAM_ZERO)) && defined(SERIAL_PORT_USBVIRTUAL)
@@ -106,6 +126,17 @@ int recvBytes(uint8 *buf, int count) {
 
 int sendByte(char aByte) { return Serial.write(aByte); }
 
+int sendBytes(uint8 *buf, int count) {
+	// Send up to count bytes without blocking and return the number queued. Handing a
+	// whole span to the serial driver lets it transmit asynchronously (via interrupts
+	// or DMA, depending on the board's core) instead of one byte per call.
+
+	int n = Serial.availableForWrite();
+	if (n <= 0) return sendByte(buf[0]); // core does not report TX space; byte at a time
+	if (count > n) count = n;
+	return Serial.write(buf, count);
+}
+
 void restartSerial() {
 	Serial.end();
 	Serial.begin(115200);
@@ -664,6 +695,163 @@ OBJ primAnalogRead(int argCount, OBJ *args) {
 	return int2obj(analogRead(pin));
 }
 
+// Analog Capture
+// primAnalogRead does one blocking conversion per call, so waveform capture is
+// limited by interpreter speed to a few kHz with heavy jitter. analogCaptureStart
+// lets the ADC run on its own: on micro:bit v2 the SAADC samples at a fixed rate
+// under its internal timer and streams results into a static buffer via EasyDMA
+// while the VM keeps running; the waiting task polls analogCaptureDone and picks
+// up the samples with analogCaptureResult. The DMA target is static because the
+// garbage collector can move heap objects; the samples (10-bit, like analogRead)
+// are copied into an int16 array when collected.
+
+#if defined(ARDUINO_BBC_MICROBIT_V2)
+
+#define CAPTURE_MAX_SAMPLES 512
+
+static volatile int16_t captureBuf[CAPTURE_MAX_SAMPLES];
+static int captureCount = 0;
+static int captureInProgress = false;
+
+static int ainForPin(int pinNum) {
+	// Map a user pin number to an SAADC analog input. Edge connector pins 0-2
+	// are AIN0-AIN2; pin 6 is the microphone (AIN3), as in primAnalogRead.
+
+	if ((0 <= pinNum) && (pinNum <= 2)) return pinNum + 1; // AnalogInput0 is PSELP value 1
+	if (6 == pinNum) return 4; // microphone, AnalogInput3
+	return -1;
+}
+
+static int analogCaptureStart(int pinNum, int sampleRate, int count) {
+	int ain = ainForPin(pinNum);
+	if (ain < 0) return false;
+
+	// The SAADC internal sample timer divides 16 MHz by 80-2047, so rates
+	// outside roughly 8-200 kHz are clamped.
+	if (sampleRate < 7813) sampleRate = 7813;
+	if (sampleRate > 200000) sampleRate = 200000;
+
+	NRF_SAADC->RESOLUTION = SAADC_RESOLUTION_VAL_10bit;
+	NRF_SAADC->ENABLE = 1;
+
+	for (int i = 0; i < 8; i++) {
+		NRF_SAADC->CH[i].PSELN = SAADC_CH_PSELP_PSELP_NC;
+		NRF_SAADC->CH[i].PSELP = SAADC_CH_PSELP_PSELP_NC;
+	}
+	NRF_SAADC->CH[0].CONFIG = ((SAADC_CH_CONFIG_RESP_Bypass    << SAADC_CH_CONFIG_RESP_Pos)   & SAADC_CH_CONFIG_RESP_Msk)
+							| ((SAADC_CH_CONFIG_RESP_Bypass    << SAADC_CH_CONFIG_RESN_Pos)   & SAADC_CH_CONFIG_RESN_Msk)
+							| ((SAADC_CH_CONFIG_GAIN_Gain1_4   << SAADC_CH_CONFIG_GAIN_Pos)   & SAADC_CH_CONFIG_GAIN_Msk)
+							| ((SAADC_CH_CONFIG_REFSEL_VDD1_4  << SAADC_CH_CONFIG_REFSEL_Pos) & SAADC_CH_CONFIG_REFSEL_Msk)
+							| ((SAADC_CH_CONFIG_TACQ_3us       << SAADC_CH_CONFIG_TACQ_Pos)   & SAADC_CH_CONFIG_TACQ_Msk)
+							| ((SAADC_CH_CONFIG_MODE_SE        << SAADC_CH_CONFIG_MODE_Pos)   & SAADC_CH_CONFIG_MODE_Msk);
+	NRF_SAADC->CH[0].PSELN = ain;
+	NRF_SAADC->CH[0].PSELP = ain;
+
+	// run the sample timer inside the SAADC; one SAMPLE task starts free-running capture
+	NRF_SAADC->SAMPLERATE = (16000000 / sampleRate) |
+		(SAADC_SAMPLERATE_MODE_Timers << SAADC_SAMPLERATE_MODE_Pos);
+
+	NRF_SAADC->RESULT.PTR = (uint32_t) captureBuf;
+	NRF_SAADC->RESULT.MAXCNT = count;
+	NRF_SAADC->EVENTS_END = 0;
+
+	NRF_SAADC->TASKS_START = 1;
+	while (!NRF_SAADC->EVENTS_STARTED);
+	NRF_SAADC->EVENTS_STARTED = 0;
+
+	NRF_SAADC->TASKS_SAMPLE = 1; // capture now runs via DMA; no further CPU involvement
+
+	captureCount = count;
+	captureInProgress = true;
+	return true;
+}
+
+static int analogCaptureDone() {
+	if (!captureInProgress) return true;
+	return NRF_SAADC->EVENTS_END != 0;
+}
+
+static void analogCaptureStop() {
+	NRF_SAADC->EVENTS_END = 0;
+	NRF_SAADC->TASKS_STOP = 1;
+	while (!NRF_SAADC->EVENTS_STOPPED);
+	NRF_SAADC->EVENTS_STOPPED = 0;
+	NRF_SAADC->ENABLE = 0;
+	NRF_SAADC->SAMPLERATE = 0; // back to task-triggered sampling (see readAnalogMicrophone)
+}
+
+#else // no free-running ADC support on this board
+
+#define CAPTURE_MAX_SAMPLES 64
+
+static volatile int16_t captureBuf[CAPTURE_MAX_SAMPLES];
+static int captureCount = 0;
+static int captureInProgress = false;
+
+static int analogCaptureStart(int pinNum, int sampleRate, int count) {
+	// Fallback: a paced, synchronous capture. Blocks for (count / sampleRate)
+	// seconds, so the buffer is kept small on boards without DMA capture.
+
+	if (sampleRate < 1000) sampleRate = 1000;
+	uint32 interval = 1000000 / sampleRate; // usecs between samples
+	uint32 nextSample = microsecs();
+	OBJ pinArg = int2obj(pinNum);
+	for (int i = 0; i < count; i++) {
+		while (((int) (microsecs() - nextSample)) < 0) {} // wait for sample time
+		captureBuf[i] = obj2int(primAnalogRead(1, &pinArg));
+		nextSample += interval;
+	}
+	captureCount = count;
+	captureInProgress = true;
+	return true;
+}
+
+static int analogCaptureDone() { return true; }
+static void analogCaptureStop() { }
+
+#endif
+
+static OBJ primAnalogCaptureStart(int argCount, OBJ *args) {
+	// Start capturing <count> samples from <pin> at <sample rate> without
+	// blocking; use analogCaptureDone and analogCaptureResult to collect them.
+
+	if (argCount < 3) return fail(notEnoughArguments);
+	if (!isInt(args[0]) || !isInt(args[1]) || !isInt(args[2])) return fail(needsIntegerError);
+	int pinNum = obj2int(args[0]);
+	int sampleRate = obj2int(args[1]);
+	int count = obj2int(args[2]);
+	if (count < 1) return fail(needsIntegerError);
+	if (count > CAPTURE_MAX_SAMPLES) count = CAPTURE_MAX_SAMPLES;
+	if (captureInProgress && !analogCaptureDone()) return falseObj; // capture already running
+
+	return analogCaptureStart(pinNum, sampleRate, count) ? trueObj : falseObj;
+}
+
+static OBJ primAnalogCaptureDone(int argCount, OBJ *args) {
+	return analogCaptureDone() ? trueObj : falseObj;
+}
+
+static OBJ primAnalogCaptureResult(int argCount, OBJ *args) {
+	// Return the samples of a completed capture as an int16 array, or false
+	// if no capture has completed.
+
+	if (!captureInProgress || !analogCaptureDone()) return falseObj;
+	captureInProgress = false;
+	analogCaptureStop();
+
+	int count = captureCount;
+	OBJ result = newObj(Int16ArrayType, (count + 1) / 2, falseObj);
+	if (!result) return fail(insufficientMemoryError);
+	setByteCountAdjust(result, 2 * count);
+	int16_t *dst = (int16_t *) &FIELD(result, 0);
+	for (int i = 0; i < count; i++) {
+		int sample = captureBuf[i];
+		if (sample < 0) sample = 0; // SAADC can report small negative values near ground
+		dst[i] = sample;
+	}
+	return result;
+}
+
 #if defined(ESP32)
 	#define MAX_ESP32_CHANNELS 8 // MAX 16
 	int esp32Channels[MAX_ESP32_CHANNELS];
@@ -886,6 +1074,159 @@ void primDigitalSet(int pinNum, int flag) {
 	digitalWrite(pinNum, (flag ? HIGH : LOW));
 }
 
+// Port-Level Parallel Pin Output
+// Driving an 8-bit parallel bus (LCD, R2R DAC, stepper phases) one digitalWrite
+// at a time costs a prim call per pin per value. portMap records a set of pins
+// once, caching each pin's GPIO port and bit mask; portWrite then updates all of
+// them with one store per port via the atomic set/clear registers, and portRead
+// samples them all from a single read of the input register.
+
+#define MAX_PORT_PINS 16
+
+static int portPinCount = 0;
+static uint8 portPins[MAX_PORT_PINS]; // pin numbers, after board pin mapping
+
+#if defined(NRF51) || defined(NRF52)
+
+static NRF_GPIO_Type *portPinPort[MAX_PORT_PINS];
+static uint32 portPinMask[MAX_PORT_PINS];
+
+static void portCachePin(int i, int pinNum) {
+	int hwPin = g_ADigitalPinMap[pinNum];
+	portPinPort[i] = (NRF_GPIO_Type *) ((hwPin < 32) ? 0x50000000 : 0x50000300);
+	portPinMask[i] = 1 << (hwPin & 0x1F);
+}
+
+static void portWritePins(int value) {
+	NRF_GPIO_Type *p0 = (NRF_GPIO_Type *) 0x50000000;
+	NRF_GPIO_Type *p1 = (NRF_GPIO_Type *) 0x50000300;
+	uint32 set0 = 0, clr0 = 0, set1 = 0, clr1 = 0;
+	for (int i = 0; i < portPinCount; i++) {
+		if (p0 == portPinPort[i]) {
+			if (value & (1 << i)) set0 |= portPinMask[i]; else clr0 |= portPinMask[i];
+		} else {
+			if (value & (1 << i)) set1 |= portPinMask[i]; else clr1 |= portPinMask[i];
+		}
+	}
+	if (set0) p0->OUTSET = set0;
+	if (clr0) p0->OUTCLR = clr0;
+	if (set1) p1->OUTSET = set1;
+	if (clr1) p1->OUTCLR = clr1;
+}
+
+static int portReadPins() {
+	NRF_GPIO_Type *p0 = (NRF_GPIO_Type *) 0x50000000;
+	NRF_GPIO_Type *p1 = (NRF_GPIO_Type *) 0x50000300;
+	uint32 in0 = p0->IN;
+	uint32 in1 = p1->IN;
+	int result = 0;
+	for (int i = 0; i < portPinCount; i++) {
+		uint32 in = (p0 == portPinPort[i]) ? in0 : in1;
+		if (in & portPinMask[i]) result |= (1 << i);
+	}
+	return result;
+}
+
+#elif defined(ARDUINO_ARCH_ESP32)
+
+static uint32 portPinMaskLo[MAX_PORT_PINS]; // mask in GPIO.out (pins 0-31)
+static uint32 portPinMaskHi[MAX_PORT_PINS]; // mask in GPIO.out1 (pins 32+)
+
+static void portCachePin(int i, int pinNum) {
+	portPinMaskLo[i] = (pinNum < 32) ? (1 << pinNum) : 0;
+	portPinMaskHi[i] = (pinNum < 32) ? 0 : (1 << (pinNum - 32));
+}
+
+static void portWritePins(int value) {
+	uint32 setLo = 0, clrLo = 0, setHi = 0, clrHi = 0;
+	for (int i = 0; i < portPinCount; i++) {
+		if (value & (1 << i)) {
+			setLo |= portPinMaskLo[i];
+			setHi |= portPinMaskHi[i];
+		} else {
+			clrLo |= portPinMaskLo[i];
+			clrHi |= portPinMaskHi[i];
+		}
+	}
+	if (setLo) GPIO.out_w1ts = setLo;
+	if (clrLo) GPIO.out_w1tc = clrLo;
+	if (setHi) GPIO.out1_w1ts.val = setHi;
+	if (clrHi) GPIO.out1_w1tc.val = clrHi;
+}
+
+static int portReadPins() {
+	uint32 inLo = GPIO.in;
+	uint32 inHi = GPIO.in1.val;
+	int result = 0;
+	for (int i = 0; i < portPinCount; i++) {
+		if ((inLo & portPinMaskLo[i]) || (inHi & portPinMaskHi[i])) result |= (1 << i);
+	}
+	return result;
+}
+
+#else // no direct port registers; fall back to per-pin writes (still one prim call)
+
+static void portCachePin(int i, int pinNum) { }
+
+static void portWritePins(int value) {
+	for (int i = 0; i < portPinCount; i++) {
+		digitalWrite(portPins[i], (value & (1 << i)) ? HIGH : LOW);
+	}
+}
+
+static int portReadPins() {
+	int result = 0;
+	for (int i = 0; i < portPinCount; i++) {
+		if (digitalRead(portPins[i])) result |= (1 << i);
+	}
+	return result;
+}
+
+#endif
+
+static OBJ primPortMap(int argCount, OBJ *args) {
+	// Map a list of pins (up to 16) as a parallel port. The first pin in the
+	// list is the least significant bit of the port value.
+
+	if (argCount < 1) return fail(notEnoughArguments);
+	if (!IS_TYPE(args[0], ListType)) return fail(needsListError);
+	OBJ pinList = args[0];
+	int count = obj2int(FIELD(pinList, 0));
+	if (count > MAX_PORT_PINS) count = MAX_PORT_PINS;
+
+	portPinCount = 0;
+	for (int i = 0; i < count; i++) {
+		OBJ item = FIELD(pinList, i + 1);
+		if (!isInt(item)) return fail(needsIntegerError);
+		int pinNum = mapDigitalPinNum(obj2int(item));
+		if ((pinNum < 0) || (pinNum >= TOTAL_PINS)) return fail(needsIntegerIndexError);
+		SET_MODE(pinNum, OUTPUT);
+		portPins[i] = pinNum;
+		portCachePin(i, pinNum);
+		portPinCount = i + 1;
+	}
+	return falseObj;
+}
+
+static OBJ primPortWrite(int argCount, OBJ *args) {
+	// Write the bits of the given value to the mapped pins in one store per GPIO port.
+
+	if (argCount < 1) return fail(notEnoughArguments);
+	if (!isInt(args[0])) return fail(needsIntegerError);
+	if (portPinCount > 0) portWritePins(obj2int(args[0]));
+	return falseObj;
+}
+
+static OBJ primPortRead(int argCount, OBJ *args) {
+	// Read all mapped pins from a single input-register read and return them
+	// as an integer. The optional argument, if true, sets the pins to inputs first.
+
+	if ((argCount > 0) && (trueObj == args[0])) {
+		for (int i = 0; i < portPinCount; i++) SET_MODE(portPins[i], INPUT);
+	}
+	return int2obj((portPinCount > 0) ? portReadPins() : 0);
+}
+
 // User LED
 
 void primSetUserLED(OBJ *args) {
@@ -1025,7 +1366,91 @@ void stopPWM() {
 
 // Servo and Tone
 
-#if defined(NRF51) || defined(NRF52)
+#if defined(NRF52)
+
+// Servo pulses are generated by the PWM0 peripheral in individual-load mode:
+// the four PWM channels read their pulse widths from servoSeq via EasyDMA at
+// the start of every 20 msec frame and loop forever, so pulses continue with
+// no CPU involvement -- GC pauses and interpreter load cannot cause jitter --
+// and a position update is a single RAM store.
+
+#define MAX_SERVOS 4
+#define UNUSED 255
+
+static char servoPin[MAX_SERVOS] = {UNUSED, UNUSED, UNUSED, UNUSED};
+static uint16_t servoSeq[MAX_SERVOS]; // pulse widths in usecs; MSB selects inverted polarity
+
+static void servoReconfigurePWM() {
+	// (Re)configure PWM0 for the current set of attached servo pins.
+	// PSEL may only be changed while the peripheral is disabled.
+
+	NRF_PWM0->TASKS_STOP = 1;
+	NRF_PWM0->ENABLE = 0;
+	int activeCount = 0;
+	for (int i = 0; i < MAX_SERVOS; i++) {
+		if (UNUSED == servoPin[i]) {
+			NRF_PWM0->PSEL.OUT[i] = 0xFFFFFFFF; // disconnected
+		} else {
+			NRF_PWM0->PSEL.OUT[i] = g_ADigitalPinMap[servoPin[i]];
+			activeCount++;
+		}
+	}
+	if (!activeCount) return; // no servos attached; leave the peripheral off
+
+	NRF_PWM0->MODE = 0; // up counter
+	NRF_PWM0->PRESCALER = 4; // 1 MHz (16 MHz / 2^4)
+	NRF_PWM0->COUNTERTOP = 20000; // 20 msec servo frame
+	NRF_PWM0->DECODER = 2; // individual load: one sequence entry per channel
+	NRF_PWM0->LOOP = 1;
+	NRF_PWM0->SHORTS = 4; // LOOPSDONE_SEQSTART0: repeat forever
+	for (int i = 0; i < 2; i++) { // both sequences play the same pulse widths
+		NRF_PWM0->SEQ[i].PTR = (uint32) servoSeq;
+		NRF_PWM0->SEQ[i].CNT = MAX_SERVOS;
+		NRF_PWM0->SEQ[i].REFRESH = 0; // reload pulse widths every frame
+		NRF_PWM0->SEQ[i].ENDDELAY = 0;
+	}
+	NRF_PWM0->ENABLE = 1;
+	NRF_PWM0->TASKS_SEQSTART[0] = 1;
+}
+
+static void setServo(int pin, int usecs) {
+	if (usecs <= 0) { // turn off servo
+		for (int i = 0; i < MAX_SERVOS; i++) {
+			if (pin == servoPin[i]) {
+				servoPin[i] = UNUSED;
+				servoSeq[i] = 0x8000; // zero pulse width
+				servoReconfigurePWM();
+			}
+		}
+		return;
+	}
+	for (int i = 0; i < MAX_SERVOS; i++) {
+		if (pin == servoPin[i]) { // update the pulse width for the given pin
+			servoSeq[i] = 0x8000 | usecs; // hardware reloads it next frame
+			if (!NRF_PWM0->ENABLE) servoReconfigurePWM(); // restart after stopPWM
+			return;
+		}
+	}
+	for (int i = 0; i < MAX_SERVOS; i++) {
+		if (UNUSED == servoPin[i]) { // found unused servo entry
+			servoPin[i] = pin;
+			servoSeq[i] = 0x8000 | usecs;
+			servoReconfigurePWM();
+			return;
+		}
+	}
+}
+
+void stopServos() {
+	for (int i = 0; i < MAX_SERVOS; i++) {
+		servoPin[i] = UNUSED;
+		servoSeq[i] = 0x8000;
+	}
+	NRF_PWM0->TASKS_STOP = 1;
+	NRF_PWM0->ENABLE = 0;
+}
+
+#elif defined(NRF51)
 
 // NRF5 Servo State
 
@@ -1191,7 +1616,53 @@ void stopServos() {
 
 // Tone Generation
 
-#if defined(NRF51) || defined(NRF52)
+#if defined(NRF52)
+
+// Tones are square waves generated by the PWM1 peripheral, which replays a
+// one-entry sequence (a 50% duty cycle at the desired period) forever via
+// EasyDMA. Once a note is started the CPU is not involved at all, so tones
+// stay glitch-free even when the interpreter or garbage collector is busy.
+
+static int tonePin = -1;
+static uint16_t toneSeq[2]; // both sequences share the same half-period entry
+
+static void setTone(int pin, int frequency) {
+	int period = 16000000 / frequency; // period in 16 MHz ticks
+	int prescaler = 0;
+	while ((period > 32767) && (prescaler < 7)) { // COUNTERTOP is 15 bits
+		period = period / 2;
+		prescaler++;
+	}
+	toneSeq[0] = toneSeq[1] = 0x8000 | (period / 2); // 50% duty, start high
+
+	NRF_PWM1->TASKS_STOP = 1;
+	NRF_PWM1->ENABLE = 0; // PSEL may only be changed while disabled
+	NRF_PWM1->PSEL.OUT[0] = g_ADigitalPinMap[pin];
+	for (int i = 1; i < 4; i++) NRF_PWM1->PSEL.OUT[i] = 0xFFFFFFFF; // disconnected
+	NRF_PWM1->MODE = 0; // up counter
+	NRF_PWM1->PRESCALER = prescaler;
+	NRF_PWM1->COUNTERTOP = period;
+	NRF_PWM1->DECODER = 0; // common: one entry drives all channels
+	NRF_PWM1->LOOP = 1;
+	NRF_PWM1->SHORTS = 4; // LOOPSDONE_SEQSTART0: repeat forever
+	for (int i = 0; i < 2; i++) {
+		NRF_PWM1->SEQ[i].PTR = (uint32) toneSeq;
+		NRF_PWM1->SEQ[i].CNT = 1;
+		NRF_PWM1->SEQ[i].REFRESH = 0;
+		NRF_PWM1->SEQ[i].ENDDELAY = 0;
+	}
+	NRF_PWM1->ENABLE = 1;
+	NRF_PWM1->TASKS_SEQSTART[0] = 1;
+	tonePin = pin;
+}
+
+void stopTone() {
+	NRF_PWM1->TASKS_STOP = 1;
+	NRF_PWM1->ENABLE = 0;
+	tonePin = -1;
+}
+
+#elif defined(NRF51)
 
 static void setTone(int pin, int frequency) {
 	tonePin = pin;
@@ -1507,6 +1978,12 @@ static PrimEntry entries[] = {
 	{"setServo", primSetServo},
 	{"dacInit", primDACInit},
 	{"dacWrite", primDACWrite},
+	{"portMap", primPortMap},
+	{"portWrite", primPortWrite},
+	{"portRead", primPortRead},
+	{"analogCaptureStart", primAnalogCaptureStart},
+	{"analogCaptureDone", primAnalogCaptureDone},
+	{"analogCaptureResult", primAnalogCaptureResult},
 };
 
 void addIOPrims() {
@@ -67,8 +67,47 @@ static OBJ freeChunk = NULL;
 
 static OBJ tempObj = NULL; // used during resizeObj()
 
+// Size-Class Free Lists
+//
+// Small dead objects are linked into per-size free lists so that steady-state
+// allocation of small, short-lived objects (strings from join, small lists) is a
+// pop from the matching list rather than a bump that eventually forces a full,
+// compacting collection. The lists are rebuilt by reclaimSmallChunks(), which marks
+// live objects and frees dead ones without compacting, and are emptied whenever the
+// heap is compacted (compaction consolidates all free space into the final chunk).
+// A free chunk on a list stores the next chunk of its size in its first body word.
+
+#define MAX_SMALL_WORDS 8
+static OBJ freeLists[MAX_SMALL_WORDS + 1]; // indexed by word count (1..MAX_SMALL_WORDS)
+
+static void clearFreeLists(void) {
+	for (int i = 0; i <= MAX_SMALL_WORDS; i++) freeLists[i] = NULL;
+}
+
+static void freeListAdd(OBJ chunk) {
+	// Add the given free chunk to the free list for its size, if it has one.
+
+	int wordCount = WORDS(chunk);
+	if ((wordCount < 1) || (wordCount > MAX_SMALL_WORDS)) return;
+	chunk[1] = (int) freeLists[wordCount];
+	freeLists[wordCount] = chunk;
+}
+
+static OBJ freeListAlloc(int wordCount) {
+	// Return a free chunk of exactly the given size, or NULL if the matching
+	// free list is empty.
+
+	if ((wordCount < 1) || (wordCount > MAX_SMALL_WORDS)) return NULL;
+	OBJ result = freeLists[wordCount];
+	if (result) freeLists[wordCount] = (OBJ) result[1];
+	return result;
+}
+
 extern OBJ lastBroadcast; // an additional GC root
 
+static void gcAbortIncrementalMark(void); // forward reference
+static void reclaimSmallChunks(void); // forward reference
+
 // Initialization
 
 void memInit() {
@@ -86,6 +125,9 @@ void memInit() {
 void memClear() {
 	// Clear object memory and set all global variables to zero.
 
+	clearStringCursorCache();
+	clearJSONCache();
+
 	// clear global variables
 	for (int i = 0; i < MAX_VARS; i++) vars[i] = zeroObj;
 	lastBroadcast = zeroObj;
@@ -97,6 +139,9 @@ void memClear() {
 	objstore[0] = (OBJ) 0; // forwarding word
 	objstore[1] = (OBJ) HEADER(FREE_CHUNK, OBJSTORE_WORDS - 2); // free chunk
 	freeChunk = (OBJ) &objstore[1];
+
+	clearFreeLists();
+	gcAbortIncrementalMark(); // discard any in-progress incremental mark
 }
 
 int wordsFree() {
@@ -125,25 +170,39 @@ void gc();
 OBJ newObj(int type, int wordCount, OBJ fill) {
 	// Allocate a new object of the given size.
 
-	// check available space
-	int available = WORDS(freeChunk);
-	if (available < (wordCount + 2)) {
-		gc();
-		available = WORDS(freeChunk); // retry after garbage collection
-		if (available < (wordCount + 2)) return fail(insufficientMemoryError);
+	// fast path: reuse a free chunk of exactly the right size
+	OBJ result = freeListAlloc(wordCount);
+
+	if (!result) {
+		// check available space
+		int available = WORDS(freeChunk);
+		if (available < (wordCount + 2)) {
+			// free chunk exhausted: first try reclaiming small dead objects without
+			// the cost of a full, compacting collection
+			reclaimSmallChunks();
+			result = freeListAlloc(wordCount);
+		}
+		if (!result) {
+			available = WORDS(freeChunk);
+			if (available < (wordCount + 2)) {
+				gc();
+				available = WORDS(freeChunk); // retry after garbage collection
+				if (available < (wordCount + 2)) return fail(insufficientMemoryError);
+			}
+			// allocate result and update freeChunk
+			result = (OBJ) freeChunk;
+			freeChunk += wordCount + 2;
+			*freeChunk = HEADER(FREE_CHUNK, available - (wordCount + 2));
+		}
 	}
 
-	// allocate result and update freeChunk
-	OBJ result = (OBJ) freeChunk;
-	freeChunk += wordCount + 2;
-	*freeChunk = HEADER(FREE_CHUNK, available - (wordCount + 2));
-
 	// initialize and return the new object
 	*(result - 1) = 0; // clear its forwarding word
 	*result = HEADER(type, wordCount); // set header word
 	OBJ *ptr = (OBJ *) result + 1;
 	OBJ *end = ptr + wordCount;
 	while (ptr < end) { *ptr++ = fill; }
+	gcBarrier(result); // if an incremental mark is in progress, the new object is born marked
 	return result;
 }
 
@@ -159,6 +218,10 @@ OBJ resizeObj(OBJ oldObj, int wordCount) {
 	tempObj = NULL;
 	if (!result) return oldObj;
 
+	// resizing uses the forwarding fields, which also hold the incremental mark bits,
+	// so any incremental mark in progress must be discarded
+	gcAbortIncrementalMark();
+
 	int copyCount = WORDS(oldObj);
 	if (wordCount < copyCount) copyCount = wordCount; // new size is smaller
 	memcpy(result + 1, oldObj + 1, 4 * copyCount); // copy from the old to the new body
@@ -168,6 +231,9 @@ OBJ resizeObj(OBJ oldObj, int wordCount) {
 	applyForwarding();
 	*(oldObj - 1) = 0; // clear forwarding field
 	*oldObj = HEADER(FREE_CHUNK, WORDS(oldObj)); // mark oldObj free
+	freeListAdd(oldObj); // make the old chunk immediately reusable
+	clearStringCursorCache(); // the old chunk's address may be reused
+	clearJSONCache();
 
 	return result;
 }
@@ -438,6 +504,8 @@ void sweep() {
 void compact() {
 	// Consolidate free space into a single free chunk.
 
+	clearFreeLists(); // compaction squeezes out the chunks on the free lists
+
 	uint32 *next = (uint32 *) objstore + 1;
 	uint32 *end = (uint32 *) &objstore[OBJSTORE_WORDS];
 	uint32 *dst = next;
@@ -455,17 +523,226 @@ void compact() {
 	freeChunk = (OBJ) dst;
 }
 
+// Incremental Collection
+//
+// To bound collection pauses, marking can be done incrementally from the VM's
+// background loop (gcIncrementalStep), a few hundred words of tracing per step,
+// instead of in a single stop-the-world pass when newObj() runs out of memory.
+// An incremental mark starts when free space runs low. Marked objects whose fields
+// still need to be scanned ("gray" objects) are kept on a small stack; if it
+// overflows, the heap is rescanned for marked objects and their unmarked children.
+// Objects allocated while a mark is in progress are marked at birth, and primitives
+// that store pointers into existing objects call gcBarrier() so the marker cannot
+// miss the stored object. When no gray objects remain, the collection finishes with
+// a short synchronous phase: re-mark the roots (which are not write-barriered, so
+// they are simply rescanned), then sweep and compact as usual.
+
+#define GC_GRAY_STACK_SIZE 64
+#define GC_SLICE_WORDS 256 // approximate tracing work per incremental step
+#define GC_MIN_INTERVAL_MSECS 500 // minimum time between incremental collections
+
+static int gcMarking = false;
+static OBJ grayStack[GC_GRAY_STACK_SIZE];
+static int grayCount = 0;
+static int grayOverflow = false;
+static uint32 *rescanNext = NULL; // heap rescan position after a gray stack overflow
+static uint32 lastIncrementalGC = 0;
+
+static void grayObj(OBJ obj) {
+	// Mark the given object and, if it has pointer fields, queue it for scanning.
+
+	if (isInt(obj)) return;
+	if ((obj < memStart) || (obj > memEnd)) return; // outside the object store
+	if (IS_MARKED(obj)) return;
+	SET_MARK(obj);
+	if (TYPE(obj) > BinaryObjectTypes) { // object with pointer fields; queue it
+		if (grayCount < GC_GRAY_STACK_SIZE) {
+			grayStack[grayCount++] = obj;
+		} else {
+			grayOverflow = true; // gray stack full; rescan the heap later
+		}
+	}
+}
+
+static void scanGrayObj(OBJ obj) {
+	// Gray the children of the given object.
+
+	for (int i = WORDS(obj); i > 0; i--) grayObj((OBJ) obj[i]);
+}
+
+void gcBarrier(OBJ obj) {
+	// Write barrier, called when a pointer is stored into an existing object (and
+	// on each new object) so an in-progress incremental mark cannot miss it.
+
+	if (gcMarking) grayObj(obj);
+}
+
+static void grayRoots(void) {
+	// gray global variables
+	for (int i = 0; i < MAX_VARS; i++) grayObj(vars[i]);
+	grayObj(lastBroadcast);
+
+	if (tempObj) grayObj(tempObj);
+
+	// gray objects on Task stacks
+	for (int i = 0; i < taskCount; i++) {
+		Task *task = &tasks[i];
+		if (task->status != unusedTask) {
+			for (int j = tasks[i].sp - 1; j >= 0; j--) {
+				grayObj(task->stack[j]);
+			}
+		}
+	}
+}
+
+static int rescanStep(int budget) {
+	// Scan marked objects for unmarked children, graying any found. Used to recover
+	// from a gray stack overflow. Returns the unused portion of the work budget.
+
+	uint32 *end = (uint32 *) &objstore[OBJSTORE_WORDS];
+	while ((rescanNext < end) && (budget > 0)) {
+		uint32 wordCount = WORDS(rescanNext);
+		if ((TYPE(rescanNext) > BinaryObjectTypes) && IS_MARKED(rescanNext)) {
+			scanGrayObj((OBJ) rescanNext);
+			budget -= wordCount;
+		}
+		budget--;
+		rescanNext += wordCount + 2;
+	}
+	if (rescanNext >= end) rescanNext = NULL; // rescan complete
+	return budget;
+}
+
+static void finishIncrementalMark(void) {
+	// Synchronously finish scanning all gray objects.
+
+	while (true) {
+		while (grayCount) scanGrayObj(grayStack[--grayCount]);
+		if (grayOverflow) {
+			grayOverflow = false;
+			rescanNext = (uint32 *) objstore + 1;
+		} else if (rescanNext) {
+			rescanStep(0x7FFFFFFF);
+		} else {
+			break;
+		}
+	}
+}
+
+static void gcAbortIncrementalMark(void) {
+	// Discard an in-progress incremental mark (e.g. when resizeObj() needs the
+	// forwarding fields, which hold the mark bits). The next incremental step
+	// simply starts over.
+
+	gcMarking = false;
+	grayCount = 0;
+	grayOverflow = false;
+	rescanNext = NULL;
+}
+
+static void reclaimSmallChunks(void) {
+	// Mark live objects and turn dead chunks into size-class free lists, without
+	// compacting the heap. Much cheaper than a full gc() and sufficient to keep a
+	// steady churn of small, short-lived objects from ever forcing a compaction.
+
+	if (gcMarking) { // finish the in-progress incremental mark rather than discard it
+		finishIncrementalMark();
+		gcMarking = false;
+		lastIncrementalGC = millisecs();
+	}
+	clearStringCursorCache(); // dead chunk addresses become reusable
+	clearJSONCache();
+	markRoots();
+
+	clearFreeLists(); // rebuild the lists from scratch to avoid double-linking chunks
+	uint32 *end = (uint32 *) &objstore[OBJSTORE_WORDS];
+	uint32 *next = (uint32 *) objstore + 1;
+	while (next < end) {
+		uint32 wordCount = WORDS(next);
+		if ((OBJ) next != freeChunk) { // never link the final (bump allocation) chunk
+			if (!*(next - 1)) { // unmarked: dead object or free chunk
+				*next = HEADER(FREE_CHUNK, wordCount);
+				freeListAdd((OBJ) next);
+			}
+		}
+		next += wordCount + 2;
+	}
+	clearForwardingFields(); // clear the mark bits
+}
+
+void gcIncrementalStep() {
+	// Do a bounded amount of garbage collection work. Called from the VM's
+	// background loop so that no single VM cycle pays for a full collection.
+
+	if (!gcMarking) {
+		if (wordsFree() > (OBJSTORE_WORDS / 8)) return; // plenty of free space
+		uint32 now = millisecs();
+		if ((now - lastIncrementalGC) < GC_MIN_INTERVAL_MSECS) return;
+		gcMarking = true;
+		grayCount = 0;
+		grayOverflow = false;
+		rescanNext = NULL;
+		grayRoots();
+		return;
+	}
+	int budget = GC_SLICE_WORDS;
+	while (budget > 0) {
+		if (grayCount) {
+			OBJ obj = grayStack[--grayCount];
+			scanGrayObj(obj);
+			budget -= WORDS(obj) + 1;
+		} else if (grayOverflow) {
+			grayOverflow = false;
+			rescanNext = (uint32 *) objstore + 1;
+		} else if (rescanNext) {
+			budget = rescanStep(budget);
+		} else {
+			// marking complete; finish with a short synchronous phase
+			clearStringCursorCache(); // compaction moves or reuses object addresses
+			clearJSONCache();
+			markRoots(); // catch references created or moved since marking began
+			sweep();
+			applyForwarding();
+			compact();
+			gcMarking = false;
+			lastIncrementalGC = millisecs();
+			return;
+		}
+	}
+}
+
+// GC pause statistics, kept as a histogram of collection times (used by the
+// benchmark suite; see benchmark.c)
+
+uint32 gcPauseHistogram[GC_PAUSE_BUCKETS];
+
+void gcClearPauseStats() {
+	for (int i = 0; i < GC_PAUSE_BUCKETS; i++) gcPauseHistogram[i] = 0;
+}
+
 void gc() {
 	// Perform a garbage collection to reclaim unused objects and compact memory.
 
 	uint32 usecs = microsecs();
+	clearStringCursorCache(); // objects may move or have their addresses reused
+	clearJSONCache();
 	// assume: forwarding pointers cleared at end of compaction so no need to clear them here
+	if (gcMarking) { // finish the in-progress incremental mark rather than discard it
+		finishIncrementalMark();
+		gcMarking = false;
+		lastIncrementalGC = millisecs();
+	}
 	markRoots();
 	sweep();
 	applyForwarding();
 	compact();
 	usecs = microsecs() - usecs;
 
+	int bucket = 0;
+	uint32 limit = 250;
+	while ((bucket < (GC_PAUSE_BUCKETS - 1)) && (usecs >= limit)) { bucket++; limit *= 2; }
+	gcPauseHistogram[bucket]++;
+
 	char s[100];
 	sprintf(s, "GC took %d usecs; free %d words", usecs, WORDS(freeChunk) - 2);
 	outputString(s);
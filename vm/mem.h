@@ -22,6 +22,7 @@ extern "C" {
 // Unsigned integer types
 
 typedef unsigned char uint8;
+typedef short int16;
 typedef unsigned int uint32;
 
 // Boolean constants for readability (if not already defined)
@@ -42,10 +43,12 @@ typedef int * OBJ;
 #define IntegerType 2
 #define ByteArrayType 3
 #define StringType 4
-// types 5-7 reserved for future non-pointer objects
+#define Int16ArrayType 5 // packed array of 16-bit signed integers
+// types 6-7 reserved for future non-pointer objects
 #define BinaryObjectTypes 7 // objects with type ID's <= 7 do not contain pointers
 #define ArrayType 8
 #define ListType 9
+#define DictionaryType 10 // <entry count><array of key-value slot pairs>; see dataPrims.c
 
 // Booleans
 // Note: These are constants, not pointers to objects in memory.
@@ -90,7 +93,8 @@ static inline int objWords(OBJ obj) {
 #define BYTES(obj) (4 * WORDS(obj) - BYTECOUNT_ADJUST(obj))
 
 static inline void setByteCountAdjust(OBJ obj, int byteCount) {
-	if (isInt(obj) || isBoolean(obj) || (ByteArrayType != TYPE(obj))) return;
+	if (isInt(obj) || isBoolean(obj)) return;
+	if ((ByteArrayType != TYPE(obj)) && (Int16ArrayType != TYPE(obj))) return;
 	int delta = 4 - (byteCount & 3); // # of bytes to subtract from 4 * WORDS(obj)
 	*obj = ((delta & 3) << 29) | ((*obj) & 0x9FFFFFFF);
 }
@@ -118,6 +122,16 @@ void memInit();
 void memClear();
 int wordsFree();
 void gc();
+void gcIncrementalStep();
+void gcBarrier(OBJ obj);
+
+// GC pause statistics (usec buckets: <250, <500, <1000, <2000, <4000, <8000, <16000, >=16000)
+
+#define GC_PAUSE_BUCKETS 8
+extern uint32 gcPauseHistogram[GC_PAUSE_BUCKETS];
+void gcClearPauseStats();
+void clearStringCursorCache();
+void clearJSONCache();
 
 OBJ newObj(int typeID, int wordCount, OBJ fill);
 OBJ resizeObj(OBJ obj, int wordCount);
@@ -33,6 +33,80 @@ static OBJ primSine(int argCount, OBJ *args) {
 	return int2obj((int) round(16384.0 * sin(evalInt(args[0]) * hundrethsToRadians)));
 }
 
+// JSON Parse Cache
+// tinyJSON scans the JSON string from the start on every query, so a script
+// that iterates over a large array (e.g. "for i in 1..count { jsonValueAt ... }")
+// is quadratic in the size of the string. Cache the result of the most recent
+// path lookup along with a table of element offsets, keyed by string object
+// identity. Strings are immutable, so entries only go stale when the garbage
+// collector moves objects or reuses addresses; it clears the cache (see
+// clearJSONCache) whenever that can happen, so a stale entry can never match.
+
+#define JSON_CACHE_MAX_ITEMS 64
+
+static OBJ jsonCacheObj = NULL; // JSON string of the cached query, or NULL if cache is empty
+static char jsonCachePath[100]; // path of the cached query
+static int jsonCacheItemOffset; // offset of the item at jsonCachePath, or -1 if not found
+static int jsonCacheCount; // result of tjr_count() on the item, or -1 if not yet computed
+static int jsonCacheElemCount; // number of element offsets recorded so far
+static uint16 jsonCacheOffsets[JSON_CACHE_MAX_ITEMS]; // offsets of the item's first N values
+
+void clearJSONCache() {
+	jsonCacheObj = NULL;
+}
+
+static char * jsonItemAtPath(OBJ jsonObj, char *json, char *path) {
+	// Like tjr_atPath() but cache the result, since scripts typically make many
+	// queries on the same JSON string and often with the same path.
+
+	if ((jsonObj == jsonCacheObj) && (0 == strcmp(path, jsonCachePath))) {
+		return (jsonCacheItemOffset >= 0) ? (json + jsonCacheItemOffset) : NULL;
+	}
+	char *item = tjr_atPath(json, path);
+	if (strlen(path) < sizeof(jsonCachePath)) {
+		jsonCacheObj = jsonObj;
+		strcpy(jsonCachePath, path);
+		jsonCacheItemOffset = item ? (item - json) : -1;
+		jsonCacheCount = -1;
+		jsonCacheElemCount = 0;
+	}
+	return item;
+}
+
+static char * jsonValueAtIndex(OBJ jsonObj, char *json, char *item, int i) {
+	// Return the value at the given (one-based) index of the array or object at
+	// item, like tjr_valueAt(), but resume from the cached element offset table
+	// so that sequential access does not rescan earlier elements.
+
+	if (!item || (i < 1)) return NULL;
+	int itemType = tjr_type(item);
+	if ((tjr_Array != itemType) && (tjr_Object != itemType)) return NULL;
+	if ((jsonObj != jsonCacheObj) || ((item - json) != jsonCacheItemOffset)) {
+		return tjr_valueAt(item, i); // not the cached item
+	}
+	if (i <= jsonCacheElemCount) return json + jsonCacheOffsets[i - 1];
+
+	int n = jsonCacheElemCount;
+	char *p = (n > 0) ? (json + jsonCacheOffsets[n - 1]) : NULL;
+	while (n < i) {
+		if (0 == n) {
+			p = tjr_valueAt(item, 1);
+		} else if (tjr_Array == itemType) {
+			p = tjr_nextElement(p);
+		} else {
+			p = tjr_nextElement(p); // skip value
+			p = tjr_nextProperty(p, NULL, 0);
+		}
+		if (!p) return NULL; // out of range
+		n++;
+		if ((n <= JSON_CACHE_MAX_ITEMS) && ((p - json) <= 65535)) {
+			jsonCacheOffsets[n - 1] = (uint16) (p - json);
+			jsonCacheElemCount = n;
+		}
+	}
+	return p;
+}
+
 static OBJ jsonValue(char *item) {
 	char buf[1024];
 	char *end;
@@ -70,7 +144,7 @@ static OBJ primJSONGet(int argCount, OBJ *args) {
 	char *path = obj2str(args[1]);
 	int i = ((argCount > 2) && isInt(args[2])) ? obj2int(args[2]) : -1;
 
-	char *item = tjr_atPath(json, path);
+	char *item = jsonItemAtPath(args[0], json, path);
 	int itemType = tjr_type(item);
 	if ((tjr_Array == itemType) && (i > 0)) {
 		item++; // skip '['
@@ -95,7 +169,11 @@ static OBJ primJSONCount(int argCount, OBJ *args) {
 	char *json = obj2str(args[0]);
 	char *path = obj2str(args[1]);
 
-	char *item = tjr_atPath(json, path);
+	char *item = jsonItemAtPath(args[0], json, path);
+	if (item && (args[0] == jsonCacheObj) && ((item - json) == jsonCacheItemOffset)) {
+		if (jsonCacheCount < 0) jsonCacheCount = tjr_count(item);
+		return int2obj(jsonCacheCount);
+	}
 	return int2obj(tjr_count(item));
 }
 
@@ -110,8 +188,8 @@ static OBJ primJSONValueAt(int argCount, OBJ *args) {
 	char *path = obj2str(args[1]);
 	int i = obj2int(args[2]);
 
-	char *item = tjr_atPath(json, path);
-	return jsonValue(tjr_valueAt(item, i));
+	char *item = jsonItemAtPath(args[0], json, path);
+	return jsonValue(jsonValueAtIndex(args[0], json, item, i));
 }
 
 static OBJ primJSONKeyAt(int argCount, OBJ *args) {
@@ -127,11 +205,23 @@ static OBJ primJSONKeyAt(int argCount, OBJ *args) {
 
 	char key[100];
 	key[0] = '\0';
-	char *item = tjr_atPath(json, path);
+	char *item = jsonItemAtPath(args[0], json, path);
 	tjr_keyAt(item, i, key, sizeof(key));
 	return newStringFromBytes(key, strlen(key));
 }
 
+static OBJ primTelemetry(int argCount, OBJ *args) {
+	// Log one telemetry sample; each argument is one channel (integer or boolean).
+	// Samples are batched and sent to the IDE as binary frames (see logTelemetry).
+
+	if (argCount < 1) return fail(notEnoughArguments);
+	for (int i = 0; i < argCount; i++) {
+		if (!(isInt(args[i]) || isBoolean(args[i]))) return fail(needsIntegerError);
+	}
+	logTelemetry(argCount, args);
+	return falseObj;
+}
+
 // Primitives
 
 static PrimEntry entries[] = {
@@ -141,6 +231,7 @@ static PrimEntry entries[] = {
 	{"jsonCount", primJSONCount},
 	{"jsonValueAt", primJSONValueAt},
 	{"jsonKeyAt", primJSONKeyAt},
+	{"telemetry", primTelemetry},
 };
 
 void addMiscPrims() {
@@ -36,7 +36,6 @@ static char connecting = false;
 static char serverStarted = false;
 
 WiFiServer server(80);
-WiFiClient client;
 
 #if defined(ARDUINO_ARCH_ESP32)
 WebSocketsServer webSocket = WebSocketsServer(81);
@@ -212,6 +211,20 @@ static OBJ primGetMAC(int argCount, OBJ *args) {
 }
 
 // HTTP Server
+//
+// The server maintains a small pool of client connections so that several
+// browsers doing parallel fetches (e.g. a dashboard polling many boards) are
+// served interleaved instead of queueing behind a single connection. Waiting
+// connections are accepted into free pool slots without blocking. Requests are
+// read from one client at a time -- the current client, which responses are
+// also sent to -- and the server moves on to the next client with data once
+// the current client's buffered data has been consumed, so chunked reads of a
+// single request are never interleaved across clients.
+
+#define MAX_HTTP_CLIENTS 4
+
+WiFiClient httpClients[MAX_HTTP_CLIENTS];
+static int currentHttpClient = 0;
 
 static void startHttpServer() {
 	// Start the server the first time and *never* stop/close it. If the server is stopped
@@ -224,17 +237,35 @@ static void startHttpServer() {
 	}
 }
 
+static void acceptHttpClients() {
+	// Accept waiting connections into free pool slots. A slot is free when its
+	// client is disconnected and all of its data has been read.
+
+	for (int i = 0; i < MAX_HTTP_CLIENTS; i++) {
+		if (httpClients[i].connected() || httpClients[i].available()) continue; // in use
+		httpClients[i] = server.available(); // accept a connection into this free slot
+		if (!httpClients[i]) return; // no more waiting connections
+	}
+}
+
 static int serverHasClient() {
-	// Return true when the HTTP server has a client and the client is connected.
-	// Continue to return true if any data is available from the client even if the client
-	// has closed the connection. Start the HTTP server the first time this is called.
+	// Return true when some client has request data to read, making that client
+	// current. Continue to return data from the current client while it has any,
+	// even if it has closed the connection; otherwise move on to the next client
+	// with data, round-robin. Start the HTTP server the first time this is called.
 
 	if (!isConnectedToWiFi()) return false;
 	if (!serverStarted) startHttpServer();
+	acceptHttpClients();
 
-	if (!client) client = server.available(); // attempt to accept a client connection
-	if (!client) return false; // no client connection
-	return (client.connected() || client.available());
+	for (int i = 0; i <= MAX_HTTP_CLIENTS; i++) {
+		int c = (currentHttpClient + i) % MAX_HTTP_CLIENTS;
+		if (httpClients[c].available()) {
+			currentHttpClient = c;
+			return true;
+		}
+	}
+	return false;
 }
 
 static OBJ primHttpServerGetRequest(int argCount, OBJ *args) {
@@ -247,8 +278,9 @@ static OBJ primHttpServerGetRequest(int argCount, OBJ *args) {
 	int useBinary = ((argCount > 0) && (trueObj == args[0]));
 	OBJ noData = useBinary ? (OBJ) &emptyByteArray : (OBJ) &noDataString;
 
-	if (!serverHasClient()) return noData; // no client connection
+	if (!serverHasClient()) return noData; // no client with request data
 
+	WiFiClient &client = httpClients[currentHttpClient];
 	int byteCount = client.available();
 	if (!byteCount) return noData;
 	if (byteCount > 800) byteCount = 800; // limit to 800 bytes per chunk
@@ -277,8 +309,9 @@ static OBJ primHttpServerGetRequest(int argCount, OBJ *args) {
 }
 
 static OBJ primRespondToHttpRequest(int argCount, OBJ *args) {
-	// Send a response to the client with the status. optional extra headers, and optional body.
+	// Send a response to the current client with the status. optional extra headers, and optional body.
 
+	WiFiClient &client = httpClients[currentHttpClient];
 	if (!client) return falseObj;
 
 	// status
@@ -426,6 +459,741 @@ static OBJ primHttpResponse(int argCount, OBJ *args) {
 	return result;
 }
 
+// Streaming HTTP Response
+//
+// httpResponse returns whatever bytes happen to be available, leaving header
+// parsing, content-length tracking, and chunked decoding to user scripts,
+// which caps throughput on large downloads. Streaming mode parses the response
+// headers once, then delivers successive body segments as byte arrays:
+// httpStreamStart begins a stream after a request has been sent,
+// httpStreamData returns the next segment (empty until data arrives),
+// httpStreamHeaders returns the received header text, and httpStreamEnded
+// reports when the whole body -- delimited by Content-Length, chunked transfer
+// encoding, or connection close -- has been delivered.
+
+#define STREAM_HEADER_BYTES 600
+
+// streaming states
+#define STREAM_IDLE 0
+#define STREAM_HEADERS 1
+#define STREAM_BODY 2
+#define STREAM_CHUNK_SIZE 3
+#define STREAM_CHUNK_DATA 4
+#define STREAM_CHUNK_END 5
+#define STREAM_TRAILER 6
+#define STREAM_DONE 7
+
+static int streamState = STREAM_IDLE;
+static int streamBytesLeft = 0; // bytes left in the body or current chunk; -1 means until close
+static int chunkSizeAccum = 0;
+static char skipChunkExtension = false;
+static char streamPrevCh[2]; // last two header bytes, for detecting the blank line
+static char streamHeaders[STREAM_HEADER_BYTES];
+static int streamHeaderCount = 0;
+
+static const char * streamHeaderValue(const char *name) {
+	// Return the value of the given response header (case insensitive) or NULL.
+
+	int nameLen = strlen(name);
+	const char *line = streamHeaders;
+	while (*line) {
+		if ((0 == strncasecmp(line, name, nameLen)) && (':' == line[nameLen])) {
+			line += nameLen + 1;
+			while ((' ' == *line) || ('\t' == *line)) line++;
+			return line;
+		}
+		const char *eol = strchr(line, '\n');
+		if (!eol) break;
+		line = eol + 1;
+	}
+	return NULL;
+}
+
+static void parseStreamHeaders() {
+	const char *value = streamHeaderValue("Transfer-Encoding");
+	if (value && (0 == strncasecmp(value, "chunked", 7))) {
+		streamState = STREAM_CHUNK_SIZE;
+		chunkSizeAccum = 0;
+		skipChunkExtension = false;
+		return;
+	}
+	value = streamHeaderValue("Content-Length");
+	streamBytesLeft = value ? atoi(value) : -1;
+	streamState = (0 == streamBytesLeft) ? STREAM_DONE : STREAM_BODY;
+}
+
+static OBJ readStreamSegment() {
+	// Return the next segment of body or chunk data as a byte array.
+
+	int byteCount = httpClient.available();
+	if (byteCount > 800) byteCount = 800;
+	if ((streamBytesLeft >= 0) && (byteCount > streamBytesLeft)) byteCount = streamBytesLeft;
+	if (byteCount <= 0) return (OBJ) &emptyByteArray;
+
+	OBJ result = newObj(ByteArrayType, (byteCount + 3) / 4, falseObj);
+	while (falseObj == result) {
+		if (byteCount < 4) return (OBJ) &emptyByteArray; // out of memory
+		byteCount = byteCount / 2;
+		result = newObj(ByteArrayType, (byteCount + 3) / 4, falseObj); // try to allocate half the previous amount
+	}
+	fail(noError); // clear memory allocation error, if any
+	setByteCountAdjust(result, byteCount);
+	httpClient.read((uint8 *) &FIELD(result, 0), byteCount);
+	if (streamBytesLeft > 0) {
+		streamBytesLeft -= byteCount;
+		if (0 == streamBytesLeft) {
+			streamState = (STREAM_BODY == streamState) ? STREAM_DONE : STREAM_CHUNK_END;
+			if (STREAM_CHUNK_END == streamState) streamBytesLeft = 2; // consume CRLF after chunk data
+		}
+	}
+	return result;
+}
+
+static OBJ primHttpStreamStart(int argCount, OBJ *args) {
+	// Begin streaming the response to a previously sent HTTP request.
+
+	streamHeaderCount = 0;
+	streamHeaders[0] = 0;
+	streamPrevCh[0] = streamPrevCh[1] = 0;
+	streamBytesLeft = 0;
+	streamState = STREAM_HEADERS;
+	return falseObj;
+}
+
+static OBJ primHttpStreamData(int argCount, OBJ *args) {
+	// Return the next segment of the response body as a byte array, or an empty
+	// byte array when no body data is available yet. Call httpStreamEnded to
+	// detect the end of the response.
+
+	while (true) {
+		if (STREAM_HEADERS == streamState) {
+			while (httpClient.available()) {
+				char ch = httpClient.read();
+				if (streamHeaderCount < (STREAM_HEADER_BYTES - 1)) {
+					streamHeaders[streamHeaderCount++] = ch;
+					streamHeaders[streamHeaderCount] = 0;
+				}
+				int isBlankLine = ('\n' == ch) &&
+					(('\n' == streamPrevCh[1]) || (('\r' == streamPrevCh[1]) && ('\n' == streamPrevCh[0])));
+				streamPrevCh[0] = streamPrevCh[1];
+				streamPrevCh[1] = ch;
+				if (isBlankLine) { // end of headers
+					parseStreamHeaders();
+					break;
+				}
+			}
+			if (STREAM_HEADERS == streamState) return (OBJ) &emptyByteArray; // headers incomplete
+		} else if (STREAM_BODY == streamState) {
+			if ((-1 == streamBytesLeft) && !httpClient.connected() && !httpClient.available()) {
+				streamState = STREAM_DONE; // server closed the connection; body complete
+				return (OBJ) &emptyByteArray;
+			}
+			return readStreamSegment();
+		} else if (STREAM_CHUNK_SIZE == streamState) {
+			while (httpClient.available() && (STREAM_CHUNK_SIZE == streamState)) {
+				char ch = httpClient.read();
+				if ('\n' == ch) {
+					if (chunkSizeAccum > 0) {
+						streamBytesLeft = chunkSizeAccum;
+						streamState = STREAM_CHUNK_DATA;
+					} else { // zero-length chunk marks the end of the body
+						streamPrevCh[0] = streamPrevCh[1] = 0;
+						streamState = STREAM_TRAILER;
+					}
+					chunkSizeAccum = 0;
+					skipChunkExtension = false;
+				} else if (!skipChunkExtension) {
+					if (('0' <= ch) && (ch <= '9')) chunkSizeAccum = (16 * chunkSizeAccum) + (ch - '0');
+					else if (('a' <= ch) && (ch <= 'f')) chunkSizeAccum = (16 * chunkSizeAccum) + 10 + (ch - 'a');
+					else if (('A' <= ch) && (ch <= 'F')) chunkSizeAccum = (16 * chunkSizeAccum) + 10 + (ch - 'A');
+					else skipChunkExtension = true; // ';' extension or '\r'; ignore to end of line
+				}
+			}
+			if (STREAM_CHUNK_SIZE == streamState) return (OBJ) &emptyByteArray; // size line incomplete
+		} else if (STREAM_CHUNK_DATA == streamState) {
+			return readStreamSegment();
+		} else if (STREAM_CHUNK_END == streamState) {
+			while (httpClient.available() && (streamBytesLeft > 0)) { // consume CRLF after chunk data
+				httpClient.read();
+				streamBytesLeft--;
+			}
+			if (streamBytesLeft > 0) return (OBJ) &emptyByteArray;
+			streamState = STREAM_CHUNK_SIZE;
+		} else if (STREAM_TRAILER == streamState) {
+			while (httpClient.available() && (STREAM_TRAILER == streamState)) {
+				char ch = httpClient.read();
+				int isBlankLine = ('\n' == ch) &&
+					((0 == streamPrevCh[1]) || ('\n' == streamPrevCh[1]) ||
+					 (('\r' == streamPrevCh[1]) && (('\n' == streamPrevCh[0]) || (0 == streamPrevCh[0]))));
+				streamPrevCh[0] = streamPrevCh[1];
+				streamPrevCh[1] = ch;
+				if (isBlankLine) streamState = STREAM_DONE;
+			}
+			return (OBJ) &emptyByteArray;
+		} else { // STREAM_IDLE or STREAM_DONE
+			return (OBJ) &emptyByteArray;
+		}
+	}
+}
+
+static OBJ primHttpStreamHeaders(int argCount, OBJ *args) {
+	// Return the response headers received so far (complete once body data arrives).
+
+	return newStringFromBytes(streamHeaders, strlen(streamHeaders));
+}
+
+static OBJ primHttpStreamEnded(int argCount, OBJ *args) {
+	if ((STREAM_DONE == streamState) || (STREAM_IDLE == streamState)) return trueObj;
+	// a closed connection with no buffered data cannot deliver anything more
+	return (!httpClient.connected() && !httpClient.available()) ? trueObj : falseObj;
+}
+
+// UDP
+//
+// Connectionless datagram primitives for low-latency state exchange on a LAN.
+// Unlike TCP, a lost or delayed datagram never holds up the ones behind it, so
+// these are the right tool for high-rate telemetry where only the latest value
+// matters. Receives are non-blocking: udpReceive returns the next queued
+// datagram or false when none has arrived. Sending to a .255 broadcast address
+// reaches every board on the subnet.
+
+WiFiUDP udp;
+static int udpLocalPort = 0;
+
+static OBJ primUDPStart(int argCount, OBJ *args) {
+	// Open a UDP socket on the given local port (for receiving).
+
+	if (argCount < 1) return fail(notEnoughArguments);
+	if (!isInt(args[0])) return fail(needsIntegerError);
+	if (!isConnectedToWiFi()) return fail(noWiFi);
+	int port = obj2int(args[0]);
+	if ((port < 1) || (port > 65535)) return falseObj;
+
+	if (udpLocalPort) udp.stop();
+	udpLocalPort = udp.begin(port) ? port : 0;
+	return udpLocalPort ? trueObj : falseObj;
+}
+
+static OBJ primUDPStop(int argCount, OBJ *args) {
+	udp.stop();
+	udpLocalPort = 0;
+	return falseObj;
+}
+
+static OBJ primUDPSend(int argCount, OBJ *args) {
+	// Send a datagram: <data> <host> <port>. Data may be a string or byte array;
+	// host may be a name or an IP address (use x.x.x.255 for subnet broadcast).
+
+	if (argCount < 3) return fail(notEnoughArguments);
+	if (!IS_TYPE(args[1], StringType)) return fail(needsStringError);
+	if (!isInt(args[2])) return fail(needsIntegerError);
+	if (!isConnectedToWiFi()) return fail(noWiFi);
+
+	uint8 *data;
+	int byteCount;
+	if (IS_TYPE(args[0], StringType)) {
+		data = (uint8 *) obj2str(args[0]);
+		byteCount = strlen((char *) data);
+	} else if (IS_TYPE(args[0], ByteArrayType)) {
+		data = (uint8 *) &FIELD(args[0], 0);
+		byteCount = BYTES(args[0]);
+	} else {
+		return fail(needsIndexable);
+	}
+	char *host = obj2str(args[1]);
+	int port = obj2int(args[2]);
+	if ((port < 1) || (port > 65535)) return falseObj;
+
+	IPAddress ip;
+	int ok;
+	if (ip.fromString(host)) { // numeric address; may be a broadcast address
+		ok = udp.beginPacket(ip, port);
+	} else {
+		ok = udp.beginPacket(host, port);
+	}
+	if (!ok) return falseObj;
+	udp.write(data, byteCount);
+	return udp.endPacket() ? trueObj : falseObj;
+}
+
+static OBJ primUDPReceive(int argCount, OBJ *args) {
+	// Return the next received datagram as a byte array (or as a string if the
+	// optional argument is true), or false if none is available. Non-blocking.
+
+	if (!udpLocalPort) return falseObj;
+	int useString = ((argCount > 0) && (trueObj == args[0]));
+
+	int byteCount = udp.parsePacket();
+	if (!byteCount) return falseObj;
+	if (byteCount > 800) byteCount = 800; // datagrams over 800 bytes are truncated
+
+	OBJ result;
+	if (useString) {
+		result = newString(byteCount);
+		if (!result) { udp.flush(); return fail(insufficientMemoryError); }
+		udp.read((uint8 *) obj2str(result), byteCount);
+	} else {
+		result = newObj(ByteArrayType, (byteCount + 3) / 4, falseObj);
+		if (!result) { udp.flush(); return fail(insufficientMemoryError); }
+		setByteCountAdjust(result, byteCount);
+		udp.read((uint8 *) &FIELD(result, 0), byteCount);
+	}
+	udp.flush(); // discard any unread portion of the datagram
+	return result;
+}
+
+static OBJ primUDPRemoteAddress(int argCount, OBJ *args) {
+	// Return the sender's IP address of the most recently received datagram.
+
+	char s[100];
+	IPAddress ip = udp.remoteIP();
+	sprintf(s, "%d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
+	return newStringFromBytes(s, strlen(s));
+}
+
+// Dual-Core Networking (ESP32)
+//
+// On the ESP32, the interpreter runs on core 1 while the WiFi stack already
+// lives on core 0. Periodic socket servicing (MQTT parsing and keepalives,
+// webSocket.loop()) used to run interleaved with the interpreter, adding
+// multi-millisecond hiccups to task timing under network load. A FreeRTOS
+// task pinned to core 0 now owns that servicing; the primitives exchange
+// data with it through buffers guarded by a FreeRTOS mutex, held only for
+// short, non-blocking operations. On single-core platforms the servicing
+// stays in the VM loop and the lock calls compile to no-ops.
+
+static void mqttServiceStep();
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+static TaskHandle_t netTaskHandle = NULL;
+static SemaphoreHandle_t netMutex = NULL;
+static char websocketStarted = false;
+
+static inline void netLock() { if (netMutex) xSemaphoreTake(netMutex, portMAX_DELAY); }
+static inline void netUnlock() { if (netMutex) xSemaphoreGive(netMutex); }
+
+static void netTask(void *ignored) {
+	while (true) {
+		xSemaphoreTake(netMutex, portMAX_DELAY);
+		mqttServiceStep();
+		if (websocketStarted) webSocket.loop();
+		xSemaphoreGive(netMutex);
+		vTaskDelay(1); // yield for one tick (1 msec)
+	}
+}
+
+static void startNetTask() {
+	// Start the core 0 network servicing task the first time it is needed.
+
+	if (netTaskHandle) return;
+	if (!netMutex) netMutex = xSemaphoreCreateMutex();
+	if (!netMutex) return;
+	xTaskCreatePinnedToCore(netTask, "MicroBlocksNet", 4096, NULL, 1, &netTaskHandle, 0);
+}
+
+#else // single core; network servicing runs in the VM loop
+
+static inline void netLock() { }
+static inline void netUnlock() { }
+static void startNetTask() { }
+
+#endif // ARDUINO_ARCH_ESP32
+
+// MQTT Client
+//
+// A native MQTT 3.1.1 client (QoS 0), so scripts no longer hand-roll the
+// protocol over raw HTTP sockets. Publishes go straight to the socket without
+// blocking. Keepalive pings, CONNACK handling, and reconnection (with
+// exponential backoff and automatic re-subscription) run in mqttServiceStep --
+// on the core 0 network task on ESP32, from the VM loop elsewhere -- so a
+// flaky broker link never stalls tasks. Inbound messages are parsed
+// incrementally and queued in a ring buffer drained by the mqttLastEvent
+// primitive; the queue indices are guarded by the network mutex on ESP32,
+// where producer and consumer run on different cores.
+
+#define MQTT_KEEPALIVE_SECS 60
+#define MQTT_MAX_TOPIC 64
+#define MQTT_MAX_PAYLOAD 256
+#define MQTT_QUEUE_SIZE 8
+#define MQTT_MAX_SUBSCRIPTIONS 8
+#define MQTT_OUT_BUF 400
+#define MQTT_IN_BUF 1024
+
+// client states
+#define MQTT_IDLE 0
+#define MQTT_CONNECTING 1 // TCP connected, CONNECT sent, awaiting CONNACK
+#define MQTT_CONNECTED 2
+#define MQTT_RECONNECT_WAIT 3
+
+WiFiClient mqttClient;
+static int mqttState = MQTT_IDLE;
+static char mqttHost[64];
+static int mqttPort = 1883;
+static char mqttClientId[64];
+static char mqttUser[64];
+static char mqttPassword[64];
+static char mqttSubscriptions[MQTT_MAX_SUBSCRIPTIONS][MQTT_MAX_TOPIC];
+static int mqttSubscriptionCount = 0;
+static int mqttPacketId = 0;
+static uint32 mqttLastOutbound = 0;
+static uint32 mqttNextAttempt = 0;
+static uint32 mqttBackoffMSecs = 1000;
+
+// outgoing packet assembly (body only; the fixed header is prepended on send)
+static uint8 mqttOut[MQTT_OUT_BUF];
+static int mqttOutCount = 0;
+
+// incoming packet assembly
+static int mqttInType = -1; // -1 when expecting a fixed header byte
+static int mqttInLength = 0;
+static int mqttInLengthShift = 0;
+static char mqttInLengthDone = false;
+static int mqttInReceived = 0;
+static uint8 mqttInBuf[MQTT_IN_BUF];
+
+// inbound message queue (ring buffer; oldest message is dropped when full)
+typedef struct {
+	char topic[MQTT_MAX_TOPIC];
+	int payloadBytes;
+	uint8 payload[MQTT_MAX_PAYLOAD];
+} MQTTMessage;
+
+static MQTTMessage mqttQueue[MQTT_QUEUE_SIZE];
+static int mqttQueueHead = 0; // next message to read
+static int mqttQueueCount = 0;
+
+static void mqttOutByte(int b) {
+	if (mqttOutCount < MQTT_OUT_BUF) mqttOut[mqttOutCount++] = b;
+}
+
+static void mqttOutString(const char *s, int len) {
+	// Append a 16-bit length-prefixed string to the packet body.
+
+	mqttOutByte((len >> 8) & 255);
+	mqttOutByte(len & 255);
+	for (int i = 0; i < len; i++) mqttOutByte(s[i]);
+}
+
+static void mqttSendPacket(int typeByte) {
+	// Send the assembled packet body with the given fixed-header type byte.
+
+	uint8 header[5];
+	int n = 0;
+	header[n++] = typeByte;
+	int len = mqttOutCount;
+	do { // remaining length, as a base-128 varint
+		uint8 b = len & 0x7F;
+		len >>= 7;
+		if (len) b |= 0x80;
+		header[n++] = b;
+	} while (len);
+	mqttClient.write(header, n);
+	mqttClient.write(mqttOut, mqttOutCount);
+	mqttOutCount = 0;
+	mqttLastOutbound = millisecs();
+}
+
+static void mqttSendConnect() {
+	mqttOutCount = 0;
+	mqttOutString("MQTT", 4);
+	mqttOutByte(4); // protocol level 4 (MQTT 3.1.1)
+	int flags = 0x02; // clean session
+	if (mqttUser[0]) flags |= 0x80;
+	if (mqttPassword[0]) flags |= 0x40;
+	mqttOutByte(flags);
+	mqttOutByte((MQTT_KEEPALIVE_SECS >> 8) & 255);
+	mqttOutByte(MQTT_KEEPALIVE_SECS & 255);
+	mqttOutString(mqttClientId, strlen(mqttClientId));
+	if (mqttUser[0]) mqttOutString(mqttUser, strlen(mqttUser));
+	if (mqttPassword[0]) mqttOutString(mqttPassword, strlen(mqttPassword));
+	mqttSendPacket(0x10); // CONNECT
+	mqttState = MQTT_CONNECTING;
+	mqttInType = -1; // reset the inbound packet parser
+}
+
+static void mqttSendSubscribe(const char *topicFilter) {
+	if (++mqttPacketId > 0xFFFF) mqttPacketId = 1; // packet id must be nonzero
+	mqttOutCount = 0;
+	mqttOutByte((mqttPacketId >> 8) & 255);
+	mqttOutByte(mqttPacketId & 255);
+	mqttOutString(topicFilter, strlen(topicFilter));
+	mqttOutByte(0); // requested QoS 0
+	mqttSendPacket(0x82); // SUBSCRIBE
+}
+
+static int mqttOpenConnection() {
+	// Open a TCP connection to the broker and send a CONNECT packet.
+
+	int ok;
+	#ifdef ARDUINO_ARCH_ESP32
+		ok = mqttClient.connect(mqttHost, mqttPort, 500);
+	#else
+		mqttClient.setTimeout(500);
+		ok = mqttClient.connect(mqttHost, mqttPort);
+	#endif
+	if (!ok) return false;
+	mqttSendConnect();
+	return true;
+}
+
+static void mqttConnectionLost() {
+	mqttClient.stop();
+	mqttState = MQTT_RECONNECT_WAIT;
+	mqttNextAttempt = millisecs() + mqttBackoffMSecs;
+	if (mqttBackoffMSecs < 30000) mqttBackoffMSecs = 2 * mqttBackoffMSecs;
+}
+
+static void mqttQueueMessage() {
+	// Queue the PUBLISH packet in mqttInBuf; called with a complete packet.
+
+	int qos = (mqttInType >> 1) & 3;
+	int i = 0;
+	if ((mqttInReceived < 2)) return;
+	int topicLen = (mqttInBuf[0] << 8) | mqttInBuf[1];
+	i = 2 + topicLen;
+	if (i > mqttInReceived) return; // malformed
+	if (qos) i += 2; // skip packet id (present only for QoS > 0)
+	if (i > mqttInReceived) return;
+
+	if (mqttQueueCount >= MQTT_QUEUE_SIZE) { // queue full; drop the oldest message
+		mqttQueueHead = (mqttQueueHead + 1) % MQTT_QUEUE_SIZE;
+		mqttQueueCount--;
+	}
+	MQTTMessage *msg = &mqttQueue[(mqttQueueHead + mqttQueueCount) % MQTT_QUEUE_SIZE];
+	if (topicLen > (MQTT_MAX_TOPIC - 1)) topicLen = MQTT_MAX_TOPIC - 1;
+	memcpy(msg->topic, &mqttInBuf[2], topicLen);
+	msg->topic[topicLen] = 0;
+	int payloadBytes = mqttInReceived - i;
+	if (payloadBytes > MQTT_MAX_PAYLOAD) payloadBytes = MQTT_MAX_PAYLOAD;
+	memcpy(msg->payload, &mqttInBuf[i], payloadBytes);
+	msg->payloadBytes = payloadBytes;
+	mqttQueueCount++;
+}
+
+static void mqttProcessPacket() {
+	int packetType = mqttInType & 0xF0;
+	if (0x20 == packetType) { // CONNACK
+		if ((mqttInReceived >= 2) && (0 == mqttInBuf[1])) { // connection accepted
+			mqttState = MQTT_CONNECTED;
+			mqttBackoffMSecs = 1000;
+			for (int i = 0; i < mqttSubscriptionCount; i++) { // restore subscriptions
+				mqttSendSubscribe(mqttSubscriptions[i]);
+			}
+		} else {
+			mqttConnectionLost();
+		}
+	} else if (0x30 == (packetType & 0xF0) && (0x30 == (mqttInType & 0xF0))) { // PUBLISH
+		mqttQueueMessage();
+	}
+	// SUBACK (0x90) and PINGRESP (0xD0) need no action
+}
+
+void netService() {} // socket readiness polling is only needed on Linux/Pi
+
+static void mqttServiceStep() {
+	// Handle reconnection, parse inbound packets, and send keepalive pings.
+	// Called from the core 0 network task on ESP32, from mqttService elsewhere.
+
+	if (MQTT_IDLE == mqttState) return;
+
+	if (MQTT_RECONNECT_WAIT == mqttState) {
+		if (isConnectedToWiFi() && (millisecs() >= mqttNextAttempt)) {
+			if (!mqttOpenConnection()) mqttConnectionLost(); // try again later
+		}
+		return;
+	}
+
+	if (!mqttClient.connected() && !mqttClient.available()) {
+		mqttConnectionLost();
+		return;
+	}
+
+	// parse inbound bytes incrementally; a packet may arrive over multiple calls
+	while (mqttClient.available()) {
+		int ch = mqttClient.read();
+		if (mqttInType < 0) { // fixed header byte
+			mqttInType = ch;
+			mqttInLength = 0;
+			mqttInLengthShift = 0;
+			mqttInLengthDone = false;
+			mqttInReceived = 0;
+		} else if (!mqttInLengthDone) { // remaining length varint
+			mqttInLength |= (ch & 0x7F) << mqttInLengthShift;
+			mqttInLengthShift += 7;
+			mqttInLengthDone = !(ch & 0x80);
+		} else {
+			if (mqttInReceived < MQTT_IN_BUF) mqttInBuf[mqttInReceived] = ch;
+			mqttInReceived++;
+		}
+		if (mqttInLengthDone && (mqttInReceived >= mqttInLength)) { // packet complete
+			if (mqttInReceived > MQTT_IN_BUF) mqttInReceived = MQTT_IN_BUF; // oversize; truncated
+			mqttProcessPacket();
+			mqttInType = -1;
+		}
+	}
+
+	// keepalive: ping after half the keepalive interval with no outbound traffic
+	if ((MQTT_CONNECTED == mqttState) &&
+		((millisecs() - mqttLastOutbound) > (1000 * MQTT_KEEPALIVE_SECS / 2))) {
+			mqttOutCount = 0;
+			mqttSendPacket(0xC0); // PINGREQ
+	}
+}
+
+void mqttService() {
+	// Called from the VM loop.
+
+	#if defined(ARDUINO_ARCH_ESP32)
+		if (netTaskHandle) return; // the core 0 network task services MQTT
+	#endif
+	mqttServiceStep();
+}
+
+static void copyStringArg(OBJ arg, char *dst, int dstSize) {
+	dst[0] = 0;
+	if (IS_TYPE(arg, StringType)) {
+		strncat(dst, obj2str(arg), dstSize - 1);
+	}
+}
+
+static OBJ primMqttConnect(int argCount, OBJ *args) {
+	// Connect to an MQTT broker: <host> [client id] [port] [username] [password].
+	// The connection completes asynchronously; use mqttIsConnected to check it.
+
+	if (argCount < 1) return fail(notEnoughArguments);
+	if (!IS_TYPE(args[0], StringType)) return fail(needsStringError);
+
+	copyStringArg(args[0], mqttHost, sizeof(mqttHost));
+	copyStringArg((argCount > 1) ? args[1] : falseObj, mqttClientId, sizeof(mqttClientId));
+	if (!mqttClientId[0]) strcat(mqttClientId, "MicroBlocks");
+	mqttPort = ((argCount > 2) && isInt(args[2])) ? obj2int(args[2]) : 1883;
+	copyStringArg((argCount > 3) ? args[3] : falseObj, mqttUser, sizeof(mqttUser));
+	copyStringArg((argCount > 4) ? args[4] : falseObj, mqttPassword, sizeof(mqttPassword));
+
+	netLock();
+	mqttClient.stop();
+	mqttSubscriptionCount = 0;
+	mqttQueueCount = 0;
+	mqttBackoffMSecs = 1000;
+	if (!mqttOpenConnection()) mqttConnectionLost(); // retry from the service step
+	netUnlock();
+	startNetTask();
+	return falseObj;
+}
+
+static OBJ primMqttDisconnect(int argCount, OBJ *args) {
+	netLock();
+	if (MQTT_CONNECTED == mqttState) {
+		mqttOutCount = 0;
+		mqttSendPacket(0xE0); // DISCONNECT
+	}
+	mqttClient.stop();
+	mqttState = MQTT_IDLE;
+	netUnlock();
+	return falseObj;
+}
+
+static OBJ primMqttIsConnected(int argCount, OBJ *args) {
+	return (MQTT_CONNECTED == mqttState) ? trueObj : falseObj;
+}
+
+static OBJ primMqttPublish(int argCount, OBJ *args) {
+	// Publish <topic> <payload> [retain flag] with QoS 0. The payload may be a
+	// string, byte array, integer, or boolean.
+
+	if (argCount < 2) return fail(notEnoughArguments);
+	if (!IS_TYPE(args[0], StringType)) return fail(needsStringError);
+	if (MQTT_CONNECTED != mqttState) return falseObj;
+
+	char *topic = obj2str(args[0]);
+	char numBuf[20];
+	uint8 *payload = (uint8 *) "";
+	int payloadBytes = 0;
+	OBJ arg = args[1];
+	if (IS_TYPE(arg, StringType)) {
+		payload = (uint8 *) obj2str(arg);
+		payloadBytes = strlen((char *) payload);
+	} else if (IS_TYPE(arg, ByteArrayType)) {
+		payload = (uint8 *) &FIELD(arg, 0);
+		payloadBytes = BYTES(arg);
+	} else if (isInt(arg) || isBoolean(arg)) {
+		// note: intToStr not used here; this file must also build for WiFi101 boards
+		if (isInt(arg)) sprintf(numBuf, "%d", obj2int(arg));
+		else strcpy(numBuf, (trueObj == arg) ? "true" : "false");
+		payload = (uint8 *) numBuf;
+		payloadBytes = strlen(numBuf);
+	}
+
+	if ((2 + (int) strlen(topic) + payloadBytes) > MQTT_OUT_BUF) return fail(needsIndexable); // too large
+	int retain = ((argCount > 2) && (trueObj == args[2]));
+	netLock();
+	mqttOutCount = 0;
+	mqttOutString(topic, strlen(topic));
+	for (int i = 0; i < payloadBytes; i++) mqttOutByte(payload[i]);
+	mqttSendPacket(0x30 | (retain ? 1 : 0)); // PUBLISH, QoS 0
+	netUnlock();
+	return trueObj;
+}
+
+static OBJ primMqttSubscribe(int argCount, OBJ *args) {
+	// Subscribe to a topic filter; messages arrive via mqttLastEvent.
+
+	if (argCount < 1) return fail(notEnoughArguments);
+	if (!IS_TYPE(args[0], StringType)) return fail(needsStringError);
+	char *topicFilter = obj2str(args[0]);
+
+	int known = false;
+	for (int i = 0; i < mqttSubscriptionCount; i++) {
+		if (0 == strcmp(mqttSubscriptions[i], topicFilter)) known = true;
+	}
+	if (!known && (mqttSubscriptionCount >= MQTT_MAX_SUBSCRIPTIONS)) return fail(needsIndexable);
+	netLock();
+	if (!known) {
+		mqttSubscriptions[mqttSubscriptionCount][0] = 0;
+		strncat(mqttSubscriptions[mqttSubscriptionCount], topicFilter, MQTT_MAX_TOPIC - 1);
+		mqttSubscriptionCount++;
+	}
+	if (MQTT_CONNECTED == mqttState) mqttSendSubscribe(topicFilter);
+	netUnlock();
+	return falseObj;
+}
+
+static OBJ primMqttLastEvent(int argCount, OBJ *args) {
+	// Return the next queued message as a two-item list <topic, payload>, or
+	// false if the queue is empty. If the optional argument is true, the
+	// payload is returned as a byte array rather than a string.
+
+	if (!mqttQueueCount) return falseObj;
+	int useBinary = ((argCount > 0) && (trueObj == args[0]));
+
+	// copy the message out under the lock so the core 0 task can reuse the
+	// queue slot while this primitive allocates the result objects
+	static MQTTMessage msg;
+	netLock();
+	if (!mqttQueueCount) { netUnlock(); return falseObj; }
+	msg = mqttQueue[mqttQueueHead];
+	mqttQueueHead = (mqttQueueHead + 1) % MQTT_QUEUE_SIZE;
+	mqttQueueCount--;
+	netUnlock();
+
+	OBJ event = newObj(ListType, 3, zeroObj);
+	if (!event) return falseObj; // allocation failed
+	FIELD(event, 0) = int2obj(2);
+	FIELD(event, 1) = newStringFromBytes(msg.topic, strlen(msg.topic));
+	if (useBinary) {
+		OBJ payload = newObj(ByteArrayType, (msg.payloadBytes + 3) / 4, falseObj);
+		if (payload) {
+			setByteCountAdjust(payload, msg.payloadBytes);
+			memcpy(&FIELD(payload, 0), msg.payload, msg.payloadBytes);
+		}
+		FIELD(event, 2) = payload;
+	} else {
+		FIELD(event, 2) = newStringFromBytes((char *) msg.payload, msg.payloadBytes);
+	}
+	return event;
+}
+
 #ifdef ARDUINO_ARCH_ESP32
 // Websocket support for ESP32
 
@@ -440,29 +1208,43 @@ void webSocketEventCallback(uint8_t client_id, WStype_t type, uint8_t * payload,
 static OBJ primWebSocketStart(int argCount, OBJ *args) {
 	webSocket.begin();
 	webSocket.onEvent(webSocketEventCallback);
+	websocketStarted = true;
+	startNetTask(); // webSocket.loop() runs on the core 0 network task
 	return falseObj;
 }
 
 static OBJ primWebSocketLastEvent(int argCount, OBJ *args) {
-	webSocket.loop();
-	if (lastWebSocketType > -1) {
-		OBJ event = newObj(ListType, 4, zeroObj);
-		FIELD(event, 0) = int2obj(3);
-		FIELD(event, 1) = int2obj(lastWebSocketType);
-		FIELD(event, 2) = int2obj(lastWebSocketClientId);
-		FIELD(event, 3) = newStringFromBytes(lastWebSocketPayload, strlen(lastWebSocketPayload));
-		lastWebSocketType = -1;
-		return event;
-	} else {
+	if (!netTaskHandle) webSocket.loop(); // serviced by the core 0 task once started
+
+	// copy the event out under the lock; the callback runs on core 0
+	static char payloadCopy[1000];
+	netLock();
+	if (lastWebSocketType < 0) {
+		netUnlock();
 		return falseObj;
 	}
+	int eventType = lastWebSocketType;
+	int clientId = lastWebSocketClientId;
+	strcpy(payloadCopy, lastWebSocketPayload);
+	lastWebSocketType = -1;
+	netUnlock();
+
+	OBJ event = newObj(ListType, 4, zeroObj);
+	if (!event) return falseObj; // allocation failed
+	FIELD(event, 0) = int2obj(3);
+	FIELD(event, 1) = int2obj(eventType);
+	FIELD(event, 2) = int2obj(clientId);
+	FIELD(event, 3) = newStringFromBytes(payloadCopy, strlen(payloadCopy));
+	return event;
 }
 
 static OBJ primWebSocketSendToClient(int argCount, OBJ *args) {
 	char *message = obj2str(args[0]);
 	int client = obj2int(args[1]);
 	int length = strlen(message);
+	netLock();
 	webSocket.sendTXT(client, message, length);
+	netUnlock();
 	return falseObj;
 }
 
@@ -484,6 +1266,23 @@ static OBJ primHttpConnect(int argCount, OBJ *args) { return fail(noWiFi); }
 static OBJ primHttpIsConnected(int argCount, OBJ *args) { return fail(noWiFi); }
 static OBJ primHttpRequest(int argCount, OBJ *args) { return fail(noWiFi); }
 static OBJ primHttpResponse(int argCount, OBJ *args) { return fail(noWiFi); }
+static OBJ primHttpStreamStart(int argCount, OBJ *args) { return fail(noWiFi); }
+static OBJ primHttpStreamData(int argCount, OBJ *args) { return fail(noWiFi); }
+static OBJ primHttpStreamHeaders(int argCount, OBJ *args) { return fail(noWiFi); }
+static OBJ primHttpStreamEnded(int argCount, OBJ *args) { return fail(noWiFi); }
+static OBJ primMqttConnect(int argCount, OBJ *args) { return fail(noWiFi); }
+static OBJ primMqttDisconnect(int argCount, OBJ *args) { return fail(noWiFi); }
+static OBJ primMqttIsConnected(int argCount, OBJ *args) { return fail(noWiFi); }
+static OBJ primMqttPublish(int argCount, OBJ *args) { return fail(noWiFi); }
+static OBJ primMqttSubscribe(int argCount, OBJ *args) { return fail(noWiFi); }
+static OBJ primMqttLastEvent(int argCount, OBJ *args) { return fail(noWiFi); }
+static OBJ primUDPStart(int argCount, OBJ *args) { return fail(noWiFi); }
+static OBJ primUDPStop(int argCount, OBJ *args) { return fail(noWiFi); }
+static OBJ primUDPSend(int argCount, OBJ *args) { return fail(noWiFi); }
+static OBJ primUDPReceive(int argCount, OBJ *args) { return fail(noWiFi); }
+static OBJ primUDPRemoteAddress(int argCount, OBJ *args) { return fail(noWiFi); }
+void mqttService() {}
+void netService() {}
 #endif
 #ifndef ARDUINO_ARCH_ESP32
 static OBJ primWebSocketStart(int argCount, OBJ *args) { return fail(noWiFi); }
@@ -506,6 +1305,21 @@ static PrimEntry entries[] = {
 	{"httpIsConnected", primHttpIsConnected},
 	{"httpRequest", primHttpRequest},
 	{"httpResponse", primHttpResponse},
+	{"httpStreamStart", primHttpStreamStart},
+	{"httpStreamData", primHttpStreamData},
+	{"httpStreamHeaders", primHttpStreamHeaders},
+	{"httpStreamEnded", primHttpStreamEnded},
+	{"mqttConnect", primMqttConnect},
+	{"mqttDisconnect", primMqttDisconnect},
+	{"mqttIsConnected", primMqttIsConnected},
+	{"mqttPublish", primMqttPublish},
+	{"mqttSubscribe", primMqttSubscribe},
+	{"mqttLastEvent", primMqttLastEvent},
+	{"udpStart", primUDPStart},
+	{"udpStop", primUDPStop},
+	{"udpSend", primUDPSend},
+	{"udpReceive", primUDPReceive},
+	{"udpRemoteAddress", primUDPRemoteAddress},
 	{"webSocketStart", primWebSocketStart},
 	{"webSocketLastEvent", primWebSocketLastEvent},
 	{"webSocketSendToClient", primWebSocketSendToClient},
@@ -495,6 +495,7 @@ inline void restoreIRQState(uint32 pmask) {
 
 static int neoPixelBits = 24;
 static int neoPixelPinMask = 0;
+static int neoPixelHwPin = -1; // hardware pin number, used by DMA output paths
 static volatile int *neoPixelPinSet = NULL;
 static volatile int *neoPixelPinClr = NULL;
 
@@ -521,6 +522,9 @@ static void initNeoPixelPin(int pinNum) {
 		neoPixelPinMask = digitalPinToBitMask(pinNum);
 	#else
 		neoPixelPinMask = 1 << g_ADigitalPinMap[pinNum];
+		#if defined(NRF52)
+			neoPixelHwPin = g_ADigitalPinMap[pinNum]; // for DMA output (see showNeoPixelFrame)
+		#endif
 	#endif
 	neoPixelPinSet = (int *) GPIO_SET;
 	neoPixelPinClr = (int *) GPIO_CLR;
@@ -654,9 +658,11 @@ static void initNeoPixelPin(int pinNum) {
 		// must use a pin between 0-31
 		setPinMode(pinNum, OUTPUT);
 		neoPixelPinMask = 1 << pinNum;
+		neoPixelHwPin = pinNum; // for RMT DMA output (see showNeoPixelFrame)
 		GPIO.out_w1tc = neoPixelPinMask;
 	} else {
 		neoPixelPinMask = 0;
+		neoPixelHwPin = -1;
 	}
 }
 
@@ -707,6 +713,179 @@ static const int whiteTable[64] = {
 	35, 38, 41, 44, 47, 50, 54, 58, 62, 66, 70, 75, 80, 85, 90, 97, 104, 111, 118, 125, 132,
 	139, 146, 153, 160, 167, 174, 181, 188, 195, 202, 209, 216, 223, 230, 237, 244, 251, 255};
 
+static int encodeNeoPixel(int rgb) {
+	// Convert a 24-bit RGB(W) color to gamma-corrected NeoPixel wire format
+	// (GRB order; white appended as the final byte of four in 32-bit mode).
+
+	int r = gamma((rgb >> 16) & 0xFF);
+	int g = gamma((rgb >> 8) & 0xFF);
+	int b = gamma(rgb & 0xFF);
+	int val = (g << 16) | (r << 8) | b; // NeoPixel order is GRB
+	if (32 == neoPixelBits) { // send white as the final byte of four
+		val = (val << 8) | whiteTable[(rgb >> 24) & 0x3F];
+	}
+	return val;
+}
+
+// NeoPixel Frame Buffer
+// Bit-banged output masks interrupts for the whole strip, so a long strip
+// stalls tasks and serial I/O for milliseconds per frame. With the frame
+// buffer, scripts mutate pixels in RAM and then push the whole frame with one
+// show operation. On nRF52 the frame is shifted out by the PWM peripheral via
+// EasyDMA and on ESP32 by the RMT peripheral, without masking interrupts;
+// other boards fall back to a single bit-banged burst per show.
+
+#if defined(NRF52) || defined(ARDUINO_ARCH_ESP32)
+	#define NEO_FRAME_MAX_PIXELS 144
+#else
+	#define NEO_FRAME_MAX_PIXELS 64 // smaller buffer on RAM-constrained boards
+#endif
+
+static uint32 neoFrame[NEO_FRAME_MAX_PIXELS]; // pixels in wire format
+static int neoFrameCount = 0;
+
+#if defined(NRF52)
+
+// One 16-bit PWM compare value per bit, plus a trailing always-low entry.
+// COUNTERTOP 20 at 16 MHz gives the 1.25 usec NeoPixel bit period.
+static uint16 neoPwmSeq[(32 * NEO_FRAME_MAX_PIXELS) + 1];
+
+static void showNeoPixelFrame() {
+	if (neoPixelHwPin < 0) return;
+
+	int n = 0;
+	for (int i = 0; i < neoFrameCount; i++) {
+		uint32 val = neoFrame[i];
+		for (uint32 mask = (1 << (neoPixelBits - 1)); mask > 0; mask >>= 1) {
+			// compare values: ~810 nsec high for a one, ~375 nsec for a zero
+			neoPwmSeq[n++] = 0x8000 | ((val & mask) ? 13 : 6);
+		}
+	}
+	neoPwmSeq[n++] = 0x8000; // leave the line low after the last bit
+
+	NRF_PWM2->TASKS_STOP = 1; // abandon any show still in progress
+	NRF_PWM2->PSEL.OUT[0] = neoPixelHwPin;
+	NRF_PWM2->PSEL.OUT[1] = 0xFFFFFFFF; // disconnected
+	NRF_PWM2->PSEL.OUT[2] = 0xFFFFFFFF;
+	NRF_PWM2->PSEL.OUT[3] = 0xFFFFFFFF;
+	NRF_PWM2->ENABLE = 1;
+	NRF_PWM2->MODE = 0; // count up
+	NRF_PWM2->PRESCALER = 0; // 16 MHz
+	NRF_PWM2->COUNTERTOP = 20; // 1.25 usecs per bit
+	NRF_PWM2->LOOP = 0;
+	NRF_PWM2->DECODER = 0; // common compare value, refresh count mode
+	NRF_PWM2->SEQ[0].PTR = (uint32_t) neoPwmSeq;
+	NRF_PWM2->SEQ[0].CNT = n;
+	NRF_PWM2->SEQ[0].REFRESH = 0;
+	NRF_PWM2->SEQ[0].ENDDELAY = 0;
+	NRF_PWM2->EVENTS_SEQEND[0] = 0;
+	NRF_PWM2->TASKS_SEQSTART[0] = 1;
+	// the frame is now clocked out by EasyDMA; the VM continues immediately
+}
+
+#elif defined(ARDUINO_ARCH_ESP32)
+
+#include "driver/rmt.h"
+
+#define NEO_RMT_CHANNEL RMT_CHANNEL_1 // channel 0 is left free for other uses
+
+static uint8 neoRmtBytes[4 * NEO_FRAME_MAX_PIXELS]; // frame in wire byte order
+static int neoRmtPin = -1; // pin the RMT channel is configured for
+
+// RMT tick is 25 nsecs (80 MHz / 2)
+static const rmt_item32_t neoRmtZero = {{{ 14, 1, 32, 0 }}}; // 350/800 nsecs
+static const rmt_item32_t neoRmtOne = {{{ 28, 1, 12, 0 }}}; // 700/300 nsecs
+
+static void IRAM_ATTR neoRmtTranslate(const void *src, rmt_item32_t *dest,
+	size_t src_size, size_t wanted_num, size_t *translated_size, size_t *item_num) {
+	// Convert frame bytes into RMT items on the fly as the peripheral drains its FIFO.
+
+	size_t bytesUsed = 0, itemsFilled = 0;
+	const uint8_t *bytes = (const uint8_t *) src;
+	while ((bytesUsed < src_size) && ((itemsFilled + 8) <= wanted_num)) {
+		for (int mask = 0x80; mask > 0; mask >>= 1) {
+			dest[itemsFilled++] = (bytes[bytesUsed] & mask) ? neoRmtOne : neoRmtZero;
+		}
+		bytesUsed++;
+	}
+	*translated_size = bytesUsed;
+	*item_num = itemsFilled;
+}
+
+static void showNeoPixelFrame() {
+	if (neoPixelHwPin < 0) return;
+
+	if (neoRmtPin != neoPixelHwPin) { // (re)configure the RMT channel for this pin
+		rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t) neoPixelHwPin, NEO_RMT_CHANNEL);
+		config.clk_div = 2; // 40 MHz; 25 nsecs per tick
+		rmt_config(&config);
+		rmt_driver_install(NEO_RMT_CHANNEL, 0, 0);
+		rmt_translator_init(NEO_RMT_CHANNEL, neoRmtTranslate);
+		neoRmtPin = neoPixelHwPin;
+	}
+
+	int byteCount = 0;
+	for (int i = 0; i < neoFrameCount; i++) {
+		uint32 val = neoFrame[i];
+		for (int shift = neoPixelBits - 8; shift >= 0; shift -= 8) {
+			neoRmtBytes[byteCount++] = (val >> shift) & 0xFF;
+		}
+	}
+	if (!byteCount) return;
+	rmt_wait_tx_done(NEO_RMT_CHANNEL, portMAX_DELAY); // wait for any previous show
+	rmt_write_sample(NEO_RMT_CHANNEL, neoRmtBytes, byteCount, false); // non-blocking
+}
+
+#else // no DMA output on this board; send the frame as one bit-banged burst
+
+static void showNeoPixelFrame() {
+	for (int i = 0; i < neoFrameCount; i++) sendNeoPixelData(neoFrame[i]);
+}
+
+#endif
+
+static OBJ primNeoPixelSetCount(int argCount, OBJ *args) {
+	// Set the number of pixels in the frame buffer (up to 144) and clear them.
+
+	if (argCount < 1) return fail(notEnoughArguments);
+	if (!isInt(args[0])) return fail(needsIntegerError);
+	int count = obj2int(args[0]);
+	if (count < 0) count = 0;
+	if (count > NEO_FRAME_MAX_PIXELS) count = NEO_FRAME_MAX_PIXELS;
+	neoFrameCount = count;
+	for (int i = 0; i < count; i++) neoFrame[i] = 0;
+	return falseObj;
+}
+
+static OBJ primNeoPixelSetPixel(int argCount, OBJ *args) {
+	// Set the color of the pixel at the given index (1-based) in the frame buffer.
+
+	if (argCount < 2) return fail(notEnoughArguments);
+	if (!isInt(args[0]) || !isInt(args[1])) return fail(needsIntegerError);
+	int i = obj2int(args[0]);
+	if ((i < 1) || (i > neoFrameCount)) return fail(indexOutOfRangeError);
+	neoFrame[i - 1] = encodeNeoPixel(obj2int(args[1]));
+	return falseObj;
+}
+
+static OBJ primNeoPixelFill(int argCount, OBJ *args) {
+	// Set every pixel in the frame buffer to the given color.
+
+	if (argCount < 1) return fail(notEnoughArguments);
+	if (!isInt(args[0])) return fail(needsIntegerError);
+	uint32 val = encodeNeoPixel(obj2int(args[0]));
+	for (int i = 0; i < neoFrameCount; i++) neoFrame[i] = val;
+	return falseObj;
+}
+
+static OBJ primNeoPixelShow(int argCount, OBJ *args) {
+	// Push the whole frame buffer to the strip.
+
+	if (!neoPixelPinMask) initNeoPixelPin(-1); // if pin not set, use the internal NeoPixel pin
+	showNeoPixelFrame();
+	return falseObj;
+}
+
 OBJ primNeoPixelSend(int argCount, OBJ *args) {
 	if (!neoPixelPinMask) initNeoPixelPin(-1); // if pin not set, use the internal NeoPixel pin
 
@@ -715,29 +894,13 @@ OBJ primNeoPixelSend(int argCount, OBJ *args) {
 	#endif
 	OBJ arg = args[0];
 	if (isInt(arg)) {
-		int rgb = obj2int(arg);
-		int r = gamma((rgb >> 16) & 0xFF);
-		int g = gamma((rgb >> 8) & 0xFF);
-		int b = gamma(rgb & 0xFF);
-		int val = (g << 16) | (r << 8) | b; // NeoPixel order is GRB
-		if (32 == neoPixelBits) { // send white as the final byte of four
-			val = (val << 8) | whiteTable[(rgb >> 24) & 0x3F];
-		}
-		sendNeoPixelData(val);
+		sendNeoPixelData(encodeNeoPixel(obj2int(arg)));
 	} else if (IS_TYPE(arg, ListType)) {
 		int count = obj2int(FIELD(arg, 0));
 		for (int i = 0; i < count; i++) {
 			OBJ item = FIELD(arg, i + 1);
 			if (isInt(item)) {
-				int rgb = obj2int(item);
-				int r = gamma((rgb >> 16) & 0xFF);
-				int g = gamma((rgb >> 8) & 0xFF);
-				int b = gamma(rgb & 0xFF);
-				int val = (g << 16) | (r << 8) | b; // NeoPixel order is GRB
-				if (32 == neoPixelBits) { // send white as the final byte of four
-					val = (val << 8) | whiteTable[(rgb >> 24) & 0x3F];
-				}
-				sendNeoPixelData(val);
+				sendNeoPixelData(encodeNeoPixel(obj2int(item)));
 			}
 		}
 	}
@@ -869,6 +1032,94 @@ OBJ primMBDrawShape(int argCount, OBJ *args) {
 	return falseObj;
 }
 
+// Scrolling Text
+
+// Scrolling from the IDE-level library redraws the display shape by shape,
+// which takes several primitive calls per scroll step and starves sensor
+// loops on the micro:bit v1. Instead, render the whole message once into a
+// wide off-screen column bitmap (one byte per column, five bits per byte),
+// then advance and redraw the display with a single primitive call per step.
+
+#if defined(NRF51)
+	#define SCROLL_MAX_COLUMNS 192 // 32 characters; RAM is tight on the micro:bit v1
+#else
+	#define SCROLL_MAX_COLUMNS 512
+#endif
+
+static uint8 scrollBitmap[SCROLL_MAX_COLUMNS];
+static int scrollColumnCount = 0;
+static int scrollOffset = 0;
+
+static void scrollAppendColumn(uint8 colBits) {
+	if (scrollColumnCount < SCROLL_MAX_COLUMNS) {
+		scrollBitmap[scrollColumnCount++] = colBits & 0x1F;
+	}
+}
+
+static void scrollAppendLetter(int ascii) {
+	// Append the 5x5 font glyph for the given character plus one blank spacing column.
+
+	if ((ascii < 32) || (ascii > 126)) return;
+	int firstRow = 5 * (ascii - 32);
+	for (int col = 0; col < 5; col++) {
+		uint8 colBits = 0;
+		for (int row = 0; row < 5; row++) {
+			if (pendolino3[firstRow + row] & (0x10 >> col)) colBits |= (1 << row);
+		}
+		scrollAppendColumn(colBits);
+	}
+	scrollAppendColumn(0); // inter-character spacing
+}
+
+OBJ primMBScrollInit(int argCount, OBJ *args) {
+	// Render the argument into the scroll bitmap: a string or integer is rendered
+	// with the micro:bit font; a byte array is copied directly, one byte per
+	// column with the top LED in the least significant bit. Text longer than the
+	// bitmap is truncated.
+
+	OBJ arg = (argCount > 0) ? args[0] : falseObj;
+	scrollColumnCount = 0;
+	scrollOffset = -5; // first step brings the first column in from the right edge
+
+	if (IS_TYPE(arg, StringType)) {
+		char *s = obj2str(arg);
+		while (*s) scrollAppendLetter((uint8) *s++);
+	} else if (IS_TYPE(arg, ByteArrayType)) {
+		uint8 *bytes = (uint8 *) &FIELD(arg, 0);
+		int count = BYTES(arg);
+		for (int i = 0; i < count; i++) scrollAppendColumn(bytes[i]);
+	} else if (isInt(arg)) {
+		char s[16];
+		sprintf(s, "%d", obj2int(arg));
+		for (char *p = s; *p; p++) scrollAppendLetter((uint8) *p);
+	} else {
+		return fail(needsStringError);
+	}
+	return falseObj;
+}
+
+OBJ primMBScrollStep(int argCount, OBJ *args) {
+	// Shift the scroll window by the given number of columns (default 1) and
+	// redraw the display. Return true if there is more to scroll, false once
+	// the message has scrolled off the left edge, so a script can loop on the
+	// result with one task wakeup per step.
+
+	int delta = (argCount > 0) ? evalInt(args[0]) : 1;
+	scrollOffset += delta;
+	int bits = 0;
+	for (int x = 0; x < 5; x++) {
+		int col = scrollOffset + x;
+		if ((col < 0) || (col >= scrollColumnCount)) continue;
+		int colBits = scrollBitmap[col];
+		for (int y = 0; y < 5; y++) {
+			if (colBits & (1 << y)) bits |= (1 << ((5 * y) + x));
+		}
+	}
+	microBitDisplayBits = bits;
+	if (useTFT) tftSetHugePixelBits(bits);
+	return (scrollOffset < scrollColumnCount) ? trueObj : falseObj;
+}
+
 // Primitives
 
 static PrimEntry entries[] = {
@@ -879,8 +1130,14 @@ static PrimEntry entries[] = {
 	{"mbUnplot", primMBUnplot},
 	{"mbDrawShape", primMBDrawShape},
 	{"mbShapeForLetter", primMBShapeForLetter},
+	{"mbScrollInit", primMBScrollInit},
+	{"mbScrollStep", primMBScrollStep},
 	{"neoPixelSend", primNeoPixelSend},
 	{"neoPixelSetPin", primNeoPixelSetPin},
+	{"neoPixelSetCount", primNeoPixelSetCount},
+	{"neoPixelSetPixel", primNeoPixelSetPixel},
+	{"neoPixelFill", primNeoPixelFill},
+	{"neoPixelShow", primNeoPixelShow},
 };
 
 void addDisplayPrims() {
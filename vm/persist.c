@@ -452,6 +452,60 @@ static void setCycleCount(int halfSpace, int cycleCount) {
 	flashWriteWord(p, ('S' << 24) | (cycleCount & 0xFFFFFF));
 }
 
+#ifndef RAM_CODE_STORE
+
+// Segmented Erasing
+//
+// The destination half-space used to be erased in full before each compaction, so
+// every compaction cycled every sector of the destination even when the store held
+// only a little data. Each half-space is now treated as a sequence of 4 KB erase
+// segments that are erased lazily, just before data reaches them. A compaction
+// erases only the segments it actually fills, and sectors beyond the store's
+// high-water mark are never cycled at all, so Flash wear is proportional to the
+// amount of code stored rather than to the reserved space.
+
+#define ERASE_SEGMENT_WORDS 1024 // 4 KB; a multiple of every supported page size
+#define INDEX_RESERVED_WORDS (MAX_CHUNKS + 2) // tail words reserved for the chunk index
+
+static int *erasedEnds[2]; // end of the contiguously erased region of each half-space
+static char indexSegErased[2]; // true if the final (index) segment was erased separately
+
+static void beginErasing(int halfSpace) {
+	// Reset the erased region of the given half-space (called when it becomes the
+	// destination of a compaction; its old contents are dead from that point on).
+
+	erasedEnds[halfSpace] = (0 == halfSpace) ? start0 : start1;
+	indexSegErased[halfSpace] = false;
+}
+
+static void ensureErased(int halfSpace, int *upTo) {
+	// Extend the contiguously erased region of the given half-space to at least upTo.
+
+	int *end = (0 == halfSpace) ? end0 : end1;
+	if (upTo > end) upTo = end;
+	while (erasedEnds[halfSpace] < upTo) {
+		int *segEnd = erasedEnds[halfSpace] + ERASE_SEGMENT_WORDS;
+		if (segEnd > end) segEnd = end;
+		if (!((segEnd == end) && indexSegErased[halfSpace])) { // skip if already erased
+			flashErase(erasedEnds[halfSpace], segEnd);
+		}
+		erasedEnds[halfSpace] = segEnd;
+	}
+}
+
+static void eraseIndexSegment(int halfSpace) {
+	// Erase the final segment of the given half-space, which holds the chunk index,
+	// unless the contiguously erased region has already reached it.
+
+	int *end = (0 == halfSpace) ? end0 : end1;
+	if (!indexSegErased[halfSpace] && (erasedEnds[halfSpace] < end)) {
+		flashErase(end - ERASE_SEGMENT_WORDS, end);
+	}
+	indexSegErased[halfSpace] = true;
+}
+
+#endif // Segmented Erasing
+
 static void initPersistentMemory() {
 	// Figure out which is the current half-space and find freeStart.
 	// If neither half-space has a valid cycle counter, initialize persistent memory.
@@ -472,6 +526,11 @@ static void initPersistentMemory() {
 		setCycleCount(0, 1);
 		current = 0;
 		freeStart = start0 + 1;
+		#ifndef RAM_CODE_STORE
+			erasedEnds[0] = end0;
+			erasedEnds[1] = end1;
+			indexSegErased[0] = indexSegErased[1] = true;
+		#endif
 		return;
 	}
 
@@ -486,6 +545,9 @@ static void initPersistentMemory() {
 		end = end1;
 	}
 
+	#ifndef RAM_CODE_STORE
+		end -= INDEX_RESERVED_WORDS; // records never extend into the chunk index area
+	#endif
 	while ((freeStart < end) && (-1 != *freeStart)) {
 		int header = *freeStart;
 		if ('R' != ((header >> 24) & 0xFF)) {
@@ -496,6 +558,17 @@ static void initPersistentMemory() {
 		freeStart += *(freeStart + 1) + 2; // increment by the record length plus 2-word header
 	}
 	if (freeStart >= end) freeStart = end;
+
+	#ifndef RAM_CODE_STORE
+		// The rest of the segment holding freeStart was erased when it came into use;
+		// make no assumptions about anything beyond it (re-erasing once is harmless).
+		int *base = (0 == current) ? start0 : start1;
+		int segs = ((freeStart - base) + ERASE_SEGMENT_WORDS - 1) / ERASE_SEGMENT_WORDS;
+		erasedEnds[current] = base + (segs * ERASE_SEGMENT_WORDS);
+		if (erasedEnds[current] > ((0 == current) ? end0 : end1)) erasedEnds[current] = (0 == current) ? end0 : end1;
+		erasedEnds[!current] = (0 == !current) ? start0 : start1;
+		indexSegErased[0] = indexSegErased[1] = false;
+	#endif
 }
 
 int * recordAfter(int *lastRecord) {
@@ -609,6 +682,11 @@ static int * copyChunk(int *dst, int *src) {
 	// Copy the chunk record at src to dst and return the new value of dst.
 
 	int wordCount = *(src + 1) + 2;
+	#ifndef RAM_CODE_STORE
+		// Flash compaction always copies into the other half-space; erase segments
+		// just ahead of the data (the extra word keeps an erased scan terminator).
+		ensureErased(!current, dst + wordCount + 1);
+	#endif
 	flashWriteData(dst, wordCount, (uint8 *) src);
 	return dst + wordCount;
 }
@@ -691,6 +769,9 @@ static int * copyVarInfo(int id, int *src, int *dst) {
 	return dst;
 }
 
+static void writeChunkIndex(); // forward reference (see "Persistent Chunk Index" below)
+static void invalidateChunkIndex(); // forward reference
+
 static void compactFlash() {
 	// Copy only the most recent chunk and variable records to the other half-space.
 	// Details:
@@ -709,8 +790,9 @@ static void compactFlash() {
 	memset(chunkProcessed, 0, sizeof(chunkProcessed));
 	memset(varProcessed, 0, sizeof(varProcessed));
 
-	// clear the destination half-space and init dst pointer
-	clearHalfSpace(!current);
+	// begin erasing the destination half-space lazily and init dst pointer
+	beginErasing(!current);
+	ensureErased(!current, (((0 == !current) ? start0 : start1) + 2)); // cycle count word
 	int *dst = ((0 == !current) ? start0 : start1) + 1;
 
 	int *src = compactionStartRecord(NULL);
@@ -730,6 +812,7 @@ static void compactFlash() {
 	setCycleCount(!current, cycleCount(current) + 1); // this commits the compaction
 	current = !current;
 	freeStart = dst;
+	writeChunkIndex();
 
 	#if defined(NRF51) || defined(ARDUINO_BBC_MICROBIT_V2)
 		// Compaction messes up the serial port on the micro:bit v1 and v2 and Calliope
@@ -743,6 +826,171 @@ static void compactFlash() {
 	outputString(s);
 }
 
+// Background Flash Compaction
+//
+// Flash compaction copies every live record to the other half-space and erasing a
+// half-space takes tens of milliseconds per page, so a synchronous compaction can
+// freeze running tasks for a second or more on some boards. To avoid hitting that
+// pause when the store finally fills mid-session, compaction is also run
+// incrementally from the vmLoop background slot: once the current half-space is
+// three-quarters full, persistCompactionStep() erases the destination half-space a
+// few pages at a time, then copies a few records per cycle, and finally commits by
+// writing the new cycle-count header (the same single-word commit the synchronous
+// path uses). Appending any record invalidates an in-progress pass; it is simply
+// restarted later. The synchronous compactFlash() remains as the fallback when
+// space runs out before a background pass completes.
+
+#define COMPACT_IDLE 0
+#define COMPACT_COPYING 2
+
+#define COPY_RECORDS_PER_STEP 2
+
+static int bgCompactState = COMPACT_IDLE;
+static int *bgSrc; // next source record to examine
+static int *bgDst; // next free destination word
+
+void persistCompactionAbort() {
+	// Discard any in-progress background compaction (called when a record is
+	// appended, since that invalidates the snapshot being copied). The destination
+	// half-space is not committed until its cycle-count header is written, so an
+	// aborted pass leaves the store exactly as it was; the next pass starts over.
+
+	bgCompactState = COMPACT_IDLE;
+}
+
+void persistCompactionStep() {
+	// Do a bounded amount of background compaction work (called from vmLoop).
+
+	int *destStart = (0 == !current) ? start0 : start1;
+
+	switch (bgCompactState) {
+	case COMPACT_IDLE: {
+		int *end = (0 == current) ? end0 : end1;
+		if ((end - freeStart) > (HALF_SPACE / 16)) return; // over 1/4 free; nothing to do
+		memset(chunkProcessed, 0, sizeof(chunkProcessed));
+		memset(varProcessed, 0, sizeof(varProcessed));
+		// segments of the destination are erased lazily as records are copied
+		// (see copyChunk), so there is no separate erase phase
+		beginErasing(!current);
+		ensureErased(!current, destStart + 2); // cycle count word
+		bgSrc = compactionStartRecord();
+		bgDst = destStart + 1;
+		bgCompactState = COMPACT_COPYING;
+		break;
+	}
+	case COMPACT_COPYING: {
+		for (int i = 0; i < COPY_RECORDS_PER_STEP; i++) {
+			if (!bgSrc) break;
+			int header = *bgSrc;
+			int type = (header >> 16) & 0xFF;
+			int id = (header >> 8) & 0xFF;
+			if ((chunkCode <= type) && (type <= chunkDeleted)) {
+				bgDst = copyChunkInfo(id, bgSrc, bgDst);
+			} else if ((varName <= type) && (type <= varsClearAll)) {
+				bgDst = copyVarInfo(id, bgSrc, bgDst);
+			}
+			bgSrc = recordAfter(bgSrc);
+		}
+		if (!bgSrc) { // all records copied; commit and switch half-spaces
+			clearPrimCache();
+			setCycleCount(!current, cycleCount(current) + 1); // this commits the compaction
+			current = !current;
+			freeStart = bgDst;
+			writeChunkIndex();
+			bgCompactState = COMPACT_IDLE;
+
+			#if defined(NRF51) || defined(ARDUINO_BBC_MICROBIT_V2)
+				// Compaction messes up the serial port on the micro:bit v1 and v2 and Calliope
+				restartSerial();
+			#endif
+
+			char s[100];
+			int bytesUsed = 4 * (freeStart - ((0 == current) ? start0 : start1));
+			sprintf(s, "Compacted Flash code store in background\n%d bytes used (%d%%) of %d",
+				bytesUsed, (100 * bytesUsed) / HALF_SPACE, HALF_SPACE);
+			outputString(s);
+		}
+		break;
+	}
+	}
+}
+
+// Persistent Chunk Index
+//
+// After a compaction, the live chunkCode records are summarized in a small index
+// block written at the fixed, reserved tail of the half-space, so restoreScripts()
+// can rebuild chunks[] directly instead of scanning the entire record history.
+// Layout, starting at the last INDEX_RESERVED_WORDS words of the half-space:
+//	base[0]: <'X'><24-bit entry count> (written last; this word commits the index)
+//	base[1]: CRC-32 of the entry words
+//	base[2..]: one word per chunk: <chunk id><16-bit word offset of its chunkCode record>
+// Appending any record makes the index stale: its header word is overwritten with
+// zero (Flash allows 1->0 bit writes without an erase) and restoreScripts() falls
+// back to the full scan.
+
+static int * chunkIndexBase(int halfSpace) {
+	return ((0 == halfSpace) ? end0 : end1) - INDEX_RESERVED_WORDS;
+}
+
+static void invalidateChunkIndex() {
+	int *base = chunkIndexBase(current);
+	if ('X' == ((*base >> 24) & 0xFF)) flashWriteWord(base, 0);
+}
+
+static void writeChunkIndex() {
+	// Write a chunk index for the current (just compacted) half-space.
+
+	eraseIndexSegment(current); // the index segment is erased on demand
+	int *halfStart = (0 == current) ? start0 : start1;
+	int *base = chunkIndexBase(current);
+	int count = 0;
+	int *rec = recordAfter(NULL);
+	while (rec) {
+		if (chunkCode == ((*rec >> 16) & 0xFF)) {
+			if (count >= MAX_CHUNKS) return; // shouldn't happen; leave the index unwritten
+			flashWriteWord(base + 2 + count, (((*rec >> 8) & 0xFF) << 16) | (rec - halfStart));
+			count++;
+		}
+		rec = recordAfter(rec);
+	}
+	flashWriteWord(base + 1, (int) crc32((uint8 *) (base + 2), 4 * count));
+	flashWriteWord(base, ('X' << 24) | count); // commit the index
+}
+
+static int restoreScriptsFromIndex() {
+	// Rebuild chunks[] from the chunk index. Return false (leaving chunks[] empty)
+	// if there is no index or it fails validation, in which case the caller falls
+	// back to scanning the record history.
+
+	int *halfStart = (0 == current) ? start0 : start1;
+	int *base = chunkIndexBase(current);
+	int count = *base & 0xFFFFFF;
+	if (('X' != ((*base >> 24) & 0xFF)) || (count > MAX_CHUNKS)) return false;
+	if (((int) crc32((uint8 *) (base + 2), 4 * count)) != base[1]) return false;
+
+	// validate all entries before populating chunks[]
+	for (int i = 0; i < count; i++) {
+		int entry = base[2 + i];
+		int *rec = halfStart + (entry & 0xFFFF);
+		if ((rec < halfStart) || (rec >= base)) return false;
+		if (('R' != ((*rec >> 24) & 0xFF)) ||
+			(chunkCode != ((*rec >> 16) & 0xFF)) ||
+			(((entry >> 16) & 0xFF) != ((*rec >> 8) & 0xFF))) {
+				return false; // entry does not point at a matching chunkCode record
+		}
+	}
+	for (int i = 0; i < count; i++) {
+		int entry = base[2 + i];
+		int *rec = halfStart + (entry & 0xFFFF);
+		int chunkIndex = (entry >> 16) & 0xFF;
+		if (chunkIndex < MAX_CHUNKS) {
+			chunks[chunkIndex].chunkType = *rec & 0xFF;
+			chunks[chunkIndex].code = rec;
+		}
+	}
+	return true;
+}
+
 #endif // compactFlash
 
 // RAM compaction
@@ -763,6 +1011,17 @@ static int keepCodeChunk(int id, int header, int *start) {
 	return true;
 }
 
+void persistCompactionStep() {
+	// RAM code store compaction is fast, so there is no background compaction work,
+	// but on file-backed boards this slot is used to flush the code file's
+	// write-behind buffer (see persistFile.cpp).
+
+	#if USE_CODE_FILE && !defined(GNUBLOCKS)
+		codeFileService(millisecs());
+	#endif
+}
+void persistCompactionAbort() { }
+
 static void compactRAM() {
 	// Compact a RAM-based code store in place. In-place compaction is possible in RAM since,
 	// unlike Flash memory, RAM can be re-written without first erasing it. This approach
@@ -835,11 +1094,16 @@ static void compactRAM() {
 // entry points
 
 void clearPersistentMemory() {
+	persistCompactionAbort();
 	int c0 = cycleCount(0);
 	int c1 = cycleCount(1);
 	int count = (c0 > c1) ? c0 : c1;
 	current = !current;
 	clearHalfSpace(current);
+	#ifndef RAM_CODE_STORE
+		erasedEnds[current] = (0 == current) ? end0 : end1;
+		indexSegErased[current] = true;
+	#endif
 	freeStart = (0 == current) ? start0 + 1 : start1 + 1;
 	setCycleCount(current, count + 1);
 }
@@ -849,15 +1113,29 @@ int * appendPersistentRecord(int recordType, int id, int extra, int byteCount, u
 	// Header word: <tag = 'R'><record type><id of chunk/variable/comment><extra> (8-bits each)
 	// Perform a compaction if necessary.
 	int wordCount = (byteCount + 3) / 4;
+	persistCompactionAbort(); // a new record invalidates any in-progress background pass
+	#ifndef RAM_CODE_STORE
+		invalidateChunkIndex(); // a new record makes the boot-time chunk index stale
+	#endif
 	int *end = (0 == current) ? end0 : end1;
+	#ifndef RAM_CODE_STORE
+		end -= INDEX_RESERVED_WORDS; // the tail of each half-space holds the chunk index
+	#endif
 	if ((freeStart + 2 + wordCount) > end) {
 		compactCodeStore();
 		end = (0 == current) ? end0 : end1;
+		#ifndef RAM_CODE_STORE
+			end -= INDEX_RESERVED_WORDS;
+		#endif
 		if ((freeStart + 2 + wordCount) > end) {
 			outputString("Not enough room even after compaction");
 			return NULL;
 		}
 	}
+	#ifndef RAM_CODE_STORE
+		// erase segments on demand, keeping an erased word after the record as a scan terminator
+		ensureErased(current, freeStart + 2 + wordCount + 1);
+	#endif
 	// write the record
 	int header = ('R' << 24) | ((recordType & 0xFF) << 16) | ((id & 0xFF) << 8) | (extra & 0xFF);
 
@@ -887,6 +1165,8 @@ int * appendPersistentRecord(int recordType, int id, int extra, int byteCount, u
 }
 
 void compactCodeStore() {
+	persistCompactionAbort(); // the synchronous path supersedes any background pass
+	clearPrimCache(); // compaction moves chunk code, and with it primitive name literals
 	#ifdef RAM_CODE_STORE
 		compactRAM();
 	#else
@@ -902,7 +1182,12 @@ void restoreScripts() {
 		initCodeFile(flash, HALF_SPACE);
 	#endif
 
-	int *p = compactionStartRecord();
+	int restoredFromIndex = false;
+	#ifndef RAM_CODE_STORE
+		restoredFromIndex = restoreScriptsFromIndex();
+	#endif
+
+	int *p = restoredFromIndex ? NULL : compactionStartRecord();
 	while (p) {
 		int recType = (*p >> 16) & 0xFF;
 		if (chunkCode == recType) {
@@ -44,6 +44,8 @@ typedef enum {
 
 int * appendPersistentRecord(int recordType, int id, int extra, int byteCount, uint8 *data);
 void clearPersistentMemory();
+void persistCompactionStep();
+void persistCompactionAbort();
 int * recordAfter(int *lastRecord);
 void restoreScripts();
 int *scanStart();
@@ -54,6 +56,8 @@ void initCodeFile(uint8 *flash, int flashByteCount);
 void writeCodeFile(uint8 *code, int byteCount);
 void writeCodeFileWord(int word);
 void clearCodeFile(int cycleCount);
+void flushCodeFile(void);
+void codeFileService(uint32 now);
 
 #ifdef __cplusplus
 }
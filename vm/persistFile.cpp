@@ -7,9 +7,11 @@
 // persistFile.cpp - Persistent file/non-volatile storage operations
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "mem.h"
+#include "interp.h" // for millisecs()
 #include "persist.h"
 
 #if defined(ESP8266) || defined(ARDUINO_ARCH_ESP32)
@@ -19,13 +21,54 @@
 
 #define FILE_NAME "/ublockscode"
 
+// Write-behind buffer. Appends to the code file are coalesced in RAM and written
+// (and committed with a file close/reopen) in a single operation when the buffer
+// fills or flushCodeFile() is called, rather than paying file system overhead for
+// every word of every appended record. flushCodeFile() is called from the vmLoop
+// background slot once buffered data is FLUSH_MSECS old, and before anything that
+// must see the data on the file system.
+
+#define WRITE_BUF_SIZE 512
+#define FLUSH_MSECS 250
+
 static File codeFile;
+static uint8 writeBuf[WRITE_BUF_SIZE];
+static int writeBufCount = 0;
+static uint32 firstWriteTime = 0; // msec time of the oldest unflushed byte
 
 static void closeAndOpenCodeFile() {
 	if (codeFile) codeFile.close();
 	codeFile = myFS.open(FILE_NAME, "a");
 }
 
+extern "C" void flushCodeFile() {
+	// Write any buffered data to the code file and commit it.
+
+	if (!writeBufCount) return;
+	if (codeFile) codeFile.write(writeBuf, writeBufCount);
+	writeBufCount = 0;
+	closeAndOpenCodeFile(); // close/reopen to commit the data to the file system
+}
+
+extern "C" void codeFileService(uint32 now) {
+	// Flush the write-behind buffer once its oldest byte is FLUSH_MSECS old.
+
+	if (writeBufCount && ((now - firstWriteTime) >= FLUSH_MSECS)) flushCodeFile();
+}
+
+static void bufferedWrite(uint8 *data, int byteCount) {
+	if (byteCount > WRITE_BUF_SIZE) { // large write; flush, then write it directly
+		flushCodeFile();
+		if (codeFile) codeFile.write(data, byteCount);
+		closeAndOpenCodeFile();
+		return;
+	}
+	if ((writeBufCount + byteCount) > WRITE_BUF_SIZE) flushCodeFile();
+	if (!writeBufCount) firstWriteTime = millisecs();
+	memcpy(&writeBuf[writeBufCount], data, byteCount);
+	writeBufCount += byteCount;
+}
+
 extern "C" void initCodeFile(uint8 *flash, int flashByteCount) {
 	#ifdef ESP8266
 		myFS.begin();
@@ -33,25 +76,25 @@ extern "C" void initCodeFile(uint8 *flash, int flashByteCount) {
 		myFS.begin(true);
 	#endif
 	codeFile = myFS.open(FILE_NAME, "r");
-	// read code file into simulated Flash:
+	// read code file into simulated Flash in one bulk read:
 	if (codeFile) codeFile.readBytes((char*) flash, flashByteCount);
 	closeAndOpenCodeFile();
 }
 
 extern "C" void writeCodeFile(uint8 *code, int byteCount) {
-	if (codeFile) codeFile.write(code, byteCount);
-	closeAndOpenCodeFile();
+	bufferedWrite(code, byteCount);
 }
 
 extern "C" void writeCodeFileWord(int word) {
-	if (codeFile) codeFile.write((uint8 *) &word, 4);
+	bufferedWrite((uint8 *) &word, 4);
 }
 
 extern "C" void clearCodeFile(int cycleCount) {
+	writeBufCount = 0; // discard buffered appends; the file is being truncated
 	if (codeFile) codeFile.close();
 	codeFile = myFS.open(FILE_NAME, "w"); // truncate file to zero length
 	int headerWord = ('S' << 24) | cycleCount; // Header record, version 1
-	writeCodeFileWord(headerWord);
+	if (codeFile) codeFile.write((uint8 *) &headerWord, 4);
 	closeAndOpenCodeFile();
 }
 
@@ -30,6 +30,8 @@ static uint32 receivedMessageSenderID = 0;
 static int receivedMessageType = -1;
 static int receivedInteger = 0;
 static char receivedString[20];
+static uint32 receivedTimestamp = 0; // msecs when the most recently read packet arrived
+static uint32 droppedPacketCount = 0; // packets lost because the receive queue was full
 
 #if defined(NRF51) || defined(NRF52)
 
@@ -42,12 +44,19 @@ static char receivedString[20];
 #endif
 
 #define PACKET_SIZE 32
-#define MAX_PACKETS 4 // number of packets in the receive buffer; must be a power of 2
+#if defined(NRF51)
+	#define MAX_PACKETS 8 // maximum receive queue depth; must be a power of 2
+#else
+	#define MAX_PACKETS 16 // maximum receive queue depth; must be a power of 2
+#endif
 static uint8_t receiveBuffer[MAX_PACKETS * PACKET_SIZE];
+static int8_t packetRSSI[MAX_PACKETS]; // RSSI of each queued packet
+static uint32 packetTimestamp[MAX_PACKETS]; // arrival time (msecs) of each queued packet
 
 static uint8_t radioInitialized = false;
+static uint8_t queueDepth = 4; // current queue depth; a power of 2 <= MAX_PACKETS
 static uint8_t receivedPacketCount = 0;
-static uint8_t packetIndex = 0; // index of current packet buffer (0..(MAX_PACKETS - 1)
+static uint8_t packetIndex = 0; // index of current packet buffer (0..(queueDepth - 1)
 
 // Radio Setup
 
@@ -136,10 +145,15 @@ void RADIO_IRQHandler(void) {
 		NRF_RADIO->EVENTS_END = 0;
 		if (NRF_RADIO->CRCSTATUS == 1) {
 			int sample = (int) NRF_RADIO->RSSISAMPLE; // RSSI for this packet
-			radioSignalStrength = -sample;
-
-			if (receivedPacketCount < MAX_PACKETS) receivedPacketCount++;
-			packetIndex = (packetIndex + 1) % MAX_PACKETS; // receive into next packet buffer
+			packetRSSI[packetIndex] = -sample;
+			packetTimestamp[packetIndex] = millisecs();
+
+			if (receivedPacketCount < queueDepth) {
+				receivedPacketCount++;
+			} else { // queue full; the oldest unread packet is overwritten
+				droppedPacketCount++;
+			}
+			packetIndex = (packetIndex + 1) & (queueDepth - 1); // receive into next packet buffer
 			NRF_RADIO->PACKETPTR = (uint32_t) &receiveBuffer[packetIndex * PACKET_SIZE];
 		} else { // bad CRC; ignore this packet
 			radioSignalStrength = 0;
@@ -186,13 +200,35 @@ static int receivePacket(uint8_t *packet) {
 	if (!radioInitialized) initializeRadio();
 	if (receivedPacketCount <= 0) return false;
 
-	int readIndex = (packetIndex - receivedPacketCount) & (MAX_PACKETS - 1);
+	// briefly disable the radio interrupt so the queue state stays consistent
+	NVIC_DisableIRQ(RADIO_IRQn);
+	int readIndex = (packetIndex - receivedPacketCount) & (queueDepth - 1);
 	memcpy(packet, &receiveBuffer[readIndex * PACKET_SIZE], 32);
+	radioSignalStrength = packetRSSI[readIndex];
+	receivedTimestamp = packetTimestamp[readIndex];
 	receivedPacketCount--;
+	NVIC_EnableIRQ(RADIO_IRQn);
 
 	return true;
 }
 
+static void setQueueDepth(int depth) {
+	// Set the receive queue depth (1-MAX_PACKETS, rounded down to a power of 2)
+	// and clear the queue. Deeper queues tolerate longer bursts between polls.
+
+	if (depth < 1) return;
+	int d = 1;
+	while (((2 * d) <= depth) && ((2 * d) <= MAX_PACKETS)) d = 2 * d;
+
+	if (!radioInitialized) initializeRadio();
+	disableRadio();
+	queueDepth = d;
+	receivedPacketCount = 0;
+	packetIndex = 0;
+	NRF_RADIO->PACKETPTR = (uint32_t) receiveBuffer;
+	startReceiving();
+}
+
 static void sendPacket(uint8_t *packet) {
 	// Transmit the given 32-byte packet. Block until transmission is complete.
 	// Note: The radio can do only one thing at at time; we need to stop receiving to transmit.
@@ -427,6 +463,13 @@ static OBJ primDeviceID(int argCount, OBJ *args) {
 	return int2obj(deviceID());
 }
 
+static OBJ primSetQueueSize(int argCount, OBJ *args) {
+	if ((argCount > 0) && isInt(args[0])) {
+		setQueueDepth(obj2int(args[0]));
+	}
+	return falseObj;
+}
+
 #else // not nrf51 or nrf52
 
 // stubs
@@ -442,6 +485,7 @@ static OBJ primSetChannel(int argCount, OBJ *args) { return falseObj; }
 static OBJ primSetGroup(int argCount, OBJ *args) { return falseObj; }
 static OBJ primSetPower(int argCount, OBJ *args) { return falseObj; }
 static OBJ primDeviceID(int argCount, OBJ *args) { return falseObj; }
+static OBJ primSetQueueSize(int argCount, OBJ *args) { return falseObj; }
 
 #endif
 
@@ -476,6 +520,21 @@ static OBJ primMessageSenderID(int argCount, OBJ *args) {
 	return int2obj(receivedMessageSenderID);
 }
 
+static OBJ primReceivedTimestamp(int argCount, OBJ *args) {
+	// Return the arrival time (msecs) of the most recently read packet.
+
+	return int2obj(receivedTimestamp);
+}
+
+static OBJ primDroppedPackets(int argCount, OBJ *args) {
+	// Return the number of packets lost because the receive queue was full.
+	// The optional argument, if true, resets the counter.
+
+	uint32 result = droppedPacketCount;
+	if ((argCount > 0) && (trueObj == args[0])) droppedPacketCount = 0;
+	return int2obj(result);
+}
+
 static PrimEntry entries[] = {
 	{"disableRadio", primDisableRadio},
 	{"messageReceived", primMessageReceived},
@@ -490,7 +549,10 @@ static PrimEntry entries[] = {
 	{"setChannel", primSetChannel},
 	{"setGroup", primSetGroup},
 	{"setPower", primSetPower},
+	{"setReceiveQueueSize", primSetQueueSize},
 	{"signalStrength", primSignalStrength},
+	{"receivedTimestamp", primReceivedTimestamp},
+	{"droppedPackets", primDroppedPackets},
 	{"deviceID", primDeviceID},
 	{"lastMessageID", primMessageSenderID},
 };
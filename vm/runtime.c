@@ -50,6 +50,29 @@ void addPrimitiveSet(const char *setName, int entryCount, PrimEntry *entries) {
 	}
 }
 
+// Primitive Call Cache
+//
+// Named primitives are resolved by string comparison of their set and primitive
+// names. The name strings at a given call site are literals embedded in the code
+// chunk, so their addresses are stable between calls. A small direct-mapped cache
+// keyed on those addresses memoizes the resolved function pointer after the first
+// call, turning repeated calls from the same site into two pointer compares.
+// The cache is flushed whenever the code store changes (a chunk is stored, deleted,
+// or the code store is compacted), since that can move or reuse literal addresses.
+
+#define PRIM_CACHE_SIZE 16 // direct mapped; must be a power of two
+typedef struct {
+	OBJ setName;
+	OBJ primName;
+	PrimitiveFunction primFunc;
+} PrimCacheEntry;
+
+static PrimCacheEntry primCache[PRIM_CACHE_SIZE];
+
+void clearPrimCache() {
+	memset(primCache, 0, sizeof(primCache));
+}
+
 OBJ callPrimitive(int argCount, OBJ *args) {
 	// Call a named primitive. The first two arguments are the primitive set name
 	// and the primitive name, followed by the arguments to the primitive itself.
@@ -61,6 +84,12 @@ OBJ callPrimitive(int argCount, OBJ *args) {
 	// but are fine for slower operations (e.g. updating the micro:bit display).
 
 	if (argCount < 2) return fail(primitiveNotImplemented);
+
+	PrimCacheEntry *cached = &primCache[((((unsigned) args[0]) >> 2) ^ (((unsigned) args[1]) >> 2)) & (PRIM_CACHE_SIZE - 1)];
+	if ((cached->setName == args[0]) && (cached->primName == args[1])) {
+		return (cached->primFunc)(argCount - 2, args + 2); // cache hit; call primitive
+	}
+
 	char *setName = IS_TYPE(args[0], StringType) ? obj2str(args[0]) : "";
 	char *primName = IS_TYPE(args[1], StringType) ? obj2str(args[1]) : "";
 
@@ -70,6 +99,9 @@ OBJ callPrimitive(int argCount, OBJ *args) {
 			int entryCount = primSets[i].entryCount;
 			for (int j = 0; j < entryCount; j++) {
 				if (0 == strcmp(entries[j].primName, primName)) {
+					cached->setName = args[0]; // remember this call site
+					cached->primName = args[1];
+					cached->primFunc = entries[j].primFunc;
 					return (entries[j].primFunc)(argCount - 2, args + 2); // call primitive
 				}
 			}
@@ -100,8 +132,10 @@ void primsInit() {
 // Task Ops
 
 void initTasks() {
+	for (int i = 0; i < MAX_TASKS; i++) freeTaskStack(&tasks[i]);
 	memset(tasks, 0, sizeof(tasks));
 	taskCount = 0;
+	wakeQueueClear();
 }
 
 void startTaskForChunk(uint8 chunkIndex) {
@@ -121,6 +155,7 @@ void startTaskForChunk(uint8 chunkIndex) {
 		return;
 	}
 
+	freeTaskStack(&tasks[i]);
 	memset(&tasks[i], 0, sizeof(Task));
 	tasks[i].status = running;
 	tasks[i].taskChunkIndex = chunkIndex;
@@ -129,6 +164,9 @@ void startTaskForChunk(uint8 chunkIndex) {
 	tasks[i].ip = PERSISTENT_HEADER_WORDS; // relative to start of code
 	tasks[i].sp = 0; // relative to start of stack
 	tasks[i].fp = 0; // 0 means "not in a function call"
+	if (whenConditionHat == chunks[chunkIndex].chunkType) {
+		tasks[i].varWatchMask = whenConditionVarMask(chunks[chunkIndex].code);
+	}
 	if (i >= taskCount) taskCount = i + 1;
 	sendMessage(taskStartedMsg, chunkIndex, 0, NULL);
 }
@@ -141,6 +179,7 @@ static void stopTaskForChunk(uint8 chunkIndex) {
 		if (chunkIndex == tasks[i].taskChunkIndex) break;
 	}
 	if (i >= MAX_TASKS) return; // no task for chunkIndex
+	freeTaskStack(&tasks[i]);
 	memset(&tasks[i], 0, sizeof(Task)); // clear task
 	if (i == (taskCount - 1)) taskCount--;
 	sendMessage(taskDoneMsg, chunkIndex, 0, NULL);
@@ -176,6 +215,7 @@ void stopAllTasksButThis(Task *thisTask) {
 		Task *task = &tasks[i];
 		if ((task != thisTask) && task->status) {
 			sendMessage(taskDoneMsg, task->taskChunkIndex, 0, NULL);
+			freeTaskStack(task);
 			memset(task, 0, sizeof(Task)); // clear task
 		}
 		if (task == thisTask) { taskCount = i + 1; }
@@ -334,10 +374,13 @@ void checkButtons() {
 static void storeCodeChunk(uint8 chunkIndex, int byteCount, uint8 *data) {
 	if (chunkIndex >= MAX_CHUNKS) return;
 	stopTaskForChunk(chunkIndex);
+	clearPrimCache(); // storing a chunk may move or reuse literal addresses
 	int chunkType = data[0]; // first byte is the chunk type
+	fuseChunkData(&data[1], byteCount - 1); // rewrite common opcode pairs as superinstructions
 	int *persistenChunk = appendPersistentRecord(chunkCode, chunkIndex, chunkType, byteCount - 1, &data[1]);
 	chunks[chunkIndex].code = persistenChunk;
 	chunks[chunkIndex].chunkType = chunkType;
+	chunks[chunkIndex].crcValid = false; // invalidate the cached CRC
 }
 
 static void storeChunkAttribute(uint8 chunkIndex, int byteCount, uint8 *data) {
@@ -360,13 +403,16 @@ static void storeVarName(uint8 varIndex, int byteCount, uint8 *data) {
 static void deleteCodeChunk(uint8 chunkIndex) {
 	if (chunkIndex >= MAX_CHUNKS) return;
 	stopTaskForChunk(chunkIndex);
+	clearPrimCache();
 	chunks[chunkIndex].code = NULL;
 	chunks[chunkIndex].chunkType = unusedChunk;
+	chunks[chunkIndex].crcValid = false;
 	appendPersistentRecord(chunkDeleted, chunkIndex, 0, 0, NULL);
 }
 
 static void deleteAllChunks() {
 	stopAllTasks();
+	clearPrimCache();
 	#if defined(ESP8266) || defined(ARDUINO_ARCH_ESP32) || defined(GNUBLOCKS)
 		clearPersistentMemory();
 		clearCodeFile(0);
@@ -434,9 +480,16 @@ static int outBufEnd = 0;
 #define OUTBUF_BYTES() ((outBufEnd - outBufStart) & OUTBUF_MASK)
 
 static inline void sendData() {
+	// Hand contiguous spans of the output buffer to the serial driver, which
+	// transmits them asynchronously. Stop when the driver stops accepting bytes.
+
 	while (outBufStart != outBufEnd) {
-		if (!sendByte(outBuf[outBufStart])) break;
-		outBufStart = (outBufStart + 1) & OUTBUF_MASK;
+		int spanLen = (outBufEnd > outBufStart) ?
+			(outBufEnd - outBufStart) : (OUTBUF_SIZE - outBufStart); // span ends at buffer wrap
+		int n = sendBytes(&outBuf[outBufStart], spanLen);
+		if (n <= 0) break;
+		outBufStart = (outBufStart + n) & OUTBUF_MASK;
+		if (n < spanLen) break; // driver accepted only part of the span; try again later
 	}
 }
 
@@ -583,6 +636,73 @@ static void sendValueMessage(uint8 msgType, uint8 chunkOrVarIndex, OBJ value) {
 	}
 }
 
+// Binary Telemetry
+//
+// logTelemetry() appends one sample frame to a batch buffer instead of formatting
+// values as an ASCII string. A frame is <timestamp (uint32 msecs)> followed by one
+// little-endian int32 per channel. Frames accumulate until the buffer is nearly
+// full or the oldest buffered sample is TELEMETRY_MAX_LATENCY msecs old, then the
+// whole batch is sent as a single telemetryMsg whose body is <format version (1)>
+// <channel count> <frames...>. Batching multiple samples per serial message is
+// what makes high-rate logging (e.g. a 200 Hz accelerometer) fit the link.
+
+#define TELEMETRY_BUF_SIZE 240
+#define TELEMETRY_MAX_CHANNELS 16
+#define TELEMETRY_MAX_LATENCY 50 // msecs
+
+static uint8 telemetryBuf[TELEMETRY_BUF_SIZE];
+static int telemetryByteCount = 0;
+static int telemetryChannels = 0;
+static uint32 telemetryFirstSampleTime = 0;
+
+static void flushTelemetry() {
+	char data[TELEMETRY_BUF_SIZE + 2];
+	if (!telemetryByteCount) return;
+	data[0] = 1; // frame format version
+	data[1] = telemetryChannels;
+	memcpy(&data[2], telemetryBuf, telemetryByteCount);
+	sendMessage(telemetryMsg, 0, (telemetryByteCount + 2), data);
+	telemetryByteCount = 0;
+}
+
+void logTelemetry(int channelCount, OBJ *channels) {
+	// Append one sample frame for the given channel values (integers or booleans).
+
+	if (channelCount > TELEMETRY_MAX_CHANNELS) channelCount = TELEMETRY_MAX_CHANNELS;
+	int frameBytes = 4 + (4 * channelCount);
+	if ((telemetryByteCount && (channelCount != telemetryChannels)) ||
+		((telemetryByteCount + frameBytes) > TELEMETRY_BUF_SIZE)) {
+			flushTelemetry(); // channel count changed or buffer full
+	}
+	telemetryChannels = channelCount;
+	if (!telemetryByteCount) telemetryFirstSampleTime = millisecs();
+
+	uint8 *dst = &telemetryBuf[telemetryByteCount];
+	uint32 now = millisecs();
+	*dst++ = (now & 0xFF);
+	*dst++ = ((now >> 8) & 0xFF);
+	*dst++ = ((now >> 16) & 0xFF);
+	*dst++ = ((now >> 24) & 0xFF);
+	for (int i = 0; i < channelCount; i++) {
+		int val = isInt(channels[i]) ? obj2int(channels[i]) : ((trueObj == channels[i]) ? 1 : 0);
+		*dst++ = (val & 0xFF);
+		*dst++ = ((val >> 8) & 0xFF);
+		*dst++ = ((val >> 16) & 0xFF);
+		*dst++ = ((val >> 24) & 0xFF);
+	}
+	telemetryByteCount += frameBytes;
+}
+
+void telemetryService() {
+	// Flush buffered telemetry frames once the oldest one has waited long enough.
+	// Called periodically between tasks (see vmLoop).
+
+	if (telemetryByteCount &&
+		((millisecs() - telemetryFirstSampleTime) >= TELEMETRY_MAX_LATENCY)) {
+			flushTelemetry();
+	}
+}
+
 void logData(char *s) {
 	// Log data (the former 'print' command). Use chunkID 254.
 
@@ -643,6 +763,59 @@ static void sendVariableValue(int varID) {
 	}
 }
 
+// Variable Subscriptions
+//
+// Instead of polling with getVarMsg, the IDE can subscribe to a set of variables
+// with varSubscribeMsg (body: one byte per variable index; empty body clears all
+// subscriptions; the id byte is the minimum update interval in units of 10 msecs,
+// 0 for the default). The VM then pushes varValueMsg for a subscribed variable
+// only when a store actually changes it, at most once per interval. Variable
+// stores record changes in varPushMask (see interp.c), so watching costs nothing
+// when no variable changes.
+
+#define MAX_VAR_SUBSCRIPTIONS 32
+
+static uint8 varSubscriptions[MAX_VAR_SUBSCRIPTIONS];
+static OBJ lastPushedValue[MAX_VAR_SUBSCRIPTIONS];
+static int varSubscriptionCount = 0;
+static uint32 varPushInterval = 100; // minimum msecs between update bursts
+static uint32 lastVarPushTime = 0;
+
+static void setVarSubscriptions(int interval, int byteCount, uint8 *data) {
+	varSubscriptionCount = 0;
+	if (byteCount > MAX_VAR_SUBSCRIPTIONS) byteCount = MAX_VAR_SUBSCRIPTIONS;
+	for (int i = 0; i < byteCount; i++) {
+		if (data[i] < MAX_VARS) {
+			varSubscriptions[varSubscriptionCount] = data[i];
+			lastPushedValue[varSubscriptionCount] = (OBJ) 2; // impossible value; forces initial push
+			varSubscriptionCount++;
+		}
+	}
+	varPushInterval = interval ? (10 * interval) : 100;
+	varPushMask = ~0; // push the current value of every subscribed variable
+}
+
+void pushSubscribedVars() {
+	// Push the values of subscribed variables that have changed since the last push.
+	// Called periodically between tasks (see vmLoop).
+
+	if (!varSubscriptionCount || !varPushMask) return;
+	uint32 now = millisecs();
+	if ((now - lastVarPushTime) < varPushInterval) return;
+	lastVarPushTime = now;
+
+	uint32 changed = varPushMask;
+	varPushMask = 0;
+	for (int i = 0; i < varSubscriptionCount; i++) {
+		int varID = varSubscriptions[i];
+		// the mask has one bit per (index mod 32); the value check filters aliases
+		if ((changed & (1 << (varID & 31))) && (vars[varID] != lastPushedValue[i])) {
+			sendVariableValue(varID);
+			lastPushedValue[i] = vars[varID];
+		}
+	}
+}
+
 static void sendValueOfVariableNamed(uint8 chunkIndex, int byteCount, uint8 *data) {
 	char varName[100];
 	if (byteCount > 99) return; // variable name too long; ignore request
@@ -668,6 +841,7 @@ static void setVariableValue(int varID, int byteCount, uint8 *data) {
 			vars[varID] = data[1] ? trueObj : falseObj;
 			break;
 		}
+		varDirtyMask |= 1 << (varID & 31); // re-arm condition hats watching this variable
 	}
 }
 
@@ -726,26 +900,39 @@ const uint32_t crcTable[] = {
 0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6, 0xBAD03605, 0xCDD70693, 0x54DE5729, 0x23D967BF,
 0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94, 0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D};
 
-uint32_t crc32(uint8_t *buf, int byteCount) {
-	uint32_t crc = ~0;
+uint32_t crc32Update(uint32_t crc, uint8_t *buf, int byteCount) {
+	// Streaming CRC-32. Start with crc = ~0, call for each piece of data in order,
+	// and complement the final result.
+
 	uint8_t *end = buf + byteCount;
 	for (uint8_t *p = buf; p < end; p++) {
 		crc = (crc >> 8) ^ crcTable[(crc & 0xff) ^ *p];
 	}
-	return ~crc;
+	return crc;
+}
+
+uint32_t crc32(uint8_t *buf, int byteCount) {
+	return ~crc32Update(~0, buf, byteCount);
 }
 
 void sendChunkCRC(int chunkID) {
 	// Send the 4-byte CRC-32 for the given chunk. Do nothing if the chunk is not in use.
+	// The CRC for each chunk is computed once and cached in its CodeChunkRecord;
+	// storeCodeChunk invalidates the cache, so IDE reconnects with many chunks do
+	// not recompute every CRC.
 
 	if ((chunkID < 0) || (chunkID >= MAX_CHUNKS)) return;
 	OBJ code = chunks[chunkID].code;
 	if (code) {
-		int wordCount = *(code + 1); // size is the second word in the persistent store record
-		uint8_t *chunkData = (uint8_t *) (code + PERSISTENT_HEADER_WORDS);
-		uint32_t crc = crc32(chunkData, (4 * wordCount));
+		if (!chunks[chunkID].crcValid) {
+			int wordCount = *(code + 1); // size is the second word in the persistent store record
+			// compute the CRC over the original opcodes so it matches the CRC computed by the IDE
+			uint8_t *chunkData = unfusedChunkData((uint32 *) (code + PERSISTENT_HEADER_WORDS), wordCount);
+			chunks[chunkID].crc = crc32(chunkData, (4 * wordCount));
+			chunks[chunkID].crcValid = true;
+		}
 		waitForOutbufBytes(9);
-		sendMessage(chunkCRCMsg, chunkID, 4, (char *) &crc);
+		sendMessage(chunkCRCMsg, chunkID, 4, (char *) &chunks[chunkID].crc);
 	}
 }
 
@@ -800,7 +987,8 @@ static void sendAllCode() {
 
 		int chunkType = chunks[chunkID].chunkType;
 		int chunkWords = *(code + 1); // chunk word count is second word of persistent store record
-		char *chunkData = (char *) (code + PERSISTENT_HEADER_WORDS);
+		// send the original opcodes, not the fused superinstructions
+		char *chunkData = (char *) unfusedChunkData((uint32 *) (code + PERSISTENT_HEADER_WORDS), chunkWords);
 		sendCodeChunk(chunkID, chunkType, (4 * chunkWords), chunkData);
 		sendData();
 		delay(5 * chunkWords); // 2 fails on Johns Chromebook; 3 works; 5 is conservative
@@ -966,11 +1154,16 @@ static void processShortMessage() {
 		if (2 == chunkIndex) { compactCodeStore(); break; }
 		softReset(true);
 		break;
+	case getProfileMsg:
+		#ifdef USE_PROFILER
+			profilerControl(chunkIndex);
+		#endif
+		break;
 	case pingMsg:
 		sendMessage(pingMsg, chunkIndex, 0, NULL);
 		break;
 	default:
-		if ((200 <= cmd) && (cmd <= 205)) {
+		if ((200 <= cmd) && (cmd <= 208)) {
 			processFileMessage(cmd, 0, NULL);
 		}
 	}
@@ -1015,11 +1208,14 @@ static void processLongMessage() {
 	case varNameMsg:
 		storeVarName(chunkIndex, bodyBytes, &rcvBuf[5]);
 		break;
+	case varSubscribeMsg:
+		setVarSubscriptions(chunkIndex, bodyBytes, &rcvBuf[5]);
+		break;
 	case extendedMsg:
 		processExtendedMessage(chunkIndex, bodyBytes, &rcvBuf[5]);
 		break;
 	default:
-		if ((200 <= cmd) && (cmd <= 205)) {
+		if ((200 <= cmd) && (cmd <= 208)) {
 			processFileMessage(cmd, bodyBytes, (char *) &rcvBuf[5]);
 		}
 	}
@@ -1032,8 +1228,14 @@ static void processLongMessage() {
 //	while ((microsecs() - start) < (uint32) usecs) /* wait */;
 // }
 
+#define MSG_PROCESS_BUDGET 2000 // usecs; max time spent processing messages per call
+
 void processMessage() {
-	// Process a message from the client.
+	// Process messages from the client. Drain as many complete messages as fit in a
+	// small time budget, rather than one per call, so that a bulk code download does
+	// not queue up behind the vmLoop background interval while tasks also starve.
+
+	uint32 start = microsecs();
 
 	sendData();
 
@@ -1049,12 +1251,30 @@ void processMessage() {
 		rcvByteCount += bytesRead;
 		lastRcvTime = microsecs();
 	}
-	int firstByte = rcvBuf[0];
-	if (0xFA == firstByte) {
-		processShortMessage();
-	} else if (0xFB == firstByte) {
-		processLongMessage();
-	} else {
-		skipToStartByteAfter(1); // bad message, probably due to dropped bytes
+	while (rcvByteCount > 0) {
+		int oldByteCount = rcvByteCount;
+		int firstByte = rcvBuf[0];
+		if (0xFA == firstByte) {
+			processShortMessage();
+		} else if (0xFB == firstByte) {
+			processLongMessage();
+		} else {
+			skipToStartByteAfter(1); // bad message, probably due to dropped bytes
+		}
+		if (rcvByteCount >= oldByteCount) break; // partial message; wait for more data
+		if ((microsecs() - start) >= MSG_PROCESS_BUDGET) break; // time budget exhausted
+		// pick up any bytes that arrived while processing
+		bytesRead = recvBytes(&rcvBuf[rcvByteCount], RCVBUF_SIZE - rcvByteCount);
+		if (bytesRead > 0) {
+			rcvByteCount += bytesRead;
+			lastRcvTime = microsecs();
+		}
 	}
 }
+
+int hasMessageBacklog() {
+	// Return true if the receive buffer holds (at least the start of) another message.
+	// Used by vmLoop to shorten the background task interval during bulk downloads.
+
+	return rcvByteCount >= 3;
+}
@@ -138,6 +138,183 @@ static OBJ primI2cWrite(int argCount, OBJ *args) {
 	return falseObj;
 }
 
+// I2C Burst and Asynchronous Reads
+// Reading a multi-byte sensor FIFO one register at a time costs a full bus
+// transaction per byte, which caps the sample rate well below what the sensor
+// can deliver. A burst read pulls a whole block of consecutive registers in a
+// single repeated-start transaction. On nRF52 boards the transfer can also run
+// asynchronously: the TWIM peripheral moves the bytes via EasyDMA while VM
+// tasks keep running, and the waiting task polls for completion. DMA targets a
+// static buffer (the garbage collector can move heap objects); the result is
+// copied into a byte array when collected.
+
+#define I2C_CHUNK_SIZE 32 // the Arduino Wire library limits reads to 32 bytes
+#define I2C_ASYNC_MAX 64
+
+static uint8 i2cAsyncBuf[I2C_ASYNC_MAX];
+static uint8 i2cAsyncReg; // register number; must persist while a transfer is running
+static int i2cAsyncCount = 0;
+static int i2cAsyncInProgress = false;
+
+static int i2cBurstReadInto(int deviceID, int registerID, uint8 *dst, int count) {
+	// Read count consecutive registers starting at registerID into dst using a
+	// repeated-start burst transaction. Return the number of bytes read or -1 on error.
+
+	if (!wireStarted) startWire();
+	Wire.beginTransmission(deviceID);
+	Wire.write(registerID);
+	#if defined(ARDUINO_ARCH_ESP32)
+		int error = Wire.endTransmission();
+	#else
+		int error = Wire.endTransmission((bool) false);
+	#endif
+	if (error) return -1;
+
+	int bytesRead = 0;
+	while (bytesRead < count) {
+		int chunk = count - bytesRead;
+		if (chunk > I2C_CHUNK_SIZE) chunk = I2C_CHUNK_SIZE;
+		int isLast = ((bytesRead + chunk) >= count);
+		#if defined(NRF51)
+			noInterrupts();
+			Wire.requestFrom(deviceID, chunk, isLast);
+			interrupts();
+		#else
+			Wire.requestFrom(deviceID, chunk, isLast);
+		#endif
+		int got = 0;
+		while ((got < chunk) && Wire.available()) {
+			dst[bytesRead++] = Wire.read();
+			got++;
+		}
+		if (got < chunk) break; // device sent less data than requested
+	}
+	return bytesRead;
+}
+
+static OBJ primI2cReadBlock(int argCount, OBJ *args) {
+	// Read <count> consecutive registers of <device> starting at <register> in one
+	// burst transaction and return them as a byte array. Reading a 3-axis IMU FIFO
+	// this way costs one bus setup rather than one per register.
+
+	if (argCount < 3) return fail(notEnoughArguments);
+	if (!isInt(args[0]) || !isInt(args[1]) || !isInt(args[2])) return fail(needsIntegerError);
+	int deviceID = obj2int(args[0]);
+	int registerID = obj2int(args[1]);
+	int count = obj2int(args[2]);
+	if ((deviceID < 0) || (deviceID > 128)) return fail(i2cDeviceIDOutOfRange);
+	if ((registerID < 0) || (registerID > 255)) return fail(i2cRegisterIDOutOfRange);
+	if (count < 1) return fail(needsIntegerError);
+	if (count > 800) count = 800;
+
+	// allocate the result before starting the transfer; I2C does no allocation after this
+	OBJ result = newObj(ByteArrayType, (count + 3) / 4, falseObj);
+	if (!result) return fail(insufficientMemoryError);
+	setByteCountAdjust(result, count);
+
+	int bytesRead = i2cBurstReadInto(deviceID, registerID, (uint8 *) &FIELD(result, 0), count);
+	if (bytesRead < 0) return fail(i2cTransferFailed);
+	if (bytesRead < count) setByteCountAdjust(result, bytesRead);
+	return result;
+}
+
+#if defined(NRF52)
+
+// NRF_TWIM0 is the TWI master instance behind the primary Wire interface on
+// nRF52 boards; Wire sets the buffer pointers on every transaction, so using
+// the peripheral directly between Wire transactions is safe.
+
+static int i2cAsyncTransferDone() {
+	if (!i2cAsyncInProgress) return true;
+	return (NRF_TWIM0->EVENTS_STOPPED || NRF_TWIM0->EVENTS_ERROR);
+}
+
+static int i2cAsyncStart(int deviceID, int registerID, int count) {
+	// Start an asynchronous burst read via EasyDMA. Return false if a transfer
+	// is already running.
+
+	if (!i2cAsyncTransferDone()) return false;
+	if (!wireStarted) startWire();
+	i2cAsyncReg = registerID;
+	NRF_TWIM0->ADDRESS = deviceID;
+	NRF_TWIM0->TXD.PTR = (uint32_t) &i2cAsyncReg;
+	NRF_TWIM0->TXD.MAXCNT = 1;
+	NRF_TWIM0->RXD.PTR = (uint32_t) i2cAsyncBuf;
+	NRF_TWIM0->RXD.MAXCNT = count;
+	NRF_TWIM0->SHORTS = TWIM_SHORTS_LASTTX_STARTRX_Msk | TWIM_SHORTS_LASTRX_STOP_Msk;
+	NRF_TWIM0->EVENTS_STOPPED = 0;
+	NRF_TWIM0->EVENTS_ERROR = 0;
+	NRF_TWIM0->TASKS_STARTTX = 1;
+	i2cAsyncCount = count;
+	i2cAsyncInProgress = true;
+	return true;
+}
+
+static int i2cAsyncCollect() {
+	// Return the byte count of a completed transfer, or -1 on bus error.
+
+	if (NRF_TWIM0->EVENTS_ERROR) {
+		NRF_TWIM0->EVENTS_ERROR = 0;
+		NRF_TWIM0->TASKS_STOP = 1;
+		return -1;
+	}
+	return NRF_TWIM0->RXD.AMOUNT;
+}
+
+#else // no DMA support; fall back to a synchronous burst read
+
+static int i2cAsyncTransferDone() { return true; }
+
+static int i2cAsyncStart(int deviceID, int registerID, int count) {
+	i2cAsyncCount = i2cBurstReadInto(deviceID, registerID, i2cAsyncBuf, count);
+	i2cAsyncInProgress = true;
+	return true;
+}
+
+static int i2cAsyncCollect() { return i2cAsyncCount; }
+
+#endif
+
+static OBJ primI2cStartRead(int argCount, OBJ *args) {
+	// Start reading <count> consecutive registers of <device> at <register>
+	// without blocking; use i2cTransferDone and i2cTransferResult to collect
+	// the data. Return false if a transfer is already in progress.
+
+	if (argCount < 3) return fail(notEnoughArguments);
+	if (!isInt(args[0]) || !isInt(args[1]) || !isInt(args[2])) return fail(needsIntegerError);
+	int deviceID = obj2int(args[0]);
+	int registerID = obj2int(args[1]);
+	int count = obj2int(args[2]);
+	if ((deviceID < 0) || (deviceID > 128)) return fail(i2cDeviceIDOutOfRange);
+	if ((registerID < 0) || (registerID > 255)) return fail(i2cRegisterIDOutOfRange);
+	if (count < 1) return fail(needsIntegerError);
+	if (count > I2C_ASYNC_MAX) count = I2C_ASYNC_MAX;
+
+	return i2cAsyncStart(deviceID, registerID, count) ? trueObj : falseObj;
+}
+
+static OBJ primI2cTransferDone(int argCount, OBJ *args) {
+	return i2cAsyncTransferDone() ? trueObj : falseObj;
+}
+
+static OBJ primI2cTransferResult(int argCount, OBJ *args) {
+	// Return the data from a completed asynchronous read as a byte array, or
+	// false if no transfer has completed (or the bus reported an error).
+
+	if (!i2cAsyncInProgress || !i2cAsyncTransferDone()) return falseObj;
+	i2cAsyncInProgress = false;
+
+	int byteCount = i2cAsyncCollect();
+	if (byteCount < 0) return fail(i2cTransferFailed);
+	if (byteCount > I2C_ASYNC_MAX) byteCount = I2C_ASYNC_MAX;
+
+	OBJ result = newObj(ByteArrayType, (byteCount + 3) / 4, falseObj);
+	if (!result) return fail(insufficientMemoryError);
+	setByteCountAdjust(result, byteCount);
+	memcpy(&FIELD(result, 0), i2cAsyncBuf, byteCount);
+	return result;
+}
+
 // SPI prims
 
 static void initSPI() {
@@ -988,6 +1165,10 @@ static PrimEntry entries[] = {
 	{"touchRead", primTouchRead},
 	{"i2cRead", primI2cRead},
 	{"i2cWrite", primI2cWrite},
+	{"i2cReadBlock", primI2cReadBlock},
+	{"i2cStartRead", primI2cStartRead},
+	{"i2cTransferDone", primI2cTransferDone},
+	{"i2cTransferResult", primI2cTransferResult},
 	{"readDHT", primReadDHT},
 	{"microphone", primMicrophone},
 };
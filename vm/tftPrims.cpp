@@ -275,7 +275,224 @@ int touchEnabled = false;
 
 	#endif
 
+// Offscreen Frame Buffer
+// Drawing straight to the display makes multi-element updates flicker and pays
+// SPI transaction setup per shape. When buffering is enabled (deferUpdates),
+// drawing primitives render into an offscreen 16-bit canvas and accumulate a
+// dirty rectangle; flushDisplay then streams just the changed region to the
+// display in one SPI transaction (using DMA where Adafruit_SPITFT supports it).
+// The monochrome SSD1306 has its own buffering, and TFT_eSPI has a different
+// write API, so buffering is only offered on the Adafruit color displays.
+
+#if !defined(IS_MONCHROME) && !USE_TFT_ESPI
+	#define TFT_CAN_BUFFER true
+#else
+	#define TFT_CAN_BUFFER false
+#endif
+
+static int tftBuffered = false;
+
+#if TFT_CAN_BUFFER
+
+static GFXcanvas16 *tftCanvas = NULL;
+static int dirtyMinX, dirtyMinY, dirtyMaxX, dirtyMaxY; // dirty rect; minX > maxX when empty
+
+static void clearDirtyRect() {
+	dirtyMinX = TFT_WIDTH;
+	dirtyMinY = TFT_HEIGHT;
+	dirtyMaxX = -1;
+	dirtyMaxY = -1;
+}
+
+static void markDirty(int x, int y, int width, int height) {
+	// Add the given rectangle to the region to be flushed.
+
+	if (x < dirtyMinX) dirtyMinX = x;
+	if (y < dirtyMinY) dirtyMinY = y;
+	if ((x + width - 1) > dirtyMaxX) dirtyMaxX = x + width - 1;
+	if ((y + height - 1) > dirtyMaxY) dirtyMaxY = y + height - 1;
+}
+
+static Adafruit_GFX *drawTarget() {
+	// Return the drawing target: the offscreen canvas when buffering, else the display.
+
+	if (tftBuffered) return (Adafruit_GFX *) tftCanvas;
+	return (Adafruit_GFX *) &tft;
+}
+
+static void flushDisplay() {
+	// Stream the dirty region of the canvas to the display in one SPI transaction.
+
+	if (!tftBuffered || (dirtyMaxX < dirtyMinX)) return; // nothing to flush
+	if (dirtyMinX < 0) dirtyMinX = 0;
+	if (dirtyMinY < 0) dirtyMinY = 0;
+	if (dirtyMaxX >= TFT_WIDTH) dirtyMaxX = TFT_WIDTH - 1;
+	if (dirtyMaxY >= TFT_HEIGHT) dirtyMaxY = TFT_HEIGHT - 1;
+	int w = (dirtyMaxX - dirtyMinX) + 1;
+	int h = (dirtyMaxY - dirtyMinY) + 1;
+	if ((w <= 0) || (h <= 0)) { clearDirtyRect(); return; }
+
+	uint16_t *buf = tftCanvas->getBuffer();
+	tft.startWrite();
+	tft.setAddrWindow(dirtyMinX, dirtyMinY, w, h);
+	for (int y = dirtyMinY; y <= dirtyMaxY; y++) {
+		tft.writePixels(&buf[(y * TFT_WIDTH) + dirtyMinX], w);
+	}
+	tft.endWrite();
+	clearDirtyRect();
+}
+
+static void setBuffered(int flag) {
+	if (flag) {
+		if (!tftCanvas) {
+			tftCanvas = new GFXcanvas16(TFT_WIDTH, TFT_HEIGHT);
+			if (tftCanvas && !tftCanvas->getBuffer()) { // allocation failed
+				delete tftCanvas;
+				tftCanvas = NULL;
+			}
+		}
+		if (!tftCanvas) { fail(insufficientMemoryError); return; }
+		// we can't read the display back, so start from a cleared canvas
+		tftCanvas->fillScreen(BLACK);
+		clearDirtyRect();
+		markDirty(0, 0, TFT_WIDTH, TFT_HEIGHT); // repaint everything on first flush
+		tftBuffered = true;
+	} else {
+		flushDisplay();
+		tftBuffered = false;
+	}
+}
+
+// Glyph Cache
+// The GFX library re-rasterizes every character from the 1-bit font each time
+// it is drawn and issues a separate SPI write per pixel. For tickers and live
+// readouts that redraw the same digits every frame, we cache each glyph's
+// scaled pixel mask (rendered once through a scratch canvas, so this works
+// with whatever font the library uses) and blit whole strings row by row
+// through a line buffer, one SPI transaction per string. Foreground and
+// background colors are applied at blit time, so color changes don't
+// invalidate cached glyphs.
+
+#define GLYPH_MAX_SCALE 4
+#define GLYPH_CACHE_SIZE 32
+#define GLYPH_MASK_BYTES (6 * GLYPH_MAX_SCALE * GLYPH_MAX_SCALE) // 6x8 glyph, 1 bit/pixel
+
+typedef struct {
+	uint8 ch; // 0 when entry is unused
+	uint8 scale;
+	uint32 lastUsed;
+	uint8 mask[GLYPH_MASK_BYTES]; // row-major, (6 * scale) bits per row
+} GlyphCacheEntry;
+
+static GlyphCacheEntry glyphCache[GLYPH_CACHE_SIZE];
+static GFXcanvas16 *glyphScratch = NULL;
+static uint32 glyphUseCount = 0;
+static uint16_t glyphLineBuf[TFT_WIDTH];
+
+static GlyphCacheEntry *glyphFor(uint8 ch, int scale) {
+	// Return the cache entry for the given character and scale, rendering
+	// the glyph into the cache if needed. Return NULL if rendering fails.
+
+	GlyphCacheEntry *oldest = &glyphCache[0];
+	for (int i = 0; i < GLYPH_CACHE_SIZE; i++) {
+		GlyphCacheEntry *entry = &glyphCache[i];
+		if (entry->ch && (entry->ch == ch) && (entry->scale == scale)) {
+			entry->lastUsed = ++glyphUseCount;
+			return entry;
+		}
+		if (entry->lastUsed < oldest->lastUsed) oldest = entry;
+	}
+	// not cached; render the glyph into the scratch canvas and capture its mask
+	if (!glyphScratch) {
+		glyphScratch = new GFXcanvas16(6 * GLYPH_MAX_SCALE, 8 * GLYPH_MAX_SCALE);
+		if (glyphScratch && !glyphScratch->getBuffer()) {
+			delete glyphScratch;
+			glyphScratch = NULL;
+		}
+		if (!glyphScratch) return NULL;
+	}
+	glyphScratch->fillScreen(0);
+	glyphScratch->drawChar(0, 0, ch, 1, 0, scale);
+	uint16_t *pixels = glyphScratch->getBuffer();
+	GlyphCacheEntry *entry = oldest;
+	memset(entry->mask, 0, GLYPH_MASK_BYTES);
+	int glyphW = 6 * scale;
+	int glyphH = 8 * scale;
+	for (int y = 0; y < glyphH; y++) {
+		for (int x = 0; x < glyphW; x++) {
+			if (pixels[(y * 6 * GLYPH_MAX_SCALE) + x]) {
+				int bitIndex = (y * glyphW) + x;
+				entry->mask[bitIndex >> 3] |= (0x80 >> (bitIndex & 7));
+			}
+		}
+	}
+	entry->ch = ch;
+	entry->scale = scale;
+	entry->lastUsed = ++glyphUseCount;
+	return entry;
+}
+
+static int drawStringFast(const char *s, int x, int y, int fgColor, int bgColor, int scale) {
+	// Blit the given string using cached glyph masks, writing both foreground
+	// and background pixels so old text is overwritten without a clearing step.
+	// Return false if this string can't take the fast path.
+
+	if ((scale < 1) || (scale > GLYPH_MAX_SCALE)) return false;
+	int glyphW = 6 * scale;
+	int glyphH = 8 * scale;
+	if ((x < 0) || (y < 0) || ((y + glyphH) > TFT_HEIGHT)) return false;
+	int charCount = strlen(s);
+	if ((x + (charCount * glyphW)) > TFT_WIDTH) {
+		charCount = (TFT_WIDTH - x) / glyphW; // clip to the right edge
+	}
+	if (charCount <= 0) return true; // nothing visible to draw
+
+	// look up all glyphs first; the cache holds far more than one string's worth
+	GlyphCacheEntry *glyphs[TFT_WIDTH / 6];
+	for (int i = 0; i < charCount; i++) {
+		glyphs[i] = glyphFor((uint8) s[i], scale);
+		if (!glyphs[i]) return false;
+	}
+
+	int totalW = charCount * glyphW;
+	if (!tftBuffered) tft.startWrite();
+	if (!tftBuffered) tft.setAddrWindow(x, y, totalW, glyphH);
+	for (int row = 0; row < glyphH; row++) {
+		uint16_t *dst = glyphLineBuf;
+		for (int i = 0; i < charCount; i++) {
+			uint8 *mask = glyphs[i]->mask;
+			int bitIndex = row * glyphW;
+			for (int col = 0; col < glyphW; col++, bitIndex++) {
+				*dst++ = (mask[bitIndex >> 3] & (0x80 >> (bitIndex & 7))) ? fgColor : bgColor;
+			}
+		}
+		if (tftBuffered) {
+			memcpy(&tftCanvas->getBuffer()[((y + row) * TFT_WIDTH) + x], glyphLineBuf, totalW * 2);
+		} else {
+			tft.writePixels(glyphLineBuf, totalW);
+		}
+	}
+	if (!tftBuffered) tft.endWrite();
+	markDirty(x, y, totalW, glyphH);
+	return true;
+}
+
+#else // no offscreen buffering on this display
+
+static void markDirty(int x, int y, int width, int height) { }
+static Adafruit_GFX *drawTarget() { return (Adafruit_GFX *) &tft; }
+static void flushDisplay() { }
+static void setBuffered(int flag) { }
+static int drawStringFast(const char *s, int x, int y, int fgColor, int bgColor, int scale) { return false; }
+
+#endif // TFT_CAN_BUFFER
+
 void tftClear() {
+	if (tftBuffered) {
+		drawTarget()->fillScreen(BLACK);
+		markDirty(0, 0, TFT_WIDTH, TFT_HEIGHT);
+		return;
+	}
 	tft.fillScreen(BLACK);
 	UPDATE_DISPLAY();
 }
@@ -347,7 +564,8 @@ static OBJ primSetPixel(int argCount, OBJ *args) {
 	int x = obj2int(args[0]);
 	int y = obj2int(args[1]);
 	int color16b = color24to16b(obj2int(args[2]));
-	tft.drawPixel(x, y, color16b);
+	drawTarget()->drawPixel(x, y, color16b);
+	markDirty(x, y, 1, 1);
 	UPDATE_DISPLAY();
 	return falseObj;
 }
@@ -358,7 +576,11 @@ static OBJ primLine(int argCount, OBJ *args) {
 	int x1 = obj2int(args[2]);
 	int y1 = obj2int(args[3]);
 	int color16b = color24to16b(obj2int(args[4]));
-	tft.drawLine(x0, y0, x1, y1, color16b);
+	drawTarget()->drawLine(x0, y0, x1, y1, color16b);
+	markDirty(
+		(x0 < x1) ? x0 : x1, (y0 < y1) ? y0 : y1,
+		((x0 < x1) ? (x1 - x0) : (x0 - x1)) + 1,
+		((y0 < y1) ? (y1 - y0) : (y0 - y1)) + 1);
 	UPDATE_DISPLAY();
 	return falseObj;
 }
@@ -371,10 +593,11 @@ static OBJ primRect(int argCount, OBJ *args) {
 	int color16b = color24to16b(obj2int(args[4]));
 	int fill = (argCount > 5) ? (trueObj == args[5]) : true;
 	if (fill) {
-		tft.fillRect(x, y, width, height, color16b);
+		drawTarget()->fillRect(x, y, width, height, color16b);
 	} else {
-		tft.drawRect(x, y, width, height, color16b);
+		drawTarget()->drawRect(x, y, width, height, color16b);
 	}
+	markDirty(x, y, width, height);
 	UPDATE_DISPLAY();
 	return falseObj;
 }
@@ -388,10 +611,11 @@ static OBJ primRoundedRect(int argCount, OBJ *args) {
 	int color16b = color24to16b(obj2int(args[5]));
 	int fill = (argCount > 6) ? (trueObj == args[6]) : true;
 	if (fill) {
-		tft.fillRoundRect(x, y, width, height, radius, color16b);
+		drawTarget()->fillRoundRect(x, y, width, height, radius, color16b);
 	} else {
-		tft.drawRoundRect(x, y, width, height, radius, color16b);
+		drawTarget()->drawRoundRect(x, y, width, height, radius, color16b);
 	}
+	markDirty(x, y, width, height);
 	UPDATE_DISPLAY();
 	return falseObj;
 }
@@ -403,10 +627,11 @@ static OBJ primCircle(int argCount, OBJ *args) {
 	int color16b = color24to16b(obj2int(args[3]));
 	int fill = (argCount > 4) ? (trueObj == args[4]) : true;
 	if (fill) {
-		tft.fillCircle(x, y, radius, color16b);
+		drawTarget()->fillCircle(x, y, radius, color16b);
 	} else {
-		tft.drawCircle(x, y, radius, color16b);
+		drawTarget()->drawCircle(x, y, radius, color16b);
 	}
+	markDirty(x - radius, y - radius, (2 * radius) + 1, (2 * radius) + 1);
 	UPDATE_DISPLAY();
 	return falseObj;
 }
@@ -421,10 +646,15 @@ static OBJ primTriangle(int argCount, OBJ *args) {
 	int color16b = color24to16b(obj2int(args[6]));
 	int fill = (argCount > 7) ? (trueObj == args[7]) : true;
 	if (fill) {
-		tft.fillTriangle(x0, y0, x1, y1, x2, y2, color16b);
+		drawTarget()->fillTriangle(x0, y0, x1, y1, x2, y2, color16b);
 	} else {
-		tft.drawTriangle(x0, y0, x1, y1, x2, y2, color16b);
+		drawTarget()->drawTriangle(x0, y0, x1, y1, x2, y2, color16b);
 	}
+	int minX = (x0 < x1) ? x0 : x1; if (x2 < minX) minX = x2;
+	int minY = (y0 < y1) ? y0 : y1; if (y2 < minY) minY = y2;
+	int maxX = (x0 > x1) ? x0 : x1; if (x2 > maxX) maxX = x2;
+	int maxY = (y0 > y1) ? y0 : y1; if (y2 > maxY) maxY = y2;
+	markDirty(minX, minY, (maxX - minX) + 1, (maxY - minY) + 1);
 	UPDATE_DISPLAY();
 	return falseObj;
 }
@@ -436,26 +666,94 @@ static OBJ primText(int argCount, OBJ *args) {
 	int color16b = color24to16b(obj2int(args[3]));
 	int scale = (argCount > 4) ? obj2int(args[4]) : 2;
 	int wrap = (argCount > 5) ? (trueObj == args[5]) : true;
-	tft.setCursor(x, y);
-	tft.setTextColor(color16b);
-	tft.setTextSize(scale);
-	tft.setTextWrap(wrap);
+	Adafruit_GFX *g = drawTarget();
+	g->setCursor(x, y);
+	g->setTextColor(color16b);
+	g->setTextSize(scale);
+	g->setTextWrap(wrap);
+
+	char s[50];
+	char *text = s;
+	if (IS_TYPE(value, StringType)) {
+		text = obj2str(value);
+	} else if (trueObj == value) {
+		text = (char *) "true";
+	} else if (falseObj == value) {
+		text = (char *) "false";
+	} else if (isInt(value)) {
+		sprintf(s, "%d", obj2int(value));
+	} else {
+		s[0] = '\0';
+	}
+	g->print(text);
+
+	int16_t boundsX, boundsY;
+	uint16_t boundsW, boundsH;
+	g->getTextBounds(text, x, y, &boundsX, &boundsY, &boundsW, &boundsH);
+	markDirty(boundsX, boundsY, boundsW, boundsH);
+	UPDATE_DISPLAY();
+	return falseObj;
+}
+
+static OBJ primDrawString(int argCount, OBJ *args) {
+	// Draw a whole string in one pass: (text, x, y, color, [scale], [bgColor]).
+	// Unlike the text primitive, this draws background pixels too, so a new
+	// value overwrites the old one without flicker or a separate clearing rect.
 
+	OBJ value = args[0];
+	int x = obj2int(args[1]);
+	int y = obj2int(args[2]);
+	int fgColor = color24to16b(obj2int(args[3]));
+	int scale = (argCount > 4) ? obj2int(args[4]) : 2;
+	int bgColor = (argCount > 5) ? color24to16b(obj2int(args[5])) : BLACK;
+
+	char s[50];
+	char *text = s;
 	if (IS_TYPE(value, StringType)) {
-		tft.print(obj2str(value));
+		text = obj2str(value);
 	} else if (trueObj == value) {
-		tft.print("true");
+		text = (char *) "true";
 	} else if (falseObj == value) {
-		tft.print("false");
+		text = (char *) "false";
 	} else if (isInt(value)) {
-		char s[50];
 		sprintf(s, "%d", obj2int(value));
-		tft.print(s);
+	} else {
+		s[0] = '\0';
 	}
+	if (drawStringFast(text, x, y, fgColor, bgColor, scale)) {
+		UPDATE_DISPLAY();
+		return falseObj;
+	}
+
+	// fall back to character-by-character rendering (off-screen, odd scale, etc.)
+	Adafruit_GFX *g = drawTarget();
+	g->setCursor(x, y);
+	g->setTextColor(fgColor, bgColor);
+	g->setTextSize(scale);
+	g->setTextWrap(false);
+	g->print(text);
+	int16_t boundsX, boundsY;
+	uint16_t boundsW, boundsH;
+	g->getTextBounds(text, x, y, &boundsX, &boundsY, &boundsW, &boundsH);
+	markDirty(boundsX, boundsY, boundsW, boundsH);
 	UPDATE_DISPLAY();
 	return falseObj;
 }
 
+static OBJ primDeferUpdates(int argCount, OBJ *args) {
+	// Turn offscreen buffering on or off. While buffering, drawing primitives
+	// render into the frame buffer; nothing appears until flushDisplay.
+	// Turning buffering off flushes any pending changes.
+
+	setBuffered((argCount < 1) || (trueObj == args[0]));
+	return falseObj;
+}
+
+static OBJ primFlushDisplay(int argCount, OBJ *args) {
+	flushDisplay();
+	return falseObj;
+}
+
 void tftSetHugePixel(int x, int y, int state) {
 	// simulate a 5x5 array of square pixels like the micro:bit LED array
 	int minDimension, xInset = 0, yInset = 0;
@@ -552,6 +850,9 @@ static OBJ primTftTouched(int argCount, OBJ *args) { return falseObj; }
 static OBJ primTftTouchX(int argCount, OBJ *args) { return falseObj; }
 static OBJ primTftTouchY(int argCount, OBJ *args) { return falseObj; }
 static OBJ primTftTouchPressure(int argCount, OBJ *args) { return falseObj; }
+static OBJ primDrawString(int argCount, OBJ *args) { return falseObj; }
+static OBJ primDeferUpdates(int argCount, OBJ *args) { return falseObj; }
+static OBJ primFlushDisplay(int argCount, OBJ *args) { return falseObj; }
 
 #endif
 
@@ -569,6 +870,9 @@ static PrimEntry entries[] = {
 	{"circle", primCircle},
 	{"triangle", primTriangle},
 	{"text", primText},
+	{"drawString", primDrawString},
+	{"deferUpdates", primDeferUpdates},
+	{"flushDisplay", primFlushDisplay},
 	{"tftTouched", primTftTouched},
 	{"tftTouchX", primTftTouchX},
 	{"tftTouchY", primTftTouchY},
@@ -31,6 +31,7 @@ static OBJ primSetVarNamed (int argCount, OBJ *args) {
 	int index = indexOfVarNamed(obj2str(args[0]));
 	if (index > -1) {
 		vars[index] = args[1];
+		varDirtyMask |= 1 << (index & 31); // re-arm condition hats watching this variable
 	}
 	return falseObj;
 }
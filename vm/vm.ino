@@ -18,6 +18,9 @@ void setup() {
 	outputString((char *) "Welcome to MicroBlocks!");
 	restoreScripts();
 	startAll();
+	#ifdef VM_BENCHMARK
+		runBenchmarks(); // report benchmark results on the serial port, then run normally
+	#endif
 }
 
 void loop() {